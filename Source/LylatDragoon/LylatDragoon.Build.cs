@@ -6,6 +6,6 @@ public class LylatDragoon : ModuleRules
 {
 	public LylatDragoon(ReadOnlyTargetRules ROTargetRules) : base (ROTargetRules)
 	{
-		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "LevelSequence", "MovieScene" });
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "LevelSequence", "MovieScene", "MovieSceneTracks", "RenderCore" });
 	}
 }
@@ -7,4 +7,38 @@ IMPLEMENT_PRIMARY_GAME_MODULE(FDefaultGameModuleImpl, LylatDragoon, "LylatDragoo
 
 DEFINE_LOG_CATEGORY(LogFlying)
 
+DEFINE_STAT(STAT_LylatDragoon_FlightUpdate);
+DEFINE_STAT(STAT_LylatDragoon_CourseUpdate);
+DEFINE_STAT(STAT_LylatDragoon_WallContact);
+DEFINE_STAT(STAT_LylatDragoon_EnemySimulation);
+DEFINE_STAT(STAT_LylatDragoon_EnemyWriteBack);
+DEFINE_STAT(STAT_LylatDragoon_ProjectileIntegration);
+DEFINE_STAT(STAT_LylatDragoon_ProjectileHits);
+DEFINE_STAT(STAT_LylatDragoon_ProjectileVisuals);
+DEFINE_STAT(STAT_LylatDragoon_BulletSimulation);
+DEFINE_STAT(STAT_LylatDragoon_BulletVisuals);
+DEFINE_STAT(STAT_LylatDragoon_Spawning);
+DEFINE_STAT(STAT_LylatDragoon_DamageResolution);
+DEFINE_STAT(STAT_LylatDragoon_Significance);
+DEFINE_STAT(STAT_LylatDragoon_SwarmUpdate);
+DEFINE_STAT(STAT_LylatDragoon_Targeting);
+DEFINE_STAT(STAT_LylatDragoon_HUDDraw);
+
+DEFINE_STAT(STAT_LylatDragoon_EnemiesAlive);
+DEFINE_STAT(STAT_LylatDragoon_EnemiesSpawned);
+DEFINE_STAT(STAT_LylatDragoon_ProjectilesInFlight);
+DEFINE_STAT(STAT_LylatDragoon_EnemyBullets);
+DEFINE_STAT(STAT_LylatDragoon_HUDMarkers);
+DEFINE_STAT(STAT_LylatDragoon_CandidatePairs);
+DEFINE_STAT(STAT_LylatDragoon_DamageHits);
+DEFINE_STAT(STAT_LylatDragoon_DamagedTargets);
+DEFINE_STAT(STAT_LylatDragoon_PendingManifests);
+DEFINE_STAT(STAT_LylatDragoon_ResidentAssetKB);
+DEFINE_STAT(STAT_LylatDragoon_LoadedSections);
+DEFINE_STAT(STAT_LylatDragoon_TelemetryDropped);
+DEFINE_STAT(STAT_LylatDragoon_FrameArenaPeak);
+DEFINE_STAT(STAT_LylatDragoon_WaveArenaPeak);
+
+CSV_DEFINE_CATEGORY(LylatDragoon, true);
+
  
\ No newline at end of file
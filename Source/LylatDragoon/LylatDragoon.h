@@ -4,7 +4,64 @@
 #define __LYLATDRAGOON_H__
 
 #include "EngineMinimal.h"
+#include "ProfilingDebugging/CsvProfiler.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogFlying, Log, All);
 
+// Game thread cost of the game systems, shown by "stat LylatDragoon" and in the LylatDragoon category of CSV captures
+DECLARE_STATS_GROUP(TEXT("LylatDragoon"), STATGROUP_LylatDragoon, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Flight update"), STAT_LylatDragoon_FlightUpdate, STATGROUP_LylatDragoon, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Level course update"), STAT_LylatDragoon_CourseUpdate, STATGROUP_LylatDragoon, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Wall contact"), STAT_LylatDragoon_WallContact, STATGROUP_LylatDragoon, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Enemy simulation"), STAT_LylatDragoon_EnemySimulation, STATGROUP_LylatDragoon, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Enemy write back"), STAT_LylatDragoon_EnemyWriteBack, STATGROUP_LylatDragoon, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Projectile integration"), STAT_LylatDragoon_ProjectileIntegration, STATGROUP_LylatDragoon, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Projectile hits"), STAT_LylatDragoon_ProjectileHits, STATGROUP_LylatDragoon, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Projectile visuals"), STAT_LylatDragoon_ProjectileVisuals, STATGROUP_LylatDragoon, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Bullet simulation"), STAT_LylatDragoon_BulletSimulation, STATGROUP_LylatDragoon, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Bullet visuals"), STAT_LylatDragoon_BulletVisuals, STATGROUP_LylatDragoon, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Spawning"), STAT_LylatDragoon_Spawning, STATGROUP_LylatDragoon, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Damage resolution"), STAT_LylatDragoon_DamageResolution, STATGROUP_LylatDragoon, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Enemy significance"), STAT_LylatDragoon_Significance, STATGROUP_LylatDragoon, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Swarm update"), STAT_LylatDragoon_SwarmUpdate, STATGROUP_LylatDragoon, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Targeting"), STAT_LylatDragoon_Targeting, STATGROUP_LylatDragoon, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("HUD draw"), STAT_LylatDragoon_HUDDraw, STATGROUP_LylatDragoon, );
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Enemies alive"), STAT_LylatDragoon_EnemiesAlive, STATGROUP_LylatDragoon, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Enemies spawned"), STAT_LylatDragoon_EnemiesSpawned, STATGROUP_LylatDragoon, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Projectiles in flight"), STAT_LylatDragoon_ProjectilesInFlight, STATGROUP_LylatDragoon, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Enemy bullets"), STAT_LylatDragoon_EnemyBullets, STATGROUP_LylatDragoon, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("HUD markers"), STAT_LylatDragoon_HUDMarkers, STATGROUP_LylatDragoon, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Projectile candidate pairs"), STAT_LylatDragoon_CandidatePairs, STATGROUP_LylatDragoon, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Damage hits"), STAT_LylatDragoon_DamageHits, STATGROUP_LylatDragoon, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Damaged targets"), STAT_LylatDragoon_DamagedTargets, STATGROUP_LylatDragoon, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Manifests loading"), STAT_LylatDragoon_PendingManifests, STATGROUP_LylatDragoon, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Streamed assets resident (KB)"), STAT_LylatDragoon_ResidentAssetKB, STATGROUP_LylatDragoon, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Course sections loaded"), STAT_LylatDragoon_LoadedSections, STATGROUP_LylatDragoon, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Telemetry events dropped"), STAT_LylatDragoon_TelemetryDropped, STATGROUP_LylatDragoon, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Frame arena peak (bytes)"), STAT_LylatDragoon_FrameArenaPeak, STATGROUP_LylatDragoon, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Wave arenas peak (bytes)"), STAT_LylatDragoon_WaveArenaPeak, STATGROUP_LylatDragoon, );
+
+CSV_DECLARE_CATEGORY_EXTERN(LylatDragoon);
+
+// Time a scope in the stat group, in the CSV profiler and as a named event for external profilers
+#define LYLATDRAGOON_SCOPE_CYCLE_COUNTER(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_LylatDragoon_##Name); \
+	CSV_SCOPED_TIMING_STAT(LylatDragoon, Name); \
+	SCOPED_NAMED_EVENT(LylatDragoon_##Name, FColor::Orange)
+
+// Set a counter of the stat group for this frame, also recorded in the CSV profiler
+#define LYLATDRAGOON_SET_COUNTER(Name, Value) \
+	SET_DWORD_STAT(STAT_LylatDragoon_##Name, Value); \
+	CSV_CUSTOM_STAT(LylatDragoon, Name, (int32)(Value), ECsvCustomStatOp::Set)
+
+// Add to a counter of the stat group for this frame, for counters summed over several objects
+#define LYLATDRAGOON_ADD_COUNTER(Name, Value) \
+	INC_DWORD_STAT_BY(STAT_LylatDragoon_##Name, Value); \
+	CSV_CUSTOM_STAT(LylatDragoon, Name, (int32)(Value), ECsvCustomStatOp::Accumulate)
+
+// Check that the level course, the pawn and the camera are updated in order every frame
+#define LYLATDRAGOON_VALIDATE_TICK_ORDER !UE_BUILD_SHIPPING
+
 #endif
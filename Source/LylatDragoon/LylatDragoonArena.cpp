@@ -0,0 +1,233 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonArena.h"
+
+FLylatDragoonArena::FLylatDragoonArena(int32 InBlockSize)
+	: BlockSize(FMath::Max(InBlockSize, 1024))
+	, CurrentBlock(INDEX_NONE)
+	, CurrentData(nullptr)
+	, CurrentSize(0)
+	, Top(0)
+	, UsedBeforeBlock(0)
+	, PeakBytes(0)
+{
+}
+
+FLylatDragoonArena::~FLylatDragoonArena()
+{
+	for (const FBlock& Block : Blocks)
+	{
+		FMemory::Free(Block.Data);
+	}
+}
+
+FLylatDragoonArena& FLylatDragoonArena::GetFrameArena()
+{
+	check(IsInGameThread());
+
+	static FLylatDragoonArena FrameArena(256 * 1024);
+	return FrameArena;
+}
+
+void FLylatDragoonArena::PopToMark(const FMark& Mark)
+{
+	checkSlow(Mark.Block < CurrentBlock || (Mark.Block == CurrentBlock && Mark.Offset <= Top));
+
+	CurrentBlock = Mark.Block;
+	Top = Mark.Offset;
+	UsedBeforeBlock = Mark.UsedBeforeBlock;
+	if (Blocks.IsValidIndex(CurrentBlock))
+	{
+		CurrentData = Blocks[CurrentBlock].Data;
+		CurrentSize = Blocks[CurrentBlock].Size;
+	}
+	else
+	{
+		CurrentData = nullptr;
+		CurrentSize = 0;
+	}
+}
+
+int32 FLylatDragoonArena::GetReservedBytes() const
+{
+	int32 ReservedBytes = 0;
+	for (const FBlock& Block : Blocks)
+	{
+		ReservedBytes += Block.Size;
+	}
+	return ReservedBytes;
+}
+
+void* FLylatDragoonArena::AllocateInNextBlock(int32 Size)
+{
+	// The end of the current block is wasted until the cursor moves back
+	UsedBeforeBlock += CurrentSize;
+	CurrentBlock++;
+
+	// Blocks allocated after an earlier peak are reused, one too small for this allocation gets a bigger one before it
+	if (!Blocks.IsValidIndex(CurrentBlock) || Blocks[CurrentBlock].Size < Size)
+	{
+		FBlock Block;
+		Block.Size = FMath::Max(BlockSize, Align(Size, (int32)MaxAlignment));
+		Block.Data = (uint8*)FMemory::Malloc(Block.Size, MaxAlignment);
+		Blocks.Insert(Block, CurrentBlock);
+	}
+
+	CurrentData = Blocks[CurrentBlock].Data;
+	CurrentSize = Blocks[CurrentBlock].Size;
+	Top = Size;
+	PeakBytes = FMath::Max(PeakBytes, UsedBeforeBlock + Top);
+	return CurrentData;
+}
+
+/** Counts the times the memory of an array moved, every move is an allocation */
+template<typename ArrayType>
+static FORCEINLINE void CountReallocation(const ArrayType& Array, const void*& Data, int32& ReallocationCount)
+{
+	if (Array.GetData() != Data)
+	{
+		Data = Array.GetData();
+		++ReallocationCount;
+	}
+}
+
+static void BenchmarkArena(const TArray<FString>& Args)
+{
+	const int32 MaxEnemyCount = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 2) : 200;
+	const int32 FrameCount = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 1000;
+
+	// Every frame the broad phases gather the enemies alive, whose number changes as waves spawn and die. A wave is
+	// queued every few seconds and drained before the next one
+	const int32 WaveFrames = 240;
+	TArray<const void*> AllEnemies;
+	for (int32 Index = 0; Index < MaxEnemyCount; ++Index)
+	{
+		AllEnemies.Add((const void*)(UPTRINT)((Index + 1) * 16));
+	}
+
+	// Enemies alive in the frame, as the game mode lists them
+	TArray<const void*> Enemies;
+	Enemies.Reserve(MaxEnemyCount);
+	auto SetEnemiesAlive = [&AllEnemies, &Enemies, MaxEnemyCount](int32 Frame)
+	{
+		Enemies.Reset();
+		Enemies.Append(AllEnemies.GetData(), 1 + (int32)((MaxEnemyCount - 1) * (0.5f + 0.5f * FMath::Sin(Frame * 0.05f))));
+	};
+
+	struct FPendingSpawn
+	{
+		int32 WaveIndex;
+		int32 EnemyIndex;
+	};
+
+	float Checksum = 0.0f;
+
+	// What the game ran before: the enemies and the spheres assigned to the copies kept by the projectile pool and the
+	// spatial hash, and the pending spawns in an array of the spawner
+	double BeforeSeconds = 0.0;
+	int32 BeforeReallocationCount = 0;
+	{
+		TArray<const void*> HashedEnemies;
+		TArray<FVector> EnemyCenters;
+		TArray<float> EnemyRadii;
+		TArray<FVector> SphereCenters;
+		TArray<float> SphereRadii;
+		TArray<FPendingSpawn> PendingSpawns;
+		const void* Data[6] = {};
+
+		for (int32 Frame = 0; Frame < FrameCount; ++Frame)
+		{
+			SetEnemiesAlive(Frame);
+			const double StartTime = FPlatformTime::Seconds();
+
+			HashedEnemies = Enemies;
+			EnemyCenters.Reset(HashedEnemies.Num());
+			EnemyRadii.Reset(HashedEnemies.Num());
+			for (int32 Index = 0; Index < HashedEnemies.Num(); ++Index)
+			{
+				EnemyCenters.Add(FVector((float)(UPTRINT)HashedEnemies[Index]));
+				EnemyRadii.Add(50.0f);
+			}
+			SphereCenters = EnemyCenters;
+			SphereRadii = EnemyRadii;
+
+			if (Frame % WaveFrames == 0)
+			{
+				PendingSpawns.Reset();
+				for (int32 Index = 0; Index < MaxEnemyCount; ++Index)
+				{
+					PendingSpawns.Add(FPendingSpawn{ Frame / WaveFrames, Index });
+				}
+			}
+
+			Checksum += SphereCenters.Last().X + SphereRadii.Last() + PendingSpawns.Last().EnemyIndex;
+			BeforeSeconds += FPlatformTime::Seconds() - StartTime;
+
+			CountReallocation(HashedEnemies, Data[0], BeforeReallocationCount);
+			CountReallocation(EnemyCenters, Data[1], BeforeReallocationCount);
+			CountReallocation(EnemyRadii, Data[2], BeforeReallocationCount);
+			CountReallocation(SphereCenters, Data[3], BeforeReallocationCount);
+			CountReallocation(SphereRadii, Data[4], BeforeReallocationCount);
+			CountReallocation(PendingSpawns, Data[5], BeforeReallocationCount);
+		}
+	}
+
+	// What the game runs now: the enemies gathered in the frame arena, the spheres written straight into the spatial
+	// hash, and the pending spawns in the wave arena reset once they are drained
+	double NowSeconds = 0.0;
+	int32 NowReallocationCount = 0;
+	FLylatDragoonArena FrameArena(256 * 1024);
+	FLylatDragoonArena WaveArena(4 * 1024);
+	{
+		TArray<FVector> SphereCenters;
+		TArray<float> SphereRadii;
+		TLylatDragoonArenaArray<FPendingSpawn> PendingSpawns(WaveArena);
+		const void* Data[4] = {};
+
+		for (int32 Frame = 0; Frame < FrameCount; ++Frame)
+		{
+			SetEnemiesAlive(Frame);
+			const double StartTime = FPlatformTime::Seconds();
+
+			FLylatDragoonArenaScope ArenaScope(FrameArena);
+			TLylatDragoonArenaArray<const void*> HashedEnemies(FrameArena);
+			HashedEnemies.Append(Enemies.GetData(), Enemies.Num());
+			SphereCenters.Reset(HashedEnemies.Num());
+			SphereRadii.Reset(HashedEnemies.Num());
+			for (int32 Index = 0; Index < HashedEnemies.Num(); ++Index)
+			{
+				SphereCenters.Add(FVector((float)(UPTRINT)HashedEnemies[Index]));
+				SphereRadii.Add(50.0f);
+			}
+
+			if (Frame % WaveFrames == 0)
+			{
+				PendingSpawns.Empty();
+				WaveArena.Reset();
+				PendingSpawns.Reserve(MaxEnemyCount);
+				for (int32 Index = 0; Index < MaxEnemyCount; ++Index)
+				{
+					PendingSpawns.Add(FPendingSpawn{ Frame / WaveFrames, Index });
+				}
+			}
+
+			Checksum += SphereCenters.Last().X + SphereRadii.Last() + PendingSpawns[PendingSpawns.Num() - 1].EnemyIndex;
+			NowSeconds += FPlatformTime::Seconds() - StartTime;
+
+			CountReallocation(HashedEnemies, Data[0], NowReallocationCount);
+			CountReallocation(SphereCenters, Data[1], NowReallocationCount);
+			CountReallocation(SphereRadii, Data[2], NowReallocationCount);
+			CountReallocation(PendingSpawns, Data[3], NowReallocationCount);
+		}
+	}
+
+	UE_LOG(LogFlying, Display, TEXT("Arena: up to %d enemies over %d frames, before %.4f ms per frame with %d allocations, now %.4f ms per frame with %d allocations, frame arena peak %d bytes in %d bytes of blocks, wave arena peak %d bytes in %d bytes of blocks (checksum %.0f)"),
+		MaxEnemyCount, FrameCount, BeforeSeconds * 1000.0 / FrameCount, BeforeReallocationCount, NowSeconds * 1000.0 / FrameCount, NowReallocationCount,
+		FrameArena.GetPeakBytes(), FrameArena.GetReservedBytes(), WaveArena.GetPeakBytes(), WaveArena.GetReservedBytes(), Checksum);
+}
+
+static FAutoConsoleCommand BenchmarkArenaCommand(
+	TEXT("LylatDragoon.BenchArena"),
+	TEXT("Gather up to the given number of enemies (200 by default) for the broad phases and queue their spawns for the given number of frames (1000 by default), the way the game did before and does now, and log the time per frame and the allocations."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkArena));
@@ -0,0 +1,273 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Containers/ArrayView.h"
+
+/**
+ * Linear allocator for transient gameplay data. Allocating moves a cursor forward in a block of memory, nothing is
+ * freed on its own: the whole arena is reset at once, or moved back to a mark taken earlier, in constant time.
+ * Blocks are kept after a reset and reused, so once the arena has reached its peak it never allocates again.
+ * Nothing allocated in an arena is destructed, only trivially destructible data belongs there.
+ *
+ * The frame arena is reset at the start of every frame by the game mode, for scratch data that doesn't outlive the
+ * function using it. Systems take a FLylatDragoonArenaScope around their scratch data so the frame peak is the largest
+ * system rather than the sum of them. Data living as long as a wave goes into the arena of its spawner.
+ */
+class LYLATDRAGOON_API FLylatDragoonArena
+{
+public:
+
+	/** Position of the cursor of the arena, to move it back to */
+	struct FMark
+	{
+		int32 Block;
+		int32 Offset;
+		int32 UsedBeforeBlock;
+
+		FMark() : Block(INDEX_NONE), Offset(0), UsedBeforeBlock(0) {}
+	};
+
+	/** Allocations bigger than a block get a block of their own */
+	explicit FLylatDragoonArena(int32 InBlockSize = 64 * 1024);
+	~FLylatDragoonArena();
+
+	FLylatDragoonArena(const FLylatDragoonArena&) = delete;
+	FLylatDragoonArena& operator=(const FLylatDragoonArena&) = delete;
+
+	/** Returns the arena of the game thread reset every frame */
+	static FLylatDragoonArena& GetFrameArena();
+
+	/** Returns uninitialized memory. The alignment can be up to 16 */
+	FORCEINLINE void* Allocate(int32 Size, int32 Alignment)
+	{
+		checkSlow(Alignment <= MaxAlignment && FMath::IsPowerOfTwo(Alignment));
+
+		const int32 Start = Align(Top, Alignment);
+		if (Start + Size > CurrentSize)
+		{
+			return AllocateInNextBlock(Size);
+		}
+
+		Top = Start + Size;
+		PeakBytes = FMath::Max(PeakBytes, UsedBeforeBlock + Top);
+		return CurrentData + Start;
+	}
+
+	/** Make the last allocation bigger without moving it, returns false if it isn't the last one or doesn't fit */
+	FORCEINLINE bool TryGrow(void* Data, int32 Size, int32 NewSize)
+	{
+		// Only an allocation of the current block can be the last one, the pointers of other blocks can't be compared
+		const UPTRINT Address = (UPTRINT)Data;
+		const UPTRINT BlockAddress = (UPTRINT)CurrentData;
+		if (CurrentData == nullptr || Address < BlockAddress || Address >= BlockAddress + CurrentSize)
+		{
+			return false;
+		}
+
+		const int32 Start = (int32)(Address - BlockAddress);
+		if (Start + Size != Top || Start + NewSize > CurrentSize)
+		{
+			return false;
+		}
+
+		Top = Start + NewSize;
+		PeakBytes = FMath::Max(PeakBytes, UsedBeforeBlock + Top);
+		return true;
+	}
+
+	/** Returns the position of the cursor */
+	FORCEINLINE FMark GetMark() const
+	{
+		FMark Mark;
+		Mark.Block = CurrentBlock;
+		Mark.Offset = Top;
+		Mark.UsedBeforeBlock = UsedBeforeBlock;
+		return Mark;
+	}
+
+	/** Move the cursor back, releasing everything allocated since the mark was taken */
+	void PopToMark(const FMark& Mark);
+
+	/** Release everything, keeping the blocks for the next allocations */
+	FORCEINLINE void Reset() { PopToMark(FMark()); }
+
+	/** Returns the bytes allocated now, the end of the blocks skipped included */
+	FORCEINLINE int32 GetUsedBytes() const { return UsedBeforeBlock + Top; }
+
+	/** Returns the most bytes allocated at once since the arena was created */
+	FORCEINLINE int32 GetPeakBytes() const { return PeakBytes; }
+
+	/** Returns the size of the blocks of the arena */
+	int32 GetReservedBytes() const;
+
+private:
+
+	enum { MaxAlignment = 16 };
+
+	struct FBlock
+	{
+		uint8* Data;
+		int32 Size;
+	};
+
+	/** Continue in the next block, allocating it if there is none or it is too small */
+	void* AllocateInNextBlock(int32 Size);
+
+	int32 BlockSize;
+	TArray<FBlock> Blocks;
+
+	/** Block the cursor is in, INDEX_NONE before the first allocation */
+	int32 CurrentBlock;
+	uint8* CurrentData;
+	int32 CurrentSize;
+
+	/** Offset of the cursor in the current block */
+	int32 Top;
+
+	/** Size of the blocks before the current one */
+	int32 UsedBeforeBlock;
+
+	int32 PeakBytes;
+};
+
+/** Moves the cursor of an arena back to where it was when the scope started */
+class FLylatDragoonArenaScope
+{
+public:
+
+	explicit FLylatDragoonArenaScope(FLylatDragoonArena& InArena)
+		: Arena(InArena)
+		, Mark(InArena.GetMark())
+	{
+	}
+
+	~FLylatDragoonArenaScope()
+	{
+		Arena.PopToMark(Mark);
+	}
+
+private:
+
+	FLylatDragoonArena& Arena;
+	FLylatDragoonArena::FMark Mark;
+};
+
+/**
+ * Growing array allocated in an arena. Growing the last allocation of the arena extends it in place, otherwise the
+ * elements are copied to a new allocation and the old one is left for the arena to reset.
+ * The elements are only valid until the arena is reset or moved back before they were allocated.
+ */
+template<typename ElementType>
+class TLylatDragoonArenaArray
+{
+	static_assert(TIsTriviallyDestructible<ElementType>::Value, "Arenas never destruct what they hold");
+
+public:
+
+	TLylatDragoonArenaArray()
+		: Arena(nullptr)
+		, Data(nullptr)
+		, ArrayNum(0)
+		, ArrayMax(0)
+	{
+	}
+
+	explicit TLylatDragoonArenaArray(FLylatDragoonArena& InArena)
+		: Arena(&InArena)
+		, Data(nullptr)
+		, ArrayNum(0)
+		, ArrayMax(0)
+	{
+	}
+
+	FORCEINLINE int32 Num() const { return ArrayNum; }
+
+	FORCEINLINE ElementType& operator[](int32 Index)
+	{
+		checkSlow(Index >= 0 && Index < ArrayNum);
+		return Data[Index];
+	}
+
+	FORCEINLINE const ElementType& operator[](int32 Index) const
+	{
+		checkSlow(Index >= 0 && Index < ArrayNum);
+		return Data[Index];
+	}
+
+	FORCEINLINE int32 Add(const ElementType& Item)
+	{
+		if (ArrayNum == ArrayMax)
+		{
+			Grow(ArrayNum + 1);
+		}
+		new(Data + ArrayNum) ElementType(Item);
+		return ArrayNum++;
+	}
+
+	void Append(const ElementType* Items, int32 Count)
+	{
+		Reserve(ArrayNum + Count);
+		for (int32 Index = 0; Index < Count; ++Index)
+		{
+			new(Data + ArrayNum + Index) ElementType(Items[Index]);
+		}
+		ArrayNum += Count;
+	}
+
+	void Reserve(int32 Number)
+	{
+		if (Number > ArrayMax)
+		{
+			Grow(Number);
+		}
+	}
+
+	/** Remove the elements, keeping the memory while the arena holds it */
+	FORCEINLINE void Reset() { ArrayNum = 0; }
+
+	/** Forget the memory, once the arena was reset */
+	FORCEINLINE void Empty()
+	{
+		Data = nullptr;
+		ArrayNum = 0;
+		ArrayMax = 0;
+	}
+
+	FORCEINLINE ElementType* GetData() { return Data; }
+	FORCEINLINE const ElementType* GetData() const { return Data; }
+
+	FORCEINLINE TArrayView<const ElementType> GetView() const { return TArrayView<const ElementType>(Data, ArrayNum); }
+
+	FORCEINLINE ElementType* begin() { return Data; }
+	FORCEINLINE ElementType* end() { return Data + ArrayNum; }
+	FORCEINLINE const ElementType* begin() const { return Data; }
+	FORCEINLINE const ElementType* end() const { return Data + ArrayNum; }
+
+private:
+
+	void Grow(int32 MinMax)
+	{
+		check(Arena);
+
+		const int32 NewMax = FMath::Max(MinMax, FMath::Max(ArrayMax * 2, 16));
+		if (Data && Arena->TryGrow(Data, ArrayMax * sizeof(ElementType), NewMax * sizeof(ElementType)))
+		{
+			ArrayMax = NewMax;
+			return;
+		}
+
+		ElementType* NewData = (ElementType*)Arena->Allocate(NewMax * sizeof(ElementType), alignof(ElementType));
+		if (ArrayNum > 0)
+		{
+			FMemory::Memcpy(NewData, Data, ArrayNum * sizeof(ElementType));
+		}
+		Data = NewData;
+		ArrayMax = NewMax;
+	}
+
+	FLylatDragoonArena* Arena;
+	ElementType* Data;
+	int32 ArrayNum;
+	int32 ArrayMax;
+};
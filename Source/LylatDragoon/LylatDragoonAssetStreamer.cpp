@@ -0,0 +1,151 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonAssetStreamer.h"
+
+#include "Engine/AssetManager.h"
+#include "Engine/Engine.h"
+
+static TAutoConsoleVariable<int32> CVarShowAssetStreaming(
+	TEXT("LylatDragoon.ShowAssetStreaming"),
+	0,
+	TEXT("Show on screen the manifests being loaded, the memory held by the loaded ones and the startup time."));
+
+ULylatDragoonAssetStreamer::ULylatDragoonAssetStreamer(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+
+	ResidentBytes = 0;
+	PeakResidentBytes = 0;
+	TotalLoadSeconds = 0.0;
+	LoadedRequestCount = 0;
+	StartupSeconds = -1.0;
+}
+
+void ULylatDragoonAssetStreamer::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UE_LOG(LogFlying, Log, TEXT("%s loaded %d manifests in %.3f s, peak resident %.1f MB, first controllable frame after %.3f s"),
+		*GetName(), LoadedRequestCount, TotalLoadSeconds, PeakResidentBytes / (1024.0 * 1024.0), StartupSeconds);
+
+	for (TPair<FName, FLylatDragoonStreamingRequest>& Request : Requests)
+	{
+		if (Request.Value.Handle.IsValid())
+		{
+			Request.Value.Handle->ReleaseHandle();
+		}
+	}
+	Requests.Empty();
+	ResidentBytes = 0;
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ULylatDragoonAssetStreamer::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	int32 PendingCount = 0;
+	for (const TPair<FName, FLylatDragoonStreamingRequest>& Request : Requests)
+	{
+		if (Request.Value.LoadSeconds < 0.0)
+		{
+			PendingCount++;
+		}
+	}
+
+	LYLATDRAGOON_SET_COUNTER(PendingManifests, PendingCount);
+	LYLATDRAGOON_SET_COUNTER(ResidentAssetKB, (int32)(ResidentBytes / 1024));
+
+	if (CVarShowAssetStreaming.GetValueOnGameThread() != 0 && GEngine)
+	{
+		GEngine->AddOnScreenDebugMessage((uint64)GetUniqueID(), 0.0f, FColor::Yellow, FString::Printf(TEXT("Manifests: %d loading, %d loaded in %.3f s, resident %.1f MB, startup %.3f s"),
+			PendingCount, LoadedRequestCount, TotalLoadSeconds, ResidentBytes / (1024.0 * 1024.0), StartupSeconds));
+	}
+}
+
+void ULylatDragoonAssetStreamer::RequestAssets(FName Name, const TArray<FSoftObjectPath>& Assets, FStreamableDelegate OnLoaded, TAsyncLoadPriority Priority)
+{
+	if (Requests.Contains(Name))
+	{
+		return;
+	}
+
+	FLylatDragoonStreamingRequest& Request = Requests.Add(Name);
+	Request.Assets = Assets;
+	Request.RequestTime = FPlatformTime::Seconds();
+	Request.LoadSeconds = -1.0;
+	Request.ResidentBytes = 0;
+
+	// The request has to be in the map before the load starts, since the completion can run right away
+	TSharedPtr<FStreamableHandle> Handle = UAssetManager::GetStreamableManager().RequestAsyncLoad(Assets, FStreamableDelegate::CreateUObject(this, &ULylatDragoonAssetStreamer::OnRequestLoaded, Name, OnLoaded), Priority);
+	if (Handle.IsValid())
+	{
+		// The completion may have added manifests, find the request again
+		Requests.FindChecked(Name).Handle = Handle;
+	}
+	else
+	{
+		// Nothing valid to load
+		OnRequestLoaded(Name, OnLoaded);
+	}
+}
+
+void ULylatDragoonAssetStreamer::ReleaseAssets(FName Name)
+{
+	FLylatDragoonStreamingRequest Request;
+	if (Requests.RemoveAndCopyValue(Name, Request))
+	{
+		if (Request.Handle.IsValid())
+		{
+			Request.Handle->ReleaseHandle();
+		}
+		ResidentBytes -= Request.ResidentBytes;
+	}
+}
+
+bool ULylatDragoonAssetStreamer::AreAssetsLoaded(FName Name) const
+{
+	const FLylatDragoonStreamingRequest* Request = Requests.Find(Name);
+	return Request && Request->LoadSeconds >= 0.0;
+}
+
+void ULylatDragoonAssetStreamer::NotifyFirstControllableFrame()
+{
+	if (StartupSeconds < 0.0)
+	{
+		StartupSeconds = FPlatformTime::Seconds() - GStartTime;
+		UE_LOG(LogFlying, Log, TEXT("First controllable frame after %.3f s"), StartupSeconds);
+	}
+}
+
+void ULylatDragoonAssetStreamer::OnRequestLoaded(FName Name, FStreamableDelegate OnLoaded)
+{
+	FLylatDragoonStreamingRequest* Request = Requests.Find(Name);
+	if (!Request || Request->LoadSeconds >= 0.0)
+	{
+		return;
+	}
+
+	Request->LoadSeconds = FPlatformTime::Seconds() - Request->RequestTime;
+
+	// Assets shared by several manifests are counted by each of them
+	for (const FSoftObjectPath& AssetPath : Request->Assets)
+	{
+		UObject* Asset = AssetPath.ResolveObject();
+		if (Asset)
+		{
+			Request->ResidentBytes += Asset->GetResourceSizeBytes(EResourceSizeMode::EstimatedTotal);
+		}
+	}
+
+	ResidentBytes += Request->ResidentBytes;
+	PeakResidentBytes = FMath::Max(PeakResidentBytes, ResidentBytes);
+	TotalLoadSeconds += Request->LoadSeconds;
+	LoadedRequestCount++;
+
+	UE_LOG(LogFlying, Verbose, TEXT("Loaded %s: %d assets in %.3f s, %.1f KB"), *Name.ToString(), Request->Assets.Num(), Request->LoadSeconds, Request->ResidentBytes / 1024.0);
+
+	OnLoaded.ExecuteIfBound();
+}
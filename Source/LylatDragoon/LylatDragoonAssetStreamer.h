@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Components/ActorComponent.h"
+#include "Engine/StreamableManager.h"
+#include "LylatDragoonAssetStreamer.generated.h"
+
+/** Assets loaded together and kept resident until released */
+struct FLylatDragoonStreamingRequest
+{
+	/** Handle keeping the assets loaded */
+	TSharedPtr<FStreamableHandle> Handle;
+
+	/** Assets of the manifest */
+	TArray<FSoftObjectPath> Assets;
+
+	/** Time when the request was made */
+	double RequestTime;
+
+	/** Time the load took (in seconds), negative while loading */
+	double LoadSeconds;
+
+	/** Estimated memory of the loaded assets */
+	int64 ResidentBytes;
+
+};
+
+/**
+ * Loads the content of the game asynchronously through the streamable manager. Everyone asks for a named
+ * manifest of soft references ahead of need, and the assets stay resident until the manifest is released.
+ * Keeps the load time of every manifest, the memory held by them and the time from startup to the first
+ * frame the player could control the pawn.
+ */
+UCLASS(ClassGroup = Content, meta = (BlueprintSpawnableComponent))
+class LYLATDRAGOON_API ULylatDragoonAssetStreamer : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	ULylatDragoonAssetStreamer(const FObjectInitializer& ObjectInitializer);
+
+	// Begin UActorComponent overrides
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	// End UActorComponent overrides
+
+	/** Start loading a manifest of assets. Nothing is done if a manifest with the same name was already requested */
+	void RequestAssets(FName Name, const TArray<FSoftObjectPath>& Assets, FStreamableDelegate OnLoaded = FStreamableDelegate(), TAsyncLoadPriority Priority = FStreamableManager::DefaultAsyncLoadPriority);
+
+	/** Let the assets of a manifest be unloaded once nothing else references them */
+	void ReleaseAssets(FName Name);
+
+	/** Returns true if every asset of the manifest was loaded */
+	bool AreAssetsLoaded(FName Name) const;
+
+	/** Record the time since startup the first time it is called */
+	void NotifyFirstControllableFrame();
+
+	/** Returns the time from startup to the first frame the player could control the pawn, negative until then */
+	FORCEINLINE double GetStartupSeconds() const { return StartupSeconds; }
+
+	/** Returns the estimated memory held by the loaded manifests */
+	FORCEINLINE int64 GetResidentBytes() const { return ResidentBytes; }
+
+private:
+
+	/** Record the metrics of a manifest whose load completed */
+	void OnRequestLoaded(FName Name, FStreamableDelegate OnLoaded);
+
+	/** Manifests requested, by name */
+	TMap<FName, FLylatDragoonStreamingRequest> Requests;
+
+	/** Estimated memory held by the loaded manifests */
+	int64 ResidentBytes;
+
+	/** Highest value of ResidentBytes */
+	int64 PeakResidentBytes;
+
+	/** Total time spent waiting for manifests (in seconds) and the number of manifests loaded */
+	double TotalLoadSeconds;
+	int32 LoadedRequestCount;
+
+	/** Time from startup to the first controllable frame, negative until then */
+	double StartupSeconds;
+};
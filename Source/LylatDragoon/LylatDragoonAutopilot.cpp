@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonAutopilot.h"
+
+#include "LylatDragoonPawn.h"
+
+FLylatDragoonAutopilot::FLylatDragoonAutopilot()
+	: FireRate(8.0f)
+	, ElapsedTime(0.0f)
+	, FireCooldown(0.0f)
+{
+}
+
+void FLylatDragoonAutopilot::Update(ALylatDragoonPawn* Pawn, float DeltaTime)
+{
+	if (!Pawn)
+	{
+		return;
+	}
+
+	ElapsedTime += DeltaTime;
+
+	// Slow weave on both axes, so the pawn sweeps the whole area around the course
+	Pawn->MoveRightInput(FMath::Sin(ElapsedTime * 0.7f));
+	Pawn->MoveUpInput(FMath::Sin(ElapsedTime * 0.45f + 1.0f));
+
+	// Thrust for a few seconds, then cruise, then brake
+	const int32 ThrustPhase = FMath::FloorToInt(ElapsedTime / 4.0f) % 3;
+	Pawn->ThrustInput(ThrustPhase == 0 ? 1.0f : ThrustPhase == 2 ? -1.0f : 0.0f);
+
+	FireCooldown -= DeltaTime;
+	while (FireCooldown <= 0.0f && FireRate > 0.0f)
+	{
+		Pawn->FireInput();
+		FireCooldown += 1.0f / FireRate;
+	}
+}
@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ * Scripted pilot used for the soak tests. It weaves around the course, thrusts and brakes in turns and fires
+ * continuously, feeding the same input callbacks the player input component calls.
+ */
+struct FLylatDragoonAutopilot
+{
+	FLylatDragoonAutopilot();
+
+	/** Shots per second */
+	float FireRate;
+
+	/** Feed the input of this frame to the pawn */
+	void Update(class ALylatDragoonPawn* Pawn, float DeltaTime);
+
+private:
+
+	/** Time since the autopilot started (in seconds) */
+	float ElapsedTime;
+
+	/** Time until the next shot (in seconds) */
+	float FireCooldown;
+};
@@ -0,0 +1,335 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonBoundingVolumeHierarchy.h"
+
+FLylatDragoonBoundingVolumeHierarchy::FLylatDragoonBoundingVolumeHierarchy()
+{
+}
+
+void FLylatDragoonBoundingVolumeHierarchy::Build(TArrayView<const FVector> Centers, TArrayView<const float> Radii)
+{
+	check(Centers.Num() == Radii.Num());
+
+	ResetSpheres(Centers.Num());
+	SphereCenters.Append(Centers.GetData(), Centers.Num());
+	SphereRadii.Append(Radii.GetData(), Radii.Num());
+
+	Build();
+}
+
+void FLylatDragoonBoundingVolumeHierarchy::Refit(TArrayView<const FVector> Centers, TArrayView<const float> Radii)
+{
+	check(Centers.Num() == SphereIndices.Num() && Radii.Num() == SphereIndices.Num());
+
+	ResetSpheres(Centers.Num());
+	SphereCenters.Append(Centers.GetData(), Centers.Num());
+	SphereRadii.Append(Radii.GetData(), Radii.Num());
+
+	Refit();
+}
+
+void FLylatDragoonBoundingVolumeHierarchy::ResetSpheres(int32 Count)
+{
+	// Reset keeps the memory, assigning arrays of another size would reallocate them
+	SphereCenters.Reset(Count);
+	SphereRadii.Reset(Count);
+}
+
+void FLylatDragoonBoundingVolumeHierarchy::Build()
+{
+	check(SphereCenters.Num() == SphereRadii.Num());
+
+	SphereIndices.SetNumUninitialized(SphereCenters.Num(), false);
+	for (int32 Index = 0; Index < SphereIndices.Num(); ++Index)
+	{
+		SphereIndices[Index] = Index;
+	}
+
+	Nodes.Reset();
+	if (SphereIndices.Num() == 0)
+	{
+		return;
+	}
+	// Leaves hold at least half of MaxLeafSize spheres, so there are never more nodes than spheres
+	Nodes.Reserve(SphereIndices.Num());
+
+	// Ranges of spheres still to split and the node they belong to
+	struct FPendingRange
+	{
+		int32 NodeIndex;
+		int32 First;
+		int32 Count;
+	};
+	TArray<FPendingRange, TInlineAllocator<64>> Pending;
+
+	Nodes.AddUninitialized();
+	Pending.Add({ 0, 0, SphereIndices.Num() });
+
+	while (Pending.Num() > 0)
+	{
+		const FPendingRange Range = Pending.Pop(false);
+
+		if (Range.Count <= MaxLeafSize)
+		{
+			Nodes[Range.NodeIndex].FirstIndex = Range.First;
+			Nodes[Range.NodeIndex].Count = Range.Count;
+			continue;
+		}
+
+		// Split at the median of the axis where the centers are most spread
+		FBox CenterBounds(ForceInit);
+		for (int32 Index = Range.First; Index < Range.First + Range.Count; ++Index)
+		{
+			CenterBounds += SphereCenters[SphereIndices[Index]];
+		}
+		const FVector Extent = CenterBounds.GetExtent();
+		const int32 Axis = (Extent.X >= Extent.Y && Extent.X >= Extent.Z) ? 0 : (Extent.Y >= Extent.Z ? 1 : 2);
+
+		const TArray<FVector>& SortCenters = SphereCenters;
+		Sort(SphereIndices.GetData() + Range.First, Range.Count, [&SortCenters, Axis](int32 A, int32 B) { return SortCenters[A][Axis] < SortCenters[B][Axis]; });
+
+		const int32 FirstChild = Nodes.AddUninitialized(2);
+		Nodes[Range.NodeIndex].FirstIndex = FirstChild;
+		Nodes[Range.NodeIndex].Count = 0;
+
+		const int32 LeftCount = Range.Count / 2;
+		Pending.Add({ FirstChild, Range.First, LeftCount });
+		Pending.Add({ FirstChild + 1, Range.First + LeftCount, Range.Count - LeftCount });
+	}
+
+	Refit();
+}
+
+void FLylatDragoonBoundingVolumeHierarchy::Refit()
+{
+	check(SphereCenters.Num() == SphereIndices.Num() && SphereRadii.Num() == SphereIndices.Num());
+
+	// Children always come after their parent, so going backwards every child is updated before its parent
+	for (int32 NodeIndex = Nodes.Num() - 1; NodeIndex >= 0; --NodeIndex)
+	{
+		FNode& Node = Nodes[NodeIndex];
+		if (Node.Count > 0)
+		{
+			const int32 FirstSphere = SphereIndices[Node.FirstIndex];
+			Node.Min = SphereCenters[FirstSphere] - FVector(SphereRadii[FirstSphere]);
+			Node.Max = SphereCenters[FirstSphere] + FVector(SphereRadii[FirstSphere]);
+			for (int32 Index = Node.FirstIndex + 1; Index < Node.FirstIndex + Node.Count; ++Index)
+			{
+				const int32 Sphere = SphereIndices[Index];
+				Node.Min = Node.Min.ComponentMin(SphereCenters[Sphere] - FVector(SphereRadii[Sphere]));
+				Node.Max = Node.Max.ComponentMax(SphereCenters[Sphere] + FVector(SphereRadii[Sphere]));
+			}
+		}
+		else
+		{
+			const FNode& Left = Nodes[Node.FirstIndex];
+			const FNode& Right = Nodes[Node.FirstIndex + 1];
+			Node.Min = Left.Min.ComponentMin(Right.Min);
+			Node.Max = Left.Max.ComponentMax(Right.Max);
+		}
+	}
+}
+
+int32 FLylatDragoonBoundingVolumeHierarchy::QueryCone(const FVector& Origin, const FVector& Direction, float HalfAngleRadians, float MaxDistance, TArray<FLylatDragoonConeHit>& OutHits) const
+{
+	if (Nodes.Num() == 0)
+	{
+		return 0;
+	}
+
+	float SinHalfAngle;
+	float CosHalfAngle;
+	FMath::SinCos(&SinHalfAngle, &CosHalfAngle, HalfAngleRadians);
+
+	int32 VisitedNodes = 0;
+
+	TArray<int32, TInlineAllocator<64>> Stack;
+	Stack.Add(0);
+
+	while (Stack.Num() > 0)
+	{
+		const FNode& Node = Nodes[Stack.Pop(false)];
+		VisitedNodes++;
+
+		// Nodes are culled with the sphere around their box
+		const FVector NodeCenter = (Node.Min + Node.Max) * 0.5f;
+		const float NodeRadius = (Node.Max - NodeCenter).Size();
+		float Distance;
+		float CosAngle;
+		if (!SphereTouchesCone(Origin, Direction, CosHalfAngle, SinHalfAngle, MaxDistance, NodeCenter, NodeRadius, Distance, CosAngle))
+		{
+			continue;
+		}
+
+		if (Node.Count > 0)
+		{
+			for (int32 Index = Node.FirstIndex; Index < Node.FirstIndex + Node.Count; ++Index)
+			{
+				const int32 Sphere = SphereIndices[Index];
+				if (SphereTouchesCone(Origin, Direction, CosHalfAngle, SinHalfAngle, MaxDistance, SphereCenters[Sphere], SphereRadii[Sphere], Distance, CosAngle))
+				{
+					OutHits.Add({ Sphere, Distance, CosAngle });
+				}
+			}
+		}
+		else
+		{
+			Stack.Add(Node.FirstIndex);
+			Stack.Add(Node.FirstIndex + 1);
+		}
+	}
+
+	return VisitedNodes;
+}
+
+void FLylatDragoonBoundingVolumeHierarchy::QueryConeBruteForce(const FVector& Origin, const FVector& Direction, float HalfAngleRadians, float MaxDistance, TArray<FLylatDragoonConeHit>& OutHits) const
+{
+	float SinHalfAngle;
+	float CosHalfAngle;
+	FMath::SinCos(&SinHalfAngle, &CosHalfAngle, HalfAngleRadians);
+
+	for (int32 Sphere = 0; Sphere < SphereCenters.Num(); ++Sphere)
+	{
+		float Distance;
+		float CosAngle;
+		if (SphereTouchesCone(Origin, Direction, CosHalfAngle, SinHalfAngle, MaxDistance, SphereCenters[Sphere], SphereRadii[Sphere], Distance, CosAngle))
+		{
+			OutHits.Add({ Sphere, Distance, CosAngle });
+		}
+	}
+}
+
+bool FLylatDragoonBoundingVolumeHierarchy::SphereTouchesCone(const FVector& Origin, const FVector& Direction, float CosHalfAngle, float SinHalfAngle, float MaxDistance, const FVector& Center, float Radius, float& OutDistance, float& OutCosAngle)
+{
+	const FVector ToCenter = Center - Origin;
+	const float DistanceSquared = ToCenter.SizeSquared();
+
+	// The apex is inside the sphere
+	if (DistanceSquared <= Radius * Radius)
+	{
+		OutDistance = FMath::Sqrt(DistanceSquared);
+		OutCosAngle = 1.0f;
+		return true;
+	}
+
+	const float Distance = FMath::Sqrt(DistanceSquared);
+	if (Distance - Radius > MaxDistance)
+	{
+		return false;
+	}
+
+	const float CosAngle = FVector::DotProduct(ToCenter, Direction) / Distance;
+	OutDistance = Distance;
+	OutCosAngle = CosAngle;
+	if (CosAngle >= CosHalfAngle)
+	{
+		return true;
+	}
+
+	// The sphere touches the cone if the angle to its center minus the angle it covers is within the half angle:
+	// cos(Angle - SphereAngle) >= cos(HalfAngle)
+	const float SinSphereAngle = Radius / Distance;
+	const float CosSphereAngle = FMath::Sqrt(FMath::Max(1.0f - SinSphereAngle * SinSphereAngle, 0.0f));
+	if (CosSphereAngle <= CosAngle)
+	{
+		// The axis goes through the sphere
+		return true;
+	}
+	const float SinAngle = FMath::Sqrt(FMath::Max(1.0f - CosAngle * CosAngle, 0.0f));
+	return CosAngle * CosSphereAngle + SinAngle * SinSphereAngle >= CosHalfAngle;
+}
+
+/** Returns true if both queries found the same spheres */
+static bool SameConeHits(TArray<FLylatDragoonConeHit>& Hits, TArray<FLylatDragoonConeHit>& ReferenceHits)
+{
+	if (Hits.Num() != ReferenceHits.Num())
+	{
+		return false;
+	}
+
+	Hits.Sort([](const FLylatDragoonConeHit& A, const FLylatDragoonConeHit& B) { return A.Index < B.Index; });
+	for (int32 Index = 0; Index < Hits.Num(); ++Index)
+	{
+		if (Hits[Index].Index != ReferenceHits[Index].Index)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void CheckConeQuery(const TArray<FString>& Args)
+{
+	const int32 MaxSphereCount = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 700;
+	const int32 SetCount = 200;
+	const int32 QueriesPerSet = 50;
+
+	FRandomStream Random(0x4C594C41);
+	FLylatDragoonBoundingVolumeHierarchy Hierarchy;
+	TArray<FVector> Centers;
+	TArray<float> Radii;
+	TArray<FLylatDragoonConeHit> Hits;
+	TArray<FLylatDragoonConeHit> ReferenceHits;
+	int32 QueryCount = 0;
+	int32 HitCount = 0;
+	int32 MismatchCount = 0;
+
+	for (int32 Set = 0; Set < SetCount; ++Set)
+	{
+		// Spheres in front of the pawn like the enemies, the half of the sets are moved and refit before the queries
+		const int32 SphereCount = Random.RandRange(0, MaxSphereCount);
+		Centers.Reset();
+		Radii.Reset();
+		for (int32 Index = 0; Index < SphereCount; ++Index)
+		{
+			Centers.Add(FVector(Random.FRandRange(-2000.0f, 30000.0f), Random.FRandRange(-8000.0f, 8000.0f), Random.FRandRange(-4000.0f, 4000.0f)));
+			Radii.Add(Random.FRandRange(10.0f, 400.0f));
+		}
+		Hierarchy.Build(Centers, Radii);
+
+		if (Set % 2 == 1)
+		{
+			for (FVector& Center : Centers)
+			{
+				Center += Random.GetUnitVector() * Random.FRandRange(0.0f, 3000.0f);
+			}
+			Hierarchy.Refit(Centers, Radii);
+		}
+
+		for (int32 Query = 0; Query < QueriesPerSet; ++Query)
+		{
+			const FVector Origin = Random.GetUnitVector() * Random.FRandRange(0.0f, 1000.0f);
+			const FVector Direction = (FVector::ForwardVector + Random.GetUnitVector() * 0.5f).GetSafeNormal();
+			const float HalfAngle = FMath::DegreesToRadians(Random.FRandRange(1.0f, 60.0f));
+			const float MaxDistance = Random.FRandRange(1000.0f, 40000.0f);
+
+			Hits.Reset();
+			ReferenceHits.Reset();
+			Hierarchy.QueryCone(Origin, Direction, HalfAngle, MaxDistance, Hits);
+			Hierarchy.QueryConeBruteForce(Origin, Direction, HalfAngle, MaxDistance, ReferenceHits);
+
+			QueryCount++;
+			HitCount += ReferenceHits.Num();
+			if (!SameConeHits(Hits, ReferenceHits))
+			{
+				MismatchCount++;
+				UE_LOG(LogFlying, Warning, TEXT("Cone query on %d spheres found %d of them, %d expected"), SphereCount, Hits.Num(), ReferenceHits.Num());
+			}
+		}
+	}
+
+	if (MismatchCount == 0)
+	{
+		UE_LOG(LogFlying, Display, TEXT("Cone query: %d queries on sets of up to %d spheres found the same %d hits as testing every sphere. Passed"), QueryCount, MaxSphereCount, HitCount);
+	}
+	else
+	{
+		UE_LOG(LogFlying, Error, TEXT("Cone query: %d of %d queries on sets of up to %d spheres differ from testing every sphere. Failed"), MismatchCount, QueryCount, MaxSphereCount);
+	}
+}
+
+static FAutoConsoleCommand CheckConeQueryCommand(
+	TEXT("LylatDragoon.CheckConeQuery"),
+	TEXT("Run random cone queries on random sets of up to the given number of spheres (700 by default), built and refit, and check the tree finds the same spheres as testing every sphere."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&CheckConeQuery));
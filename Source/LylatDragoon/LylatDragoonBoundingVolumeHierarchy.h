@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Containers/ArrayView.h"
+
+/** Sphere found by a cone query */
+struct FLylatDragoonConeHit
+{
+	/** Index of the sphere */
+	int32 Index;
+
+	/** Distance from the origin of the cone to the center of the sphere */
+	float Distance;
+
+	/** Cosine of the angle between the axis of the cone and the direction to the center of the sphere */
+	float CosAngle;
+};
+
+/**
+ * Binary tree of axis aligned boxes over a set of spheres. The tree is only built again when the set of spheres
+ * changes, when they just move the boxes are refit bottom-up keeping the same tree.
+ */
+class LYLATDRAGOON_API FLylatDragoonBoundingVolumeHierarchy
+{
+public:
+
+	FLylatDragoonBoundingVolumeHierarchy();
+
+	/** Build the tree for the given spheres. Centers and radii must have the same number of elements */
+	void Build(TArrayView<const FVector> Centers, TArrayView<const float> Radii);
+
+	/** Update the boxes of the tree with the new location of the spheres it was built with */
+	void Refit(TArrayView<const FVector> Centers, TArrayView<const float> Radii);
+
+	/** Remove the spheres, keeping their memory, before adding the ones of the next build or refit */
+	void ResetSpheres(int32 Count);
+
+	/** Add a sphere for the next build or refit, so the spheres are written in place without a copy */
+	FORCEINLINE void AddSphere(const FVector& Center, float Radius)
+	{
+		SphereCenters.Add(Center);
+		SphereRadii.Add(Radius);
+	}
+
+	/** Build the tree for the spheres added since the last reset */
+	void Build();
+
+	/** Update the boxes of the tree with the spheres added since the last reset, as many as it was built with */
+	void Refit();
+
+	/**
+	 * Find every sphere touching the cone with the apex at Origin, the given unit axis and half angle, up to MaxDistance.
+	 * The hits are added to OutHits unsorted. Returns the number of nodes visited.
+	 */
+	int32 QueryCone(const FVector& Origin, const FVector& Direction, float HalfAngleRadians, float MaxDistance, TArray<FLylatDragoonConeHit>& OutHits) const;
+
+	/** Same as QueryCone testing every sphere, the reference the tree is checked against */
+	void QueryConeBruteForce(const FVector& Origin, const FVector& Direction, float HalfAngleRadians, float MaxDistance, TArray<FLylatDragoonConeHit>& OutHits) const;
+
+	FORCEINLINE int32 Num() const { return SphereCenters.Num(); }
+
+private:
+
+	/** Maximum number of spheres stored in a leaf */
+	static const int32 MaxLeafSize = 4;
+
+	struct FNode
+	{
+		FVector Min;
+		FVector Max;
+		/** For leaves the first entry in SphereIndices, otherwise the first child. The second child is the next node */
+		int32 FirstIndex;
+		/** Number of spheres for leaves, zero for the other nodes */
+		int32 Count;
+	};
+
+	/** Sphere-cone test. Works with the cosine and sine of the half angle of the cone */
+	static bool SphereTouchesCone(const FVector& Origin, const FVector& Direction, float CosHalfAngle, float SinHalfAngle, float MaxDistance, const FVector& Center, float Radius, float& OutDistance, float& OutCosAngle);
+
+	/** Nodes in depth-first order, so every parent comes before its children */
+	TArray<FNode> Nodes;
+
+	/** Sphere indices sorted by leaf */
+	TArray<int32> SphereIndices;
+
+	TArray<FVector> SphereCenters;
+	TArray<float> SphereRadii;
+};
@@ -0,0 +1,354 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonBulletField.h"
+
+#include "LylatDragoonBulletPattern.h"
+#include "LylatDragoonDamageQueue.h"
+#include "LylatDragoonGameMode.h"
+#include "LylatDragoonPawn.h"
+
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/StaticMesh.h"
+#include "EngineUtils.h"
+
+static TAutoConsoleVariable<int32> CVarShowBullets(
+	TEXT("LylatDragoon.ShowBullets"),
+	0,
+	TEXT("Show on screen the number of enemy bullets and emitters and the time spent simulating and drawing them."));
+
+// Sets default values
+ALylatDragoonBulletField::ALylatDragoonBulletField()
+{
+ 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
+	PrimaryActorTick.bCanEverTick = true;
+	// Fire from where the enemies and the players were moved to in this frame
+	PrimaryActorTick.TickGroup = TG_PostPhysics;
+
+	BulletInstances = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("BulletInstances0"));
+	BulletInstances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	BulletInstances->SetMobility(EComponentMobility::Movable);
+	BulletInstances->CastShadow = false;
+	RootComponent = BulletInstances;
+
+	BulletMeshAsset = TSoftObjectPtr<UStaticMesh>(FSoftObjectPath(TEXT("/Engine/BasicShapes/Sphere.Sphere")));
+	BulletScale = 0.3f;
+	BulletDamage = 5.0f;
+	BulletLifeTime = 4.0f;
+	HitRadius = 100.0f;
+	MaxBullets = 8192;
+	Seed = 0;
+
+	VisibleInstanceCount = 0;
+	UpdateTimeMs = 0.0f;
+	VisualsTimeMs = 0.0f;
+}
+
+void ALylatDragoonBulletField::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// The default mesh is an engine shape, which is always loaded
+	BulletInstances->SetStaticMesh(BulletMeshAsset.LoadSynchronous());
+
+	Simulation.BulletLifeTime = BulletLifeTime;
+	Simulation.HitRadius = HitRadius;
+	Simulation.MaxBullets = MaxBullets;
+	Simulation.Seed = Seed;
+	Simulation.Reserve(MaxBullets);
+	InstanceTransforms.Reserve(MaxBullets);
+}
+
+// Called every frame
+void ALylatDragoonBulletField::Tick( float DeltaTime )
+{
+	Super::Tick( DeltaTime );
+
+	{
+		LYLATDRAGOON_SCOPE_CYCLE_COUNTER(BulletSimulation);
+
+		const double StartTime = FPlatformTime::Seconds();
+
+		UpdateSources();
+		Simulation.Update(DeltaTime);
+		QueueHits();
+
+		UpdateTimeMs = (float)((FPlatformTime::Seconds() - StartTime) * 1000.0);
+	}
+
+	{
+		const double StartTime = FPlatformTime::Seconds();
+
+		UpdateVisuals();
+
+		VisualsTimeMs = (float)((FPlatformTime::Seconds() - StartTime) * 1000.0);
+	}
+
+	LYLATDRAGOON_SET_COUNTER(EnemyBullets, GetBulletCount());
+
+	if (CVarShowBullets.GetValueOnGameThread() != 0 && GEngine)
+	{
+		GEngine->AddOnScreenDebugMessage((uint64)GetUniqueID(), 0.0f, FColor::Yellow, FString::Printf(TEXT("Enemy bullets: %d, emitters: %d, dropped: %d, simulation: %.3f ms, visuals: %.3f ms"),
+			GetBulletCount(), Simulation.GetEmitterCount(), Simulation.GetDroppedBulletCount(), UpdateTimeMs, VisualsTimeMs));
+	}
+}
+
+void ALylatDragoonBulletField::ApplyWorldOffset(const FVector& InOffset, bool bWorldShift)
+{
+	Super::ApplyWorldOffset(InOffset, bWorldShift);
+
+	// The component is moved by the engine, the simulated positions are not
+	Simulation.ApplyWorldOffset(InOffset);
+}
+
+int32 ALylatDragoonBulletField::StartPattern(ULylatDragoonBulletPattern* Pattern, AActor* SourceActor)
+{
+	int32 Program;
+	int32 Source;
+	if (!AddPatternSource(Pattern, SourceActor, Program, Source))
+	{
+		return 0;
+	}
+
+	return Simulation.StartEmitter(Program, Source);
+}
+
+void ALylatDragoonBulletField::StartPattern(ULylatDragoonBulletPattern* Pattern, AActor* SourceActor, int32 EmitterSeed, float ElapsedTime)
+{
+	int32 Program;
+	int32 Source;
+	if (!AddPatternSource(Pattern, SourceActor, Program, Source))
+	{
+		return;
+	}
+
+	// The bullets fired before that have expired on the server too
+	Simulation.StartEmitter(Program, Source, EmitterSeed, FMath::Clamp(ElapsedTime, 0.0f, BulletLifeTime));
+}
+
+bool ALylatDragoonBulletField::AddPatternSource(ULylatDragoonBulletPattern* Pattern, AActor* SourceActor, int32& OutProgram, int32& OutSource)
+{
+	OutProgram = Simulation.AddPattern(Pattern);
+	if (OutProgram == INDEX_NONE)
+	{
+		return false;
+	}
+	Patterns.AddUnique(Pattern);
+
+	if (const int32* ExistingSource = ActorSources.Find(SourceActor))
+	{
+		OutSource = *ExistingSource;
+	}
+	else
+	{
+		OutSource = Simulation.AddSource(SourceActor->GetActorLocation(), SourceActor->GetActorForwardVector());
+		if (OutSource >= SourceActors.Num())
+		{
+			SourceActors.SetNum(OutSource + 1);
+		}
+		SourceActors[OutSource] = SourceActor;
+		ActorSources.Add(SourceActor, OutSource);
+	}
+	return true;
+}
+
+void ALylatDragoonBulletField::UpdateSources()
+{
+	for (int32 Source = 0; Source < SourceActors.Num(); ++Source)
+	{
+		TWeakObjectPtr<AActor>& SourceActor = SourceActors[Source];
+		if (AActor* Actor = SourceActor.Get())
+		{
+			Simulation.SetSource(Source, Actor->GetActorLocation(), Actor->GetActorForwardVector());
+		}
+		else if (SourceActor.IsStale())
+		{
+			// The bullets already fired keep flying
+			Simulation.RemoveSource(Source);
+			ActorSources.Remove(SourceActor);
+			SourceActor.Reset();
+		}
+	}
+
+	// Aim at every player, the simulation doesn't know about them. The pawns are iterated rather than the
+	// controllers, which the clients only have for their own player, and the server skips the unpossessed ones
+	Simulation.Targets.Reset();
+	TargetPawns.Reset();
+	for (TActorIterator<ALylatDragoonPawn> It(GetWorld()); It; ++It)
+	{
+		if (It->GetController() || !It->HasAuthority())
+		{
+			Simulation.Targets.Add(It->GetActorLocation());
+			TargetPawns.Add(*It);
+		}
+	}
+}
+
+void ALylatDragoonBulletField::QueueHits()
+{
+	ALylatDragoonGameMode* GameMode = GetWorld()->GetAuthGameMode<ALylatDragoonGameMode>();
+	if (!GameMode)
+	{
+		return;
+	}
+
+	for (int32 TargetIndex = 0; TargetIndex < TargetPawns.Num(); ++TargetIndex)
+	{
+		const int32 Hits = Simulation.TargetHits[TargetIndex];
+		if (Hits > 0)
+		{
+			GameMode->GetDamageQueue()->QueueDamage(TargetPawns[TargetIndex], this, nullptr, Hits * BulletDamage, ELylatDragoonDamageKind::Projectile);
+		}
+	}
+}
+
+void ALylatDragoonBulletField::UpdateVisuals()
+{
+	LYLATDRAGOON_SCOPE_CYCLE_COUNTER(BulletVisuals);
+
+	if (!BulletInstances->GetStaticMesh())
+	{
+		return;
+	}
+
+	VisibleInstanceCount = UpdateBulletInstances(BulletInstances, Simulation.GetBullets(), BulletScale, VisibleInstanceCount, InstanceTransforms);
+}
+
+int32 ALylatDragoonBulletField::UpdateBulletInstances(UInstancedStaticMeshComponent* Instances, const FLylatDragoonProjectileBuffer& Bullets, float Scale, int32 VisibleInstanceCount, TArray<FTransform>& Transforms)
+{
+	// Instances are only added, the ones left over are scaled to nothing so the count never shrinks
+	while (Instances->GetInstanceCount() < Bullets.Num())
+	{
+		Instances->AddInstanceWorldSpace(FTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector));
+	}
+
+	// The instances are relative to the component, which only moves with the world origin
+	const FVector ComponentLocation = Instances->GetComponentLocation();
+	const FVector BulletScale3D(Scale);
+	Transforms.Reset();
+	for (int32 Index = 0; Index < Bullets.Num(); ++Index)
+	{
+		Transforms.Emplace(FQuat::Identity, Bullets.GetPosition(Index) - ComponentLocation, BulletScale3D);
+	}
+
+	// Send the whole batch to the render state once
+	if (Bullets.Num() > 0)
+	{
+		Instances->BatchUpdateInstancesTransforms(0, Transforms, false, false, true);
+	}
+	if (VisibleInstanceCount > Bullets.Num())
+	{
+		Instances->BatchUpdateInstancesTransform(Bullets.Num(), VisibleInstanceCount - Bullets.Num(), FTransform(FQuat::Identity, FVector::ZeroVector, FVector::ZeroVector), false, false, true);
+	}
+	if (Bullets.Num() > 0 || VisibleInstanceCount > 0)
+	{
+		Instances->MarkRenderStateDirty();
+	}
+
+	return Bullets.Num();
+}
+
+static ULylatDragoonBulletPattern* NewBenchmarkPattern(const TArray<FLylatDragoonBulletOp>& Ops)
+{
+	ULylatDragoonBulletPattern* Pattern = NewObject<ULylatDragoonBulletPattern>(GetTransientPackage());
+	Pattern->Ops = Ops;
+	return Pattern;
+}
+
+static void BenchmarkBulletPatterns(const TArray<FString>& Args, UWorld* World)
+{
+	const int32 EmitterCount = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 40;
+	const int32 FrameCount = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 1200;
+	const float DeltaTime = 1.0f / 60.0f;
+
+	typedef ELylatDragoonBulletOp EOp;
+	typedef FLylatDragoonBulletOp FOp;
+
+	// A four arm spiral, an aimed burst with random jitter, and a fan which emits a nested burst from every arm
+	ULylatDragoonBulletPattern* Spiral = NewBenchmarkPattern({ FOp(EOp::Face), FOp(EOp::Spread, 30.0f), FOp(EOp::Speed, 2500.0f),
+		FOp(EOp::Repeat, 0.0f, 0), FOp(EOp::Repeat, 0.0f, 4), FOp(EOp::Fire), FOp(EOp::Turn, 90.0f), FOp(EOp::EndRepeat), FOp(EOp::Turn, 11.0f), FOp(EOp::Wait, 0.05f), FOp(EOp::EndRepeat) });
+	ULylatDragoonBulletPattern* AimedBurst = NewBenchmarkPattern({ FOp(EOp::Speed, 4000.0f), FOp(EOp::Spread, 2.0f),
+		FOp(EOp::Repeat, 0.0f, 0), FOp(EOp::Aim), FOp(EOp::Repeat, 0.0f, 5), FOp(EOp::RandomTurn, 180.0f), FOp(EOp::Fire), FOp(EOp::Wait, 0.04f), FOp(EOp::EndRepeat), FOp(EOp::Wait, 0.3f), FOp(EOp::EndRepeat) });
+	ULylatDragoonBulletPattern* FanBurst = NewBenchmarkPattern({ FOp(EOp::Spread, 5.0f), FOp(EOp::Repeat, 0.0f, 3), FOp(EOp::Fire), FOp(EOp::Turn, 120.0f), FOp(EOp::Wait, 0.1f), FOp(EOp::EndRepeat) });
+	ULylatDragoonBulletPattern* Fan = NewBenchmarkPattern({ FOp(EOp::Face), FOp(EOp::Speed, 2000.0f),
+		FOp(EOp::Repeat, 0.0f, 0), FOp(EOp::Angle, 0.0f), FOp(EOp::Spread, 40.0f), FOp(EOp::Repeat, 0.0f, 6), FOp(EOp::Emit, 0.0f, 0, FanBurst), FOp(EOp::Turn, 60.0f), FOp(EOp::EndRepeat), FOp(EOp::Wait, 0.5f), FOp(EOp::EndRepeat) });
+
+	FLylatDragoonBulletSimulation Simulation;
+	Simulation.Targets.Add(FVector::ZeroVector);
+	Simulation.Reserve(Simulation.MaxBullets);
+
+	const int32 Programs[] = { Simulation.AddPattern(Spiral), Simulation.AddPattern(AimedBurst), Simulation.AddPattern(Fan) };
+	for (int32 EmitterIndex = 0; EmitterIndex < EmitterCount; ++EmitterIndex)
+	{
+		// Spread the emitters on a ring in front of the target, facing it
+		const FVector Location = FRotator(0.0f, 0.0f, 360.0f * EmitterIndex / EmitterCount).RotateVector(FVector(20000.0f, 0.0f, 3000.0f));
+		const int32 Source = Simulation.AddSource(Location, FVector(-1.0f, 0.0f, 0.0f));
+		Simulation.StartEmitter(Programs[EmitterIndex % ARRAY_COUNT(Programs)], Source);
+	}
+
+	// The bullets are drawn by a component of the world like the one of the bullet field, its render state is
+	// recreated every frame so the upload is part of the time
+	UInstancedStaticMeshComponent* Instances = nullptr;
+	if (World)
+	{
+		Instances = NewObject<UInstancedStaticMeshComponent>(GetTransientPackage());
+		Instances->SetMobility(EComponentMobility::Movable);
+		Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		Instances->SetStaticMesh(LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Sphere.Sphere")));
+		Instances->RegisterComponentWithWorld(World);
+	}
+	TArray<FTransform> Transforms;
+	Transforms.Reserve(Simulation.MaxBullets);
+	int32 VisibleInstanceCount = 0;
+
+	double TotalSeconds = 0.0;
+	double WorstSeconds = 0.0;
+	double TotalVisualsSeconds = 0.0;
+	double WorstVisualsSeconds = 0.0;
+	int32 MeasuredFrames = 0;
+	int64 TotalBullets = 0;
+	int32 Hits = 0;
+	for (int32 Frame = 0; Frame < FrameCount; ++Frame)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		Simulation.Update(DeltaTime);
+		const double FrameSeconds = FPlatformTime::Seconds() - StartTime;
+		Hits += Simulation.TargetHits[0];
+
+		double VisualsSeconds = 0.0;
+		if (Instances)
+		{
+			const double VisualsStartTime = FPlatformTime::Seconds();
+			VisibleInstanceCount = ALylatDragoonBulletField::UpdateBulletInstances(Instances, Simulation.GetBullets(), 0.3f, VisibleInstanceCount, Transforms);
+			Instances->DoDeferredRenderUpdates_Concurrent();
+			VisualsSeconds = FPlatformTime::Seconds() - VisualsStartTime;
+		}
+
+		// Skip the frames filling the field up to the steady state
+		if (Frame >= FrameCount / 4)
+		{
+			TotalSeconds += FrameSeconds;
+			WorstSeconds = FMath::Max(WorstSeconds, FrameSeconds);
+			TotalVisualsSeconds += VisualsSeconds;
+			WorstVisualsSeconds = FMath::Max(WorstVisualsSeconds, VisualsSeconds);
+			TotalBullets += Simulation.GetBullets().Num();
+			++MeasuredFrames;
+		}
+	}
+
+	UE_LOG(LogFlying, Display, TEXT("Bullet patterns: %d emitters, %lld bullets on average (%d at the end, %d dropped, %d hits), %.3f ms per frame on average, %.3f ms at worst"),
+		Simulation.GetEmitterCount(), TotalBullets / FMath::Max(MeasuredFrames, 1), Simulation.GetBullets().Num(), Simulation.GetDroppedBulletCount(), Hits,
+		TotalSeconds * 1000.0 / FMath::Max(MeasuredFrames, 1), WorstSeconds * 1000.0);
+	if (Instances)
+	{
+		UE_LOG(LogFlying, Display, TEXT("Bullet visuals: %.3f ms per frame on average, %.3f ms at worst"),
+			TotalVisualsSeconds * 1000.0 / FMath::Max(MeasuredFrames, 1), WorstVisualsSeconds * 1000.0);
+		Instances->DestroyComponent();
+	}
+}
+
+static FAutoConsoleCommandWithWorldAndArgs BenchmarkBulletPatternsCommand(
+	TEXT("LylatDragoon.BenchBulletPatterns"),
+	TEXT("Run spiral, aimed and nested fan patterns from the given number of emitters (40 by default) for the given number of frames (1200 by default), draw the bullets in the world, and log the time per frame of the simulation and of the visuals."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&BenchmarkBulletPatterns));
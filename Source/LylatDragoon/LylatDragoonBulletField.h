@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "GameFramework/Actor.h"
+#include "LylatDragoonBulletSimulation.h"
+#include "LylatDragoonBulletField.generated.h"
+
+/**
+ * Fires the bullet patterns of the enemies and draws their bullets. The bullets are not actors: they live in the
+ * buffers of a bullet simulation, and are drawn as the instances of a single component updated once per frame.
+ * Every enemy firing a pattern is a source of the simulation, moved with the enemy and removed when it dies.
+ * The bullet field of the game mode hits the players on the server. The clients run their own for display only,
+ * starting the emitters of the server with their seed so they fire the same bullets.
+ */
+UCLASS(notplaceable)
+class LYLATDRAGOON_API ALylatDragoonBulletField : public AActor
+{
+	GENERATED_BODY()
+
+	/** Draws one instance per bullet */
+	UPROPERTY(Category = Mesh, VisibleDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	class UInstancedStaticMeshComponent* BulletInstances;
+
+public:
+	// Sets default values for this actor's properties
+	ALylatDragoonBulletField();
+
+	// Called when the game starts or when spawned
+	virtual void BeginPlay() override;
+
+	// Called every frame
+	virtual void Tick( float DeltaSeconds ) override;
+
+	// Called when the world origin is rebased
+	virtual void ApplyWorldOffset(const FVector& InOffset, bool bWorldShift) override;
+
+	/** Mesh of the bullets */
+	UPROPERTY(Category = Mesh, EditDefaultsOnly)
+	TSoftObjectPtr<UStaticMesh> BulletMeshAsset;
+
+	/** Scale of the bullet mesh */
+	UPROPERTY(Category = Mesh, EditDefaultsOnly)
+	float BulletScale;
+
+	/** Damage of every bullet hitting a player */
+	UPROPERTY(Category = Combat, EditDefaultsOnly)
+	float BulletDamage;
+
+	/** Time the bullets stay in flight */
+	UPROPERTY(Category = Combat, EditDefaultsOnly)
+	float BulletLifeTime;
+
+	/** Distance between a bullet and the center of a player for a hit */
+	UPROPERTY(Category = Combat, EditDefaultsOnly)
+	float HitRadius;
+
+	/** Bullets fired when this many are in flight are dropped */
+	UPROPERTY(Category = Combat, EditDefaultsOnly)
+	int32 MaxBullets;
+
+	/** Seed of the random ops of the patterns */
+	UPROPERTY(Category = Combat, EditDefaultsOnly)
+	int32 Seed;
+
+	/** Start firing a pattern from the actor, until the pattern ends or the actor is destroyed. Returns the seed of the emitter */
+	int32 StartPattern(class ULylatDragoonBulletPattern* Pattern, AActor* SourceActor);
+
+	/**
+	 * Start firing a pattern from the actor with the seed of an emitter started on the server the given time ago,
+	 * catching up with the bullets it fired since. The patterns aiming at the players aim from where they are now
+	 */
+	void StartPattern(class ULylatDragoonBulletPattern* Pattern, AActor* SourceActor, int32 EmitterSeed, float ElapsedTime);
+
+	/** Returns the number of bullets in flight */
+	FORCEINLINE int32 GetBulletCount() const { return Simulation.GetBullets().Num(); }
+
+	/** Returns BulletInstances subobject **/
+	FORCEINLINE class UInstancedStaticMeshComponent* GetBulletInstances() const { return BulletInstances; }
+
+	/**
+	 * Move the first instances of the component to the bullets in a single batch, hiding the instances left over from
+	 * the last update. Transforms is a buffer kept between the updates. Returns the number of instances showing a bullet
+	 */
+	static int32 UpdateBulletInstances(class UInstancedStaticMeshComponent* Instances, const FLylatDragoonProjectileBuffer& Bullets, float Scale, int32 VisibleInstanceCount, TArray<FTransform>& Transforms);
+
+private:
+
+	/** Compile the pattern and add the actor as a source if needed. Returns false when the pattern doesn't compile */
+	bool AddPatternSource(class ULylatDragoonBulletPattern* Pattern, AActor* SourceActor, int32& OutProgram, int32& OutSource);
+
+	/** Move the sources with their actors and remove the ones destroyed */
+	void UpdateSources();
+
+	/** Damage the players hit in the last update */
+	void QueueHits();
+
+	/** Move the instances to the bullets, hiding the instances left over */
+	void UpdateVisuals();
+
+	/** Emitters and bullets */
+	FLylatDragoonBulletSimulation Simulation;
+
+	/** Patterns compiled by the simulation, referenced so they outlive their programs */
+	UPROPERTY(Transient)
+	TArray<class ULylatDragoonBulletPattern*> Patterns;
+
+	/** Actor of every source of the simulation, with the same index. Null for the free sources */
+	TArray<TWeakObjectPtr<AActor>> SourceActors;
+
+	/** Sources of every actor firing */
+	TMap<TWeakObjectPtr<AActor>, int32> ActorSources;
+
+	/** Player of every target of the simulation, with the same index */
+	UPROPERTY(Transient)
+	TArray<class APawn*> TargetPawns;
+
+	/** Number of instances showing a bullet */
+	int32 VisibleInstanceCount;
+
+	/** Transforms of the instances, kept to avoid allocating on every update */
+	TArray<FTransform> InstanceTransforms;
+
+	/** Time spent simulating the bullets in the last frame (in milliseconds) */
+	float UpdateTimeMs;
+
+	/** Time spent updating the instances in the last frame (in milliseconds) */
+	float VisualsTimeMs;
+};
@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Engine/DataAsset.h"
+#include "LylatDragoonBulletPattern.generated.h"
+
+/**
+ * Instructions of a bullet pattern. An emitter fires along a cone around its axis: the spread is the angle
+ * between the axis and the bullets, and the angle turns the bullets around the axis.
+ */
+UENUM()
+enum class ELylatDragoonBulletOp : uint8
+{
+	/** Point the axis at the nearest player */
+	Aim,
+	/** Point the axis along the forward direction of the enemy */
+	Face,
+	/** Set the speed of the next bullets to Value */
+	Speed,
+	/** Set the angle between the axis and the next bullets to Value degrees */
+	Spread,
+	/** Set the angle of the next bullets around the axis to Value degrees */
+	Angle,
+	/** Add Value degrees to the angle around the axis */
+	Turn,
+	/** Add a random angle between -Value and Value degrees to the angle around the axis */
+	RandomTurn,
+	/** Fire one bullet */
+	Fire,
+	/** Wait Value seconds */
+	Wait,
+	/** Run the ops until the matching EndRepeat Count times, forever when Count is zero */
+	Repeat,
+	/** Close the last Repeat */
+	EndRepeat,
+	/** Start Pattern as a nested emitter, with its axis along the direction of the next bullet */
+	Emit
+};
+
+/** One step of a bullet pattern, as authored */
+USTRUCT()
+struct FLylatDragoonBulletOp
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Category = Op, EditAnywhere)
+	ELylatDragoonBulletOp Op;
+
+	/** Speed, angle or time, depending on the op */
+	UPROPERTY(Category = Op, EditAnywhere)
+	float Value;
+
+	/** Number of times to repeat */
+	UPROPERTY(Category = Op, EditAnywhere)
+	int32 Count;
+
+	/** Pattern of the nested emitter */
+	UPROPERTY(Category = Op, EditAnywhere)
+	class ULylatDragoonBulletPattern* Pattern;
+
+	FLylatDragoonBulletOp()
+		: Op(ELylatDragoonBulletOp::Fire)
+		, Value(0.0f)
+		, Count(0)
+		, Pattern(nullptr)
+	{
+	}
+
+	FLylatDragoonBulletOp(ELylatDragoonBulletOp InOp, float InValue = 0.0f, int32 InCount = 0, class ULylatDragoonBulletPattern* InPattern = nullptr)
+		: Op(InOp)
+		, Value(InValue)
+		, Count(InCount)
+		, Pattern(InPattern)
+	{
+	}
+};
+
+/**
+ * Bullet pattern fired by enemies, such as spirals, fans, aimed bursts or nested emitters.
+ * The ops are compiled into bytecode when the pattern is first fired, see FLylatDragoonBulletSimulation.
+ */
+UCLASS(BlueprintType)
+class LYLATDRAGOON_API ULylatDragoonBulletPattern : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** Ops run in order by every emitter of the pattern. The emitter stops after the last one */
+	UPROPERTY(Category = Pattern, EditAnywhere)
+	TArray<FLylatDragoonBulletOp> Ops;
+};
@@ -0,0 +1,450 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonBulletSimulation.h"
+
+#include "LylatDragoonBulletPattern.h"
+
+/** Ops run by an emitter without waiting before it is stopped, so a loop without Wait can't hang the game */
+static const int32 MaxOpsWithoutWait = 4096;
+
+/** Opcode closing a program, after the last op */
+static const uint8 EndOpCode = 0xFF;
+
+static void WriteFloat(TArray<uint8>& Code, float Value)
+{
+	const int32 Offset = Code.AddUninitialized(sizeof(float));
+	FMemory::Memcpy(&Code[Offset], &Value, sizeof(float));
+}
+
+static void WriteUInt16(TArray<uint8>& Code, uint16 Value)
+{
+	const int32 Offset = Code.AddUninitialized(sizeof(uint16));
+	FMemory::Memcpy(&Code[Offset], &Value, sizeof(uint16));
+}
+
+static FORCEINLINE float ReadFloat(const uint8* Code, int32& PC)
+{
+	float Value;
+	FMemory::Memcpy(&Value, Code + PC, sizeof(float));
+	PC += sizeof(float);
+	return Value;
+}
+
+static FORCEINLINE uint16 ReadUInt16(const uint8* Code, int32& PC)
+{
+	uint16 Value;
+	FMemory::Memcpy(&Value, Code + PC, sizeof(uint16));
+	PC += sizeof(uint16);
+	return Value;
+}
+
+bool FLylatDragoonBulletProgram::Compile(const TArray<FLylatDragoonBulletOp>& Ops, TFunctionRef<int32(const ULylatDragoonBulletPattern*)> ResolvePattern, FString& OutError)
+{
+	Code.Reset();
+
+	int32 LoopDepth = 0;
+	for (int32 OpIndex = 0; OpIndex < Ops.Num(); ++OpIndex)
+	{
+		const FLylatDragoonBulletOp& Op = Ops[OpIndex];
+		Code.Add((uint8)Op.Op);
+
+		switch (Op.Op)
+		{
+		case ELylatDragoonBulletOp::Speed:
+		case ELylatDragoonBulletOp::Spread:
+		case ELylatDragoonBulletOp::Angle:
+		case ELylatDragoonBulletOp::Turn:
+		case ELylatDragoonBulletOp::RandomTurn:
+		case ELylatDragoonBulletOp::Wait:
+			WriteFloat(Code, Op.Value);
+			break;
+
+		case ELylatDragoonBulletOp::Repeat:
+			if (++LoopDepth > LYLATDRAGOON_MAX_BULLET_LOOP_DEPTH)
+			{
+				OutError = FString::Printf(TEXT("op %d nests more than %d Repeat ops"), OpIndex, LYLATDRAGOON_MAX_BULLET_LOOP_DEPTH);
+				return false;
+			}
+			WriteUInt16(Code, (uint16)FMath::Clamp(Op.Count, 0, (int32)MAX_uint16));
+			break;
+
+		case ELylatDragoonBulletOp::EndRepeat:
+			if (--LoopDepth < 0)
+			{
+				OutError = FString::Printf(TEXT("op %d has no matching Repeat"), OpIndex);
+				return false;
+			}
+			break;
+
+		case ELylatDragoonBulletOp::Emit:
+		{
+			const int32 Program = Op.Pattern ? ResolvePattern(Op.Pattern) : INDEX_NONE;
+			if (Program == INDEX_NONE || Program > MAX_uint16)
+			{
+				OutError = FString::Printf(TEXT("op %d emits a pattern which is missing, invalid or nests itself"), OpIndex);
+				return false;
+			}
+			WriteUInt16(Code, (uint16)Program);
+			break;
+		}
+
+		default:
+			break;
+		}
+	}
+
+	if (LoopDepth != 0)
+	{
+		OutError = TEXT("a Repeat has no matching EndRepeat");
+		return false;
+	}
+
+	Code.Add(EndOpCode);
+	return true;
+}
+
+FLylatDragoonBulletSimulation::FLylatDragoonBulletSimulation()
+{
+	BulletLifeTime = 4.0f;
+	HitRadius = 100.0f;
+	MaxBullets = 8192;
+	Seed = 0;
+
+	StartedEmitterCount = 0;
+	UpdateDeltaTime = 0.0f;
+	DroppedBulletCount = 0;
+}
+
+int32 FLylatDragoonBulletSimulation::AddPattern(const ULylatDragoonBulletPattern* Pattern)
+{
+	if (const int32* ExistingProgram = PatternPrograms.Find(Pattern))
+	{
+		return *ExistingProgram;
+	}
+
+	// Stays invalid while the pattern compiles, so a pattern nesting itself fails instead of recursing forever
+	PatternPrograms.Add(Pattern, INDEX_NONE);
+
+	FLylatDragoonBulletProgram Program;
+	FString Error;
+	if (!Program.Compile(Pattern->Ops, [this](const ULylatDragoonBulletPattern* NestedPattern) { return AddPattern(NestedPattern); }, Error))
+	{
+		UE_LOG(LogFlying, Warning, TEXT("Bullet pattern %s is invalid: %s"), *Pattern->GetName(), *Error);
+		return INDEX_NONE;
+	}
+
+	const int32 ProgramIndex = Programs.Add(MoveTemp(Program));
+	PatternPrograms.Add(Pattern, ProgramIndex);
+	return ProgramIndex;
+}
+
+int32 FLylatDragoonBulletSimulation::AddSource(const FVector& Location, const FVector& Forward)
+{
+	const int32 Source = FreeSources.Num() > 0 ? FreeSources.Pop(false) : SourceAlive.AddDefaulted();
+	SourceLocations.SetNum(SourceAlive.Num(), false);
+	SourceForwards.SetNum(SourceAlive.Num(), false);
+
+	SourceLocations[Source] = Location;
+	SourceForwards[Source] = Forward;
+	SourceAlive[Source] = true;
+	return Source;
+}
+
+void FLylatDragoonBulletSimulation::SetSource(int32 Source, const FVector& Location, const FVector& Forward)
+{
+	SourceLocations[Source] = Location;
+	SourceForwards[Source] = Forward;
+}
+
+void FLylatDragoonBulletSimulation::RemoveSource(int32 Source)
+{
+	if (SourceAlive[Source])
+	{
+		SourceAlive[Source] = false;
+		RemovedSources.Add(Source);
+	}
+}
+
+int32 FLylatDragoonBulletSimulation::StartEmitter(int32 Program, int32 Source)
+{
+	const int32 EmitterSeed = (int32)HashCombine(GetTypeHash(Seed), GetTypeHash(StartedEmitterCount++));
+	StartEmitter(Program, Source, EmitterSeed, 0.0f);
+	return EmitterSeed;
+}
+
+void FLylatDragoonBulletSimulation::StartEmitter(int32 Program, int32 Source, int32 EmitterSeed, float ElapsedTime)
+{
+	if (!Programs.IsValidIndex(Program))
+	{
+		return;
+	}
+
+	FLylatDragoonBulletEmitter& Emitter = Emitters[Emitters.AddDefaulted()];
+	Emitter.Program = Program;
+	Emitter.Source = Source;
+	Emitter.PC = 0;
+	Emitter.WaitTime = -FMath::Max(ElapsedTime, 0.0f);
+	Emitter.Axis = SourceForwards[Source];
+	Emitter.Angle = 0.0f;
+	Emitter.Spread = 0.0f;
+	Emitter.Speed = 3000.0f;
+	Emitter.Random.Initialize(EmitterSeed);
+	Emitter.EmittedCount = 0;
+	Emitter.LoopDepth = 0;
+}
+
+void FLylatDragoonBulletSimulation::Update(float DeltaTime)
+{
+	// Stop the emitters of the removed sources before their indices are reused
+	if (RemovedSources.Num() > 0)
+	{
+		Emitters.RemoveAllSwap([this](const FLylatDragoonBulletEmitter& Emitter) { return !SourceAlive[Emitter.Source]; }, false);
+		FreeSources.Append(RemovedSources);
+		RemovedSources.Reset();
+	}
+
+	UpdateDeltaTime = DeltaTime;
+
+	// Nested emitters started in this update are appended and run from their first op right away
+	const int32 WaitingEmitterCount = Emitters.Num();
+	bool bAnyEmitterDone = false;
+	for (int32 EmitterIndex = 0; EmitterIndex < Emitters.Num(); ++EmitterIndex)
+	{
+		if (EmitterIndex < WaitingEmitterCount)
+		{
+			Emitters[EmitterIndex].WaitTime -= DeltaTime;
+		}
+		if (!RunEmitter(EmitterIndex))
+		{
+			Emitters[EmitterIndex].PC = INDEX_NONE;
+			bAnyEmitterDone = true;
+		}
+	}
+	if (bAnyEmitterDone)
+	{
+		Emitters.RemoveAllSwap([](const FLylatDragoonBulletEmitter& Emitter) { return Emitter.PC == INDEX_NONE; }, false);
+	}
+
+	Bullets.Integrate(DeltaTime);
+
+	// Remove the bullets which expired or hit, going backwards so the bullet swapped in was already tested
+	TargetHits.Reset();
+	TargetHits.AddZeroed(Targets.Num());
+	const float HitRadiusSquared = FMath::Square(HitRadius);
+	for (int32 Index = Bullets.Num() - 1; Index >= 0; --Index)
+	{
+		bool bRemove = Bullets.RemainingLifeTime[Index] <= 0.0f;
+		if (!bRemove)
+		{
+			const FVector Position = Bullets.GetPosition(Index);
+			for (int32 TargetIndex = 0; TargetIndex < Targets.Num(); ++TargetIndex)
+			{
+				if (FVector::DistSquared(Position, Targets[TargetIndex]) <= HitRadiusSquared)
+				{
+					++TargetHits[TargetIndex];
+					bRemove = true;
+					break;
+				}
+			}
+		}
+
+		if (bRemove)
+		{
+			Bullets.RemoveAtSwap(Index);
+		}
+	}
+}
+
+bool FLylatDragoonBulletSimulation::RunEmitter(int32 EmitterIndex)
+{
+	// Work on a copy, nested emitters are added to the array while running
+	FLylatDragoonBulletEmitter Emitter = Emitters[EmitterIndex];
+	const uint8* Code = Programs[Emitter.Program].Code.GetData();
+
+	bool bRunning = true;
+	int32 OpCount = 0;
+	while (Emitter.WaitTime <= 0.0f)
+	{
+		if (++OpCount > MaxOpsWithoutWait)
+		{
+			UE_LOG(LogFlying, Warning, TEXT("Bullet emitter stopped after running %d ops without waiting"), MaxOpsWithoutWait);
+			bRunning = false;
+			break;
+		}
+
+		const uint8 OpCode = Code[Emitter.PC++];
+		if (OpCode == EndOpCode)
+		{
+			bRunning = false;
+			break;
+		}
+
+		switch ((ELylatDragoonBulletOp)OpCode)
+		{
+		case ELylatDragoonBulletOp::Aim:
+		{
+			// Aim at the nearest target, keeping the axis when there is none
+			const FVector& Location = SourceLocations[Emitter.Source];
+			float NearestDistanceSquared = MAX_flt;
+			for (const FVector& Target : Targets)
+			{
+				const FVector ToTarget = Target - Location;
+				const float DistanceSquared = ToTarget.SizeSquared();
+				if (DistanceSquared < NearestDistanceSquared && DistanceSquared > SMALL_NUMBER)
+				{
+					NearestDistanceSquared = DistanceSquared;
+					Emitter.Axis = ToTarget * FMath::InvSqrt(DistanceSquared);
+				}
+			}
+			break;
+		}
+
+		case ELylatDragoonBulletOp::Face:
+			Emitter.Axis = SourceForwards[Emitter.Source];
+			break;
+
+		case ELylatDragoonBulletOp::Speed:
+			Emitter.Speed = ReadFloat(Code, Emitter.PC);
+			break;
+
+		case ELylatDragoonBulletOp::Spread:
+			Emitter.Spread = ReadFloat(Code, Emitter.PC);
+			break;
+
+		case ELylatDragoonBulletOp::Angle:
+			Emitter.Angle = ReadFloat(Code, Emitter.PC);
+			break;
+
+		case ELylatDragoonBulletOp::Turn:
+			Emitter.Angle = FRotator::ClampAxis(Emitter.Angle + ReadFloat(Code, Emitter.PC));
+			break;
+
+		case ELylatDragoonBulletOp::RandomTurn:
+		{
+			const float Range = ReadFloat(Code, Emitter.PC);
+			Emitter.Angle = FRotator::ClampAxis(Emitter.Angle + Emitter.Random.FRandRange(-Range, Range));
+			break;
+		}
+
+		case ELylatDragoonBulletOp::Fire:
+			Fire(Emitter);
+			break;
+
+		case ELylatDragoonBulletOp::Wait:
+		{
+			// Keep the time overslept, so the rate of fire doesn't depend on the frame rate. An emitter catching up
+			// runs several waits in one update
+			const float Wait = ReadFloat(Code, Emitter.PC);
+			Emitter.WaitTime += Wait;
+			if (Wait > 0.0f)
+			{
+				OpCount = 0;
+			}
+			break;
+		}
+
+		case ELylatDragoonBulletOp::Repeat:
+			Emitter.LoopCount[Emitter.LoopDepth] = ReadUInt16(Code, Emitter.PC);
+			Emitter.LoopStart[Emitter.LoopDepth] = Emitter.PC;
+			++Emitter.LoopDepth;
+			break;
+
+		case ELylatDragoonBulletOp::EndRepeat:
+		{
+			int32& LoopCount = Emitter.LoopCount[Emitter.LoopDepth - 1];
+			if (LoopCount == 0 || --LoopCount > 0)
+			{
+				Emitter.PC = Emitter.LoopStart[Emitter.LoopDepth - 1];
+			}
+			else
+			{
+				--Emitter.LoopDepth;
+			}
+			break;
+		}
+
+		case ELylatDragoonBulletOp::Emit:
+		{
+			FLylatDragoonBulletEmitter NestedEmitter = Emitter;
+			NestedEmitter.Program = ReadUInt16(Code, Emitter.PC);
+			NestedEmitter.Axis = GetFireDirection(Emitter);
+			NestedEmitter.Angle = 0.0f;
+			NestedEmitter.Spread = 0.0f;
+			NestedEmitter.PC = 0;
+			// Keep the time overslept by the parent, so the nested emitter fires on time when catching up
+			NestedEmitter.WaitTime = FMath::Min(Emitter.WaitTime, 0.0f);
+			NestedEmitter.Random.Initialize((int32)HashCombine(GetTypeHash(Emitter.Random.GetInitialSeed()), GetTypeHash(Emitter.EmittedCount++)));
+			NestedEmitter.EmittedCount = 0;
+			NestedEmitter.LoopDepth = 0;
+			Emitters.Add(NestedEmitter);
+			break;
+		}
+
+		default:
+			checkNoEntry();
+			break;
+		}
+	}
+
+	Emitters[EmitterIndex] = Emitter;
+	return bRunning;
+}
+
+void FLylatDragoonBulletSimulation::Fire(const FLylatDragoonBulletEmitter& Emitter)
+{
+	if (Bullets.Num() >= MaxBullets)
+	{
+		++DroppedBulletCount;
+		return;
+	}
+
+	// Bullets fired before this update by an emitter catching up start where they would be by now
+	const float LateTime = -Emitter.WaitTime - UpdateDeltaTime;
+	if (LateTime <= 0.0f)
+	{
+		Bullets.Add(SourceLocations[Emitter.Source], GetFireDirection(Emitter), Emitter.Speed, BulletLifeTime);
+	}
+	else if (LateTime < BulletLifeTime)
+	{
+		const FVector Direction = GetFireDirection(Emitter);
+		Bullets.Add(SourceLocations[Emitter.Source] + Direction * (Emitter.Speed * LateTime), Direction, Emitter.Speed, BulletLifeTime - LateTime);
+	}
+}
+
+FVector FLylatDragoonBulletSimulation::GetFireDirection(const FLylatDragoonBulletEmitter& Emitter)
+{
+	// Tilt the axis by the spread, towards the angle around it
+	FVector Right, Up;
+	Emitter.Axis.FindBestAxisVectors(Right, Up);
+	float SpreadSin, SpreadCos, AngleSin, AngleCos;
+	FMath::SinCos(&SpreadSin, &SpreadCos, FMath::DegreesToRadians(Emitter.Spread));
+	FMath::SinCos(&AngleSin, &AngleCos, FMath::DegreesToRadians(Emitter.Angle));
+	return Emitter.Axis * SpreadCos + (Right * AngleCos + Up * AngleSin) * SpreadSin;
+}
+
+void FLylatDragoonBulletSimulation::Reserve(int32 BulletCount)
+{
+	Bullets.Reserve(BulletCount);
+}
+
+void FLylatDragoonBulletSimulation::Reset()
+{
+	Emitters.Reset();
+	SourceLocations.Reset();
+	SourceForwards.Reset();
+	SourceAlive.Reset();
+	RemovedSources.Reset();
+	FreeSources.Reset();
+	Bullets.Reset();
+	TargetHits.Reset();
+}
+
+void FLylatDragoonBulletSimulation::ApplyWorldOffset(const FVector& Offset)
+{
+	Bullets.ApplyWorldOffset(Offset);
+	for (FVector& Location : SourceLocations)
+	{
+		Location += Offset;
+	}
+}
@@ -0,0 +1,166 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "LylatDragoonProjectileBuffer.h"
+
+/** Bytecode of a bullet pattern, compiled from its ops */
+struct LYLATDRAGOON_API FLylatDragoonBulletProgram
+{
+	/** One byte per op followed by its operand: a float for values, a uint16 for counts and nested programs */
+	TArray<uint8> Code;
+
+	/** Compile the ops, resolving the pattern of every Emit op to the index of its program. Returns false if the ops are invalid */
+	bool Compile(const TArray<struct FLylatDragoonBulletOp>& Ops, TFunctionRef<int32(const class ULylatDragoonBulletPattern*)> ResolvePattern, FString& OutError);
+};
+
+/** Deepest nesting of Repeat ops in a pattern */
+#define LYLATDRAGOON_MAX_BULLET_LOOP_DEPTH 4
+
+/** State of the virtual machine running a pattern for one emitter */
+struct FLylatDragoonBulletEmitter
+{
+	/** Program run by the emitter */
+	int32 Program;
+
+	/** Source the emitter fires from */
+	int32 Source;
+
+	/** Offset of the next op in the program */
+	int32 PC;
+
+	/** Time left before running the next op */
+	float WaitTime;
+
+	/** Axis the bullets are fired around */
+	FVector Axis;
+
+	/** Angle of the bullets around the axis, in degrees */
+	float Angle;
+
+	/** Angle between the axis and the bullets, in degrees */
+	float Spread;
+
+	float Speed;
+
+	/** Random stream of this emitter alone, so patterns repeat whatever else fires */
+	FRandomStream Random;
+
+	/** Number of nested emitters started by this one, used to seed the next one */
+	int32 EmittedCount;
+
+	/** Open Repeat ops, with the offset of their first op and the times left to run (zero for forever) */
+	int32 LoopDepth;
+	int32 LoopStart[LYLATDRAGOON_MAX_BULLET_LOOP_DEPTH];
+	int32 LoopCount[LYLATDRAGOON_MAX_BULLET_LOOP_DEPTH];
+};
+
+/**
+ * Enemy bullets and the emitters firing them, without any actor or UObject.
+ * Every emitter runs the bytecode of its pattern on a small virtual machine, firing from a source which is moved
+ * by its owner every frame. The bullets are stored in a projectile buffer and tested against the players as spheres.
+ * Every emitter has its own random stream, seeded from the seed of the simulation and the number of emitters started
+ * before unless a seed is given, and nested emitters are seeded from their parent. An emitter started elsewhere with
+ * the same seed fires the same bullets, which is how the clients draw the bullets fired on the server.
+ */
+struct LYLATDRAGOON_API FLylatDragoonBulletSimulation
+{
+	FLylatDragoonBulletSimulation();
+
+	/** Time the bullets stay in flight */
+	float BulletLifeTime;
+
+	/** Distance between a bullet and the center of a player for a hit */
+	float HitRadius;
+
+	/** Bullets fired when this many are in flight are dropped */
+	int32 MaxBullets;
+
+	/** Seed of the random streams of the emitters */
+	int32 Seed;
+
+	/** Players the bullets are aimed at and tested against, set before every update */
+	TArray<FVector> Targets;
+
+	/** Number of bullets that hit every target in the last update, with the same index */
+	TArray<int32> TargetHits;
+
+	/** Compile the pattern and the patterns it nests, once. Returns the index of its program or INDEX_NONE if it is invalid */
+	int32 AddPattern(const class ULylatDragoonBulletPattern* Pattern);
+
+	/** Add a place to fire from and return its index */
+	int32 AddSource(const FVector& Location, const FVector& Forward);
+
+	/** Move a place to fire from */
+	void SetSource(int32 Source, const FVector& Location, const FVector& Forward);
+
+	/** Stop the emitters of a source, its index is reused after the next update */
+	void RemoveSource(int32 Source);
+
+	/** Start running a program from a source. Returns the seed of the emitter */
+	int32 StartEmitter(int32 Program, int32 Source);
+
+	/**
+	 * Start running a program from a source with the seed of an emitter started elsewhere, as if it started the given
+	 * time ago. The ops of that time run on the next update, and the bullets they fire start where they would be by then
+	 */
+	void StartEmitter(int32 Program, int32 Source, int32 EmitterSeed, float ElapsedTime);
+
+	/** Run the emitters, then move the bullets and test them against the targets */
+	void Update(float DeltaTime);
+
+	/** Make room for the given number of bullets without further allocations */
+	void Reserve(int32 BulletCount);
+
+	/** Remove every emitter, source and bullet keeping the compiled programs */
+	void Reset();
+
+	/** Move every bullet and source, when the world origin is rebased */
+	void ApplyWorldOffset(const FVector& Offset);
+
+	/** Returns the bullets in flight */
+	FORCEINLINE const FLylatDragoonProjectileBuffer& GetBullets() const { return Bullets; }
+
+	/** Returns the number of emitters running */
+	FORCEINLINE int32 GetEmitterCount() const { return Emitters.Num(); }
+
+	/** Returns the number of bullets dropped because MaxBullets were in flight */
+	FORCEINLINE int32 GetDroppedBulletCount() const { return DroppedBulletCount; }
+
+private:
+
+	/** Run the ops of an emitter until it waits. Returns false once the emitter is done */
+	bool RunEmitter(int32 EmitterIndex);
+
+	/** Fire one bullet from the emitter */
+	void Fire(const FLylatDragoonBulletEmitter& Emitter);
+
+	/** Returns the direction of the next bullet of the emitter */
+	static FVector GetFireDirection(const FLylatDragoonBulletEmitter& Emitter);
+
+	/** Compiled programs, and the index of the program of every pattern */
+	TArray<FLylatDragoonBulletProgram> Programs;
+	TMap<const class ULylatDragoonBulletPattern*, int32> PatternPrograms;
+
+	TArray<FLylatDragoonBulletEmitter> Emitters;
+
+	/** Places to fire from */
+	TArray<FVector> SourceLocations;
+	TArray<FVector> SourceForwards;
+	TArray<bool> SourceAlive;
+
+	/** Sources removed, free once their emitters are stopped */
+	TArray<int32> RemovedSources;
+	TArray<int32> FreeSources;
+
+	FLylatDragoonProjectileBuffer Bullets;
+
+	/** Number of emitters started, used to seed the next one */
+	int32 StartedEmitterCount;
+
+	/** Time of the update running */
+	float UpdateDeltaTime;
+
+	/** Number of bullets dropped because MaxBullets were in flight */
+	int32 DroppedBulletCount;
+};
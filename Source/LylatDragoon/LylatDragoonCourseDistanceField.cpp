@@ -0,0 +1,258 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonCourseDistanceField.h"
+
+#include "LylatDragoonLevelCourse.h"
+
+#include "Components/PrimitiveComponent.h"
+#include "Engine/World.h"
+#include "Misc/ScopedSlowTask.h"
+
+/** Index of the voxels of the bricks entirely inside a wall, which don't store any */
+static const int32 SolidBrick = -1;
+
+static const int32 BrickSize = LYLATDRAGOON_DISTANCE_FIELD_BRICK_SIZE;
+static const int32 BrickVoxelCount = BrickSize * BrickSize * BrickSize;
+
+ULylatDragoonCourseDistanceField::ULylatDragoonCourseDistanceField(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	// Only sampled by the pawns
+	PrimaryComponentTick.bCanEverTick = false;
+
+	VoxelSize = 50.0f;
+	HalfWidth = 1200.0f;
+	HalfHeight = 700.0f;
+	BandVoxels = 4.0f;
+	WallChannel = ECC_WorldStatic;
+
+	BakedVoxelSize = 0.0f;
+	DistanceQuantum = 0.0f;
+	Origin = FVector::ZeroVector;
+	BrickCounts = FIntVector::ZeroValue;
+}
+
+void ULylatDragoonCourseDistanceField::Bake()
+{
+	ALylatDragoonLevelCourse* LevelCourse = Cast<ALylatDragoonLevelCourse>(GetOwner());
+	UWorld* World = GetWorld();
+	if (!LevelCourse || !World)
+	{
+		return;
+	}
+
+	if (!LevelCourse->GetCourseTable().IsValid())
+	{
+		LevelCourse->BuildCourseTable();
+	}
+	const FLylatDragoonCourseTable& CourseTable = LevelCourse->GetCourseTable();
+	if (!CourseTable.IsValid())
+	{
+		UE_LOG(LogFlying, Warning, TEXT("%s can't bake the distance field without the course of its sequence"), *LevelCourse->GetName());
+		return;
+	}
+
+	// The field is built aside and only replaces the stored one once complete, so cancelling keeps the previous one
+	const float NewVoxelSize = FMath::Max(VoxelSize, 1.0f);
+	const float Band = FMath::Max(BandVoxels, 1.0f) * NewVoxelSize;
+	const float NewDistanceQuantum = Band / MAX_int8;
+	const FVector NewOrigin(0.0f, -HalfWidth, -HalfHeight);
+
+	// Enough bricks for the last voxel to reach the end of the course and the sides of the tube
+	const float CourseLength = CourseTable.GetLength();
+	auto GetBrickCount = [NewVoxelSize](float Extent) { return FMath::Max(FMath::CeilToInt((Extent / NewVoxelSize + 1.0f) / BrickSize), 1); };
+	const FIntVector NewBrickCounts(GetBrickCount(CourseLength), GetBrickCount(2.0f * HalfWidth), GetBrickCount(2.0f * HalfHeight));
+
+	TMap<FIntVector, int32> NewStoredBricks;
+	TArray<int8> NewBrickVoxels;
+
+	FScopedSlowTask SlowTask((float)NewBrickCounts.X, FText::FromString(TEXT("Baking the course distance field")));
+	SlowTask.MakeDialog(true);
+
+	TArray<FVector> VoxelLocations;
+	VoxelLocations.SetNumUninitialized(BrickVoxelCount);
+	TArray<UPrimitiveComponent*> Walls;
+	TArray<FOverlapResult> Overlaps;
+	TArray<int8> Voxels;
+	Voxels.SetNumUninitialized(BrickVoxelCount);
+	const FCollisionQueryParams QueryParams(FName(TEXT("LylatDragoonDistanceFieldBake")), false, LevelCourse);
+	int32 FailedSampleCount = 0;
+
+	for (int32 BrickX = 0; BrickX < NewBrickCounts.X; ++BrickX)
+	{
+		SlowTask.EnterProgressFrame();
+		if (SlowTask.ShouldCancel())
+		{
+			UE_LOG(LogFlying, Display, TEXT("%s cancelled the bake, the distance field is unchanged"), *LevelCourse->GetName());
+			return;
+		}
+
+		for (int32 BrickY = 0; BrickY < NewBrickCounts.Y; ++BrickY)
+		{
+			for (int32 BrickZ = 0; BrickZ < NewBrickCounts.Z; ++BrickZ)
+			{
+				// Place the voxels of the brick in the world, one slice across the course at a time
+				FBox Bounds(ForceInit);
+				for (int32 X = 0; X < BrickSize; ++X)
+				{
+					const float CourseDistance = FMath::Min(NewOrigin.X + (BrickX * BrickSize + X) * NewVoxelSize, CourseLength);
+					const float CourseTime = CourseTable.GetTimeAtDistance(CourseDistance);
+					const FVector CourseLocation = CourseTable.GetLocationAtTime(CourseTime);
+					const FQuat CourseRotation = CourseTable.GetRotationAtTime(CourseTime);
+					for (int32 Y = 0; Y < BrickSize; ++Y)
+					{
+						for (int32 Z = 0; Z < BrickSize; ++Z)
+						{
+							const FVector Offset(0.0f, NewOrigin.Y + (BrickY * BrickSize + Y) * NewVoxelSize, NewOrigin.Z + (BrickZ * BrickSize + Z) * NewVoxelSize);
+							const FVector Location = CourseLocation + CourseRotation.RotateVector(Offset);
+							VoxelLocations[(X * BrickSize + Y) * BrickSize + Z] = Location;
+							Bounds += Location;
+						}
+					}
+				}
+
+				// Only the walls within the band of the brick matter
+				Overlaps.Reset();
+				World->OverlapMultiByChannel(Overlaps, Bounds.GetCenter(), FQuat::Identity, WallChannel, FCollisionShape::MakeBox(Bounds.GetExtent() + FVector(Band)), QueryParams);
+				Walls.Reset();
+				for (const FOverlapResult& Overlap : Overlaps)
+				{
+					if (UPrimitiveComponent* Wall = Overlap.GetComponent())
+					{
+						Walls.AddUnique(Wall);
+					}
+				}
+				if (Walls.Num() == 0)
+				{
+					continue;
+				}
+
+				bool bAllFar = true;
+				bool bAllSolid = true;
+				for (int32 Index = 0; Index < BrickVoxelCount; ++Index)
+				{
+					// The field of the union of the walls is the smallest of their fields
+					float Distance = Band;
+					for (UPrimitiveComponent* Wall : Walls)
+					{
+						FVector ClosestPoint;
+						const float WallDistance = Wall->GetClosestPointOnCollision(VoxelLocations[Index], ClosestPoint);
+						if (WallDistance > 0.0f)
+						{
+							Distance = FMath::Min(Distance, WallDistance);
+						}
+						else if (WallDistance == 0.0f)
+						{
+							// Inside the wall, the depth is how far a tiny sphere has to move to get out
+							FMTDResult Penetration;
+							const bool bPenetrating = Wall->ComputePenetration(Penetration, FCollisionShape::MakeSphere(1.0f), VoxelLocations[Index], FQuat::Identity);
+							Distance = FMath::Min(Distance, bPenetrating ? -Penetration.Distance : -NewDistanceQuantum);
+						}
+						else
+						{
+							++FailedSampleCount;
+						}
+					}
+
+					const int8 Voxel = (int8)FMath::Clamp(FMath::RoundToInt(Distance / NewDistanceQuantum), -MAX_int8, (int32)MAX_int8);
+					Voxels[Index] = Voxel;
+					bAllFar &= Voxel == MAX_int8;
+					bAllSolid &= Voxel == -MAX_int8;
+				}
+
+				if (bAllSolid)
+				{
+					NewStoredBricks.Add(FIntVector(BrickX, BrickY, BrickZ), SolidBrick);
+				}
+				else if (!bAllFar)
+				{
+					NewStoredBricks.Add(FIntVector(BrickX, BrickY, BrickZ), NewBrickVoxels.Num() / BrickVoxelCount);
+					NewBrickVoxels.Append(Voxels);
+				}
+			}
+		}
+	}
+
+	Modify();
+
+	BakedVoxelSize = NewVoxelSize;
+	DistanceQuantum = NewDistanceQuantum;
+	Origin = NewOrigin;
+	BrickCounts = NewBrickCounts;
+	StoredBricks = MoveTemp(NewStoredBricks);
+	StoredBricks.Compact();
+	BrickVoxels = MoveTemp(NewBrickVoxels);
+
+	UE_LOG(LogFlying, Display, TEXT("%s baked %d of %d bricks of the distance field (%d inside walls), %d KB of voxels and %d KB of brick map"),
+		*LevelCourse->GetName(), StoredBricks.Num(), NewBrickCounts.X * NewBrickCounts.Y * NewBrickCounts.Z, StoredBricks.Num() - BrickVoxels.Num() / BrickVoxelCount,
+		BrickVoxels.GetAllocatedSize() / 1024, StoredBricks.GetAllocatedSize() / 1024);
+	if (FailedSampleCount > 0)
+	{
+		UE_LOG(LogFlying, Warning, TEXT("%s couldn't measure the distance to the walls %d times, walls with only complex collision are ignored"), *LevelCourse->GetName(), FailedSampleCount);
+	}
+}
+
+float ULylatDragoonCourseDistanceField::GetDistance(float CourseDistance, float Right, float Up) const
+{
+	if (!IsBaked())
+	{
+		return MAX_flt;
+	}
+
+	// Blend the eight voxels around the point
+	const FVector Position = (FVector(CourseDistance, Right, Up) - Origin) / BakedVoxelSize;
+	const int32 X = FMath::FloorToInt(Position.X);
+	const int32 Y = FMath::FloorToInt(Position.Y);
+	const int32 Z = FMath::FloorToInt(Position.Z);
+	const float AlphaX = Position.X - X;
+	const float AlphaY = Position.Y - Y;
+	const float AlphaZ = Position.Z - Z;
+
+	const float Z00 = FMath::Lerp((float)GetVoxel(X, Y, Z), (float)GetVoxel(X, Y, Z + 1), AlphaZ);
+	const float Z01 = FMath::Lerp((float)GetVoxel(X, Y + 1, Z), (float)GetVoxel(X, Y + 1, Z + 1), AlphaZ);
+	const float Z10 = FMath::Lerp((float)GetVoxel(X + 1, Y, Z), (float)GetVoxel(X + 1, Y, Z + 1), AlphaZ);
+	const float Z11 = FMath::Lerp((float)GetVoxel(X + 1, Y + 1, Z), (float)GetVoxel(X + 1, Y + 1, Z + 1), AlphaZ);
+	const float Value = FMath::Lerp(FMath::Lerp(Z00, Z01, AlphaY), FMath::Lerp(Z10, Z11, AlphaY), AlphaX);
+
+	return Value * DistanceQuantum;
+}
+
+FVector2D ULylatDragoonCourseDistanceField::GetNormal(float CourseDistance, float Right, float Up) const
+{
+	if (!IsBaked())
+	{
+		return FVector2D::ZeroVector;
+	}
+
+	const float Step = BakedVoxelSize;
+	const FVector2D Gradient(
+		GetDistance(CourseDistance, Right + Step, Up) - GetDistance(CourseDistance, Right - Step, Up),
+		GetDistance(CourseDistance, Right, Up + Step) - GetDistance(CourseDistance, Right, Up - Step));
+	return Gradient.GetSafeNormal();
+}
+
+int32 ULylatDragoonCourseDistanceField::GetAllocatedBytes() const
+{
+	return StoredBricks.GetAllocatedSize() + BrickVoxels.GetAllocatedSize();
+}
+
+int8 ULylatDragoonCourseDistanceField::GetVoxel(int32 X, int32 Y, int32 Z) const
+{
+	if (X < 0 || Y < 0 || Z < 0 || X >= BrickCounts.X * BrickSize || Y >= BrickCounts.Y * BrickSize || Z >= BrickCounts.Z * BrickSize)
+	{
+		return MAX_int8;
+	}
+
+	// The bricks missing are in open space
+	const int32* Brick = StoredBricks.Find(FIntVector(X / BrickSize, Y / BrickSize, Z / BrickSize));
+	if (!Brick)
+	{
+		return MAX_int8;
+	}
+	if (*Brick == SolidBrick)
+	{
+		return -MAX_int8;
+	}
+	return BrickVoxels[*Brick * BrickVoxelCount + ((X % BrickSize) * BrickSize + Y % BrickSize) * BrickSize + Z % BrickSize];
+}
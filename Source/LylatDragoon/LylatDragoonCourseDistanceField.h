@@ -0,0 +1,95 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Components/ActorComponent.h"
+#include "LylatDragoonCourseDistanceField.generated.h"
+
+/** Side of a brick of the distance field, in voxels */
+#define LYLATDRAGOON_DISTANCE_FIELD_BRICK_SIZE 8
+
+/**
+ * Signed distance from the walls of the level to the points of a tube around the level course, baked in the editor.
+ * The field is sampled in the frame of the course: distance along the course, right and up offsets from the rail.
+ * Voxels are grouped in bricks and their distances quantized to a byte, clamped to a narrow band around the walls.
+ * Only the bricks near a wall are stored, in a map from their coordinates, so the memory used grows with the area of
+ * the walls close to the course rather than with the length of the course. Bricks entirely inside a wall keep an
+ * entry without voxels, and the bricks missing are in open space. Sampling costs the same on any level.
+ * All the sublevels of the course have to be loaded in the editor when baking.
+ */
+UCLASS(ClassGroup = Course, meta = (BlueprintSpawnableComponent))
+class LYLATDRAGOON_API ULylatDragoonCourseDistanceField : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	ULylatDragoonCourseDistanceField(const FObjectInitializer& ObjectInitializer);
+
+	/** Distance between two samples of the field */
+	UPROPERTY(Category = DistanceField, EditAnywhere)
+	float VoxelSize;
+
+	/** Distance covered by the field to the right and to the left of the rail */
+	UPROPERTY(Category = DistanceField, EditAnywhere)
+	float HalfWidth;
+
+	/** Distance covered by the field above and below the rail */
+	UPROPERTY(Category = DistanceField, EditAnywhere)
+	float HalfHeight;
+
+	/** Distances are stored up to this number of voxels away from the walls. Has to cover the wall contact radius of the pawns */
+	UPROPERTY(Category = DistanceField, EditAnywhere)
+	float BandVoxels;
+
+	/** Collision channel of the walls */
+	UPROPERTY(Category = DistanceField, EditAnywhere)
+	TEnumAsByte<ECollisionChannel> WallChannel;
+
+	/** Sample the walls of the level along the course and store the field. The level course must have a sequence */
+	UFUNCTION(Category = DistanceField, CallInEditor)
+	void Bake();
+
+	/** Indicates if there is a field to sample */
+	FORCEINLINE bool IsBaked() const { return BakedVoxelSize > 0.0f; }
+
+	/** Returns the distance from the walls up to which the baked field is stored, farther points are at this distance */
+	FORCEINLINE float GetBandDistance() const { return DistanceQuantum * MAX_int8; }
+
+	/** Returns the signed distance from the point to the walls, negative inside. Clamped to the band */
+	float GetDistance(float CourseDistance, float Right, float Up) const;
+
+	/** Returns the direction away from the walls in the plane of the course (right, up), zero if unknown */
+	FVector2D GetNormal(float CourseDistance, float Right, float Up) const;
+
+	/** Returns the memory used by the baked field (in bytes) */
+	int32 GetAllocatedBytes() const;
+
+private:
+
+	/** Returns the quantized distance of a voxel, far when the voxel is out of the field */
+	int8 GetVoxel(int32 X, int32 Y, int32 Z) const;
+
+	/** Size of the voxels of the baked field */
+	UPROPERTY()
+	float BakedVoxelSize;
+
+	/** Distance of one step of the quantized distances */
+	UPROPERTY()
+	float DistanceQuantum;
+
+	/** Course-local position of the first voxel (distance, right, up) */
+	UPROPERTY()
+	FVector Origin;
+
+	/** Number of bricks along the course, to the right and up */
+	UPROPERTY()
+	FIntVector BrickCounts;
+
+	/** Index of the voxels of the bricks near a wall, by brick coordinates. Bricks inside a wall have no voxels */
+	UPROPERTY()
+	TMap<FIntVector, int32> StoredBricks;
+
+	/** Quantized distances of the stored bricks, one brick after the other */
+	UPROPERTY()
+	TArray<int8> BrickVoxels;
+};
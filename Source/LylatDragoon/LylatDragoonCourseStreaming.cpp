@@ -0,0 +1,205 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonCourseStreaming.h"
+
+#include "LylatDragoonLevelCourse.h"
+#include "LylatDragoonPawn.h"
+
+#include "LevelSequenceActor.h"
+
+#include "Engine/Engine.h"
+#include "Engine/LevelStreaming.h"
+#include "Kismet/GameplayStatics.h"
+
+static TAutoConsoleVariable<int32> CVarShowCourseStreaming(
+	TEXT("LylatDragoon.ShowCourseStreaming"),
+	0,
+	TEXT("Show on screen the state of the sublevels streamed along the course and the stalls of the rail."));
+
+ULylatDragoonCourseStreaming::ULylatDragoonCourseStreaming(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	// The level course has been updated to the playback position of this frame
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+
+	PrefetchSeconds = 10.0f;
+	VisibleDistance = 20000.0f;
+	UnloadBehindDistance = 5000.0f;
+	MaxLoadedSections = 4;
+
+	LevelCourse = nullptr;
+	PrefetchDistance = 0.0f;
+	LoadedSectionCount = 0;
+	PeakLoadedSectionCount = 0;
+	StallCount = 0;
+	StallSeconds = 0.0f;
+}
+
+void ULylatDragoonCourseStreaming::BeginPlay()
+{
+	Super::BeginPlay();
+
+	LevelCourse = Cast<ALylatDragoonLevelCourse>(GetOwner());
+
+	Sections.Sort([](const FLylatDragoonStreamingSection& A, const FLylatDragoonStreamingSection& B) { return A.StartDistance < B.StartDistance; });
+
+	StreamingLevels.SetNumZeroed(Sections.Num());
+	SectionStalled.SetNumZeroed(Sections.Num());
+	for (int32 Index = 0; Index < Sections.Num(); ++Index)
+	{
+		StreamingLevels[Index] = UGameplayStatics::GetStreamingLevel(this, Sections[Index].LevelName);
+		if (!StreamingLevels[Index])
+		{
+			UE_LOG(LogFlying, Warning, TEXT("%s could not find the sublevel %s"), *GetName(), *Sections[Index].LevelName.ToString());
+		}
+	}
+}
+
+void ULylatDragoonCourseStreaming::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UE_LOG(LogFlying, Log, TEXT("%s peaked at %d loaded sections, the rail stalled %d times for %.2f s"), *GetName(), PeakLoadedSectionCount, StallCount, StallSeconds);
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ULylatDragoonCourseStreaming::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (!LevelCourse || !LevelCourse->SequenceController || !LevelCourse->SequenceController->SequencePlayer)
+	{
+		return;
+	}
+
+	const float CourseDistance = LevelCourse->GetCourseDistance();
+
+	// A stall is counted once when the rail enters a section that is not visible yet
+	for (int32 Index = 0; Index < Sections.Num(); ++Index)
+	{
+		const bool bRailInSection = CourseDistance >= Sections[Index].StartDistance && CourseDistance < Sections[Index].EndDistance;
+		const bool bVisible = StreamingLevels[Index] && StreamingLevels[Index]->IsLevelVisible();
+		if (bRailInSection && !bVisible && StreamingLevels[Index])
+		{
+			if (!SectionStalled[Index])
+			{
+				UE_LOG(LogFlying, Warning, TEXT("The rail reached %s at %.0f before it was visible, prefetching %.0f ahead"), *Sections[Index].LevelName.ToString(), CourseDistance, PrefetchDistance - CourseDistance);
+				StallCount++;
+			}
+			SectionStalled[Index] = true;
+			StallSeconds += DeltaTime;
+		}
+		else
+		{
+			SectionStalled[Index] = false;
+		}
+	}
+
+	UpdateSections(LevelCourse->GetCourseTime(), LevelCourse->SequenceController->SequencePlayer->GetPlayRate());
+
+	LYLATDRAGOON_SET_COUNTER(LoadedSections, LoadedSectionCount);
+
+	if (CVarShowCourseStreaming.GetValueOnGameThread() != 0 && GEngine)
+	{
+		FString Message = FString::Printf(TEXT("Course at %.0f, prefetching to %.0f, %d sections loaded (peak %d), %d stalls (%.2f s)"),
+			CourseDistance, PrefetchDistance, LoadedSectionCount, PeakLoadedSectionCount, StallCount, StallSeconds);
+		for (int32 Index = 0; Index < Sections.Num(); ++Index)
+		{
+			const ULevelStreaming* StreamingLevel = StreamingLevels[Index];
+			if (StreamingLevel && StreamingLevel->ShouldBeLoaded())
+			{
+				Message += FString::Printf(TEXT("\n  %s [%.0f, %.0f] %s"), *Sections[Index].LevelName.ToString(), Sections[Index].StartDistance, Sections[Index].EndDistance,
+					StreamingLevel->IsLevelVisible() ? TEXT("visible") : StreamingLevel->IsLevelLoaded() ? TEXT("loaded") : TEXT("loading"));
+			}
+		}
+		GEngine->AddOnScreenDebugMessage((uint64)GetUniqueID(), 0.0f, FColor::Yellow, Message);
+	}
+}
+
+void ULylatDragoonCourseStreaming::LoadStartSections()
+{
+	UpdateSections(0.0f, 1.0f);
+
+	// The rail starts in the first sections, wait for them rather than stalling on the first frame
+	GetWorld()->FlushLevelStreaming(EFlushLevelStreamingType::Full);
+}
+
+void ULylatDragoonCourseStreaming::UpdateSections(float CourseTime, float PlayRate)
+{
+	if (!LevelCourse || !LevelCourse->GetCourseTable().IsValid())
+	{
+		return;
+	}
+
+	const FLylatDragoonCourseTable& CourseTable = LevelCourse->GetCourseTable();
+	const float CourseDistance = CourseTable.GetDistanceAtTime(CourseTime);
+
+	// Where the rail could be after PrefetchSeconds flying at the highest play rate
+	PrefetchDistance = CourseTable.GetDistanceAtTime(CourseTime + PrefetchSeconds * GetMaxPlayRate(PlayRate));
+	const float UnloadDistance = CourseDistance - UnloadBehindDistance;
+
+	SectionsToLoad.Reset();
+	for (int32 Index = 0; Index < Sections.Num(); ++Index)
+	{
+		if (Sections[Index].EndDistance >= UnloadDistance && Sections[Index].StartDistance <= PrefetchDistance)
+		{
+			SectionsToLoad.Add(Index);
+		}
+	}
+
+	// When there are too many, keep the sections closest to the rail: the one it is in, then the ones ahead, and the
+	// ones behind last since the rail is leaving them
+	if (SectionsToLoad.Num() > MaxLoadedSections)
+	{
+		const TArray<FLylatDragoonStreamingSection>& SortSections = Sections;
+		const float BehindRank = PrefetchDistance - UnloadDistance;
+		auto GetRank = [&SortSections, CourseDistance, BehindRank](int32 Index)
+		{
+			const FLylatDragoonStreamingSection& Section = SortSections[Index];
+			if (Section.EndDistance < CourseDistance)
+			{
+				return BehindRank + CourseDistance - Section.EndDistance;
+			}
+			return FMath::Max(Section.StartDistance - CourseDistance, 0.0f);
+		};
+		SectionsToLoad.Sort([&GetRank](int32 A, int32 B) { return GetRank(A) < GetRank(B); });
+		SectionsToLoad.SetNum(FMath::Max(MaxLoadedSections, 0), false);
+	}
+
+	LoadedSectionCount = 0;
+	for (int32 Index = 0; Index < Sections.Num(); ++Index)
+	{
+		ULevelStreaming* StreamingLevel = StreamingLevels[Index];
+		if (!StreamingLevel)
+		{
+			continue;
+		}
+
+		const bool bShouldBeLoaded = SectionsToLoad.Contains(Index);
+		const bool bShouldBeVisible = bShouldBeLoaded && Sections[Index].StartDistance <= CourseDistance + VisibleDistance;
+
+		// Only touch the streaming level when something changes, setting the flags requests a streaming update
+		if (StreamingLevel->ShouldBeLoaded() != bShouldBeLoaded)
+		{
+			StreamingLevel->SetShouldBeLoaded(bShouldBeLoaded);
+		}
+		if (StreamingLevel->GetShouldBeVisibleFlag() != bShouldBeVisible)
+		{
+			StreamingLevel->SetShouldBeVisible(bShouldBeVisible);
+		}
+
+		if (StreamingLevel->IsLevelLoaded())
+		{
+			LoadedSectionCount++;
+		}
+	}
+
+	PeakLoadedSectionCount = FMath::Max(PeakLoadedSectionCount, LoadedSectionCount);
+}
+
+float ULylatDragoonCourseStreaming::GetMaxPlayRate(float PlayRate) const
+{
+	const ALylatDragoonPawn* Pawn = Cast<ALylatDragoonPawn>(UGameplayStatics::GetPlayerPawn(this, 0));
+	return Pawn ? FMath::Max(PlayRate, Pawn->MaxSpeed) : PlayRate;
+}
@@ -0,0 +1,119 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Components/ActorComponent.h"
+#include "LylatDragoonCourseStreaming.generated.h"
+
+/** Sublevel holding the geometry and actors of a stretch of the level course */
+USTRUCT()
+struct FLylatDragoonStreamingSection
+{
+	GENERATED_BODY()
+
+	/** Package name of the sublevel, as listed in the Levels window */
+	UPROPERTY(Category = Section, EditAnywhere)
+	FName LevelName;
+
+	/** Distance along the course where the section starts to be seen */
+	UPROPERTY(Category = Section, EditAnywhere)
+	float StartDistance;
+
+	/** Distance along the course where the section is no longer seen */
+	UPROPERTY(Category = Section, EditAnywhere)
+	float EndDistance;
+
+	FLylatDragoonStreamingSection()
+		: StartDistance(0.0f)
+		, EndDistance(0.0f)
+	{
+	}
+};
+
+/**
+ * Streams the sublevels of the level course by the distance of the rail along it. Sections ahead of the rail are
+ * loaded as far as it could fly in PrefetchSeconds at the highest play rate the pawn can reach, made visible when
+ * the rail gets close, and unloaded once the rail leaves them behind. The number of loaded sections is capped, so
+ * resident memory doesn't grow with the length of the level. The sublevels must use the Blueprint streaming method
+ * and not be initially loaded nor have streaming volumes.
+ */
+UCLASS(ClassGroup = Course, meta = (BlueprintSpawnableComponent))
+class LYLATDRAGOON_API ULylatDragoonCourseStreaming : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	ULylatDragoonCourseStreaming(const FObjectInitializer& ObjectInitializer);
+
+	// Begin UActorComponent overrides
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	// End UActorComponent overrides
+
+	/** Sublevels streamed along the course */
+	UPROPERTY(Category = Streaming, EditAnywhere)
+	TArray<FLylatDragoonStreamingSection> Sections;
+
+	/** Time of flight at the highest play rate covered by the prefetch (in seconds) */
+	UPROPERTY(Category = Streaming, EditAnywhere)
+	float PrefetchSeconds;
+
+	/** Distance ahead of the rail where the loaded sections are made visible */
+	UPROPERTY(Category = Streaming, EditAnywhere)
+	float VisibleDistance;
+
+	/** Distance behind the rail a section is kept loaded after the rail leaves it */
+	UPROPERTY(Category = Streaming, EditAnywhere)
+	float UnloadBehindDistance;
+
+	/** Most sections loaded at the same time, the closest ones to the rail are loaded first */
+	UPROPERTY(Category = Streaming, EditAnywhere)
+	int32 MaxLoadedSections;
+
+	/** Load the sections around the start of the course and wait for them. Called once the course is baked */
+	void LoadStartSections();
+
+	/** Returns the number of times the rail reached a section before it was visible */
+	FORCEINLINE int32 GetStallCount() const { return StallCount; }
+
+	/** Returns the time the rail spent in sections that were not visible yet (in seconds) */
+	FORCEINLINE float GetStallSeconds() const { return StallSeconds; }
+
+private:
+
+	/** Decide which sections have to be loaded and visible for the rail at the given time */
+	void UpdateSections(float CourseTime, float PlayRate);
+
+	/** Returns the highest play rate the rail can reach */
+	float GetMaxPlayRate(float PlayRate) const;
+
+	/** Level course moving the rail */
+	UPROPERTY(Transient)
+	class ALylatDragoonLevelCourse* LevelCourse;
+
+	/** Streaming level of every section, with the same index */
+	UPROPERTY(Transient)
+	TArray<class ULevelStreaming*> StreamingLevels;
+
+	/** Indicates if the rail is in a section that was not visible when it got there, with the same index */
+	TArray<bool> SectionStalled;
+
+	/** Scratch buffer with the indices of the sections to load, closest to the rail first */
+	TArray<int32> SectionsToLoad;
+
+	/** Distance of the end of the prefetch window in the last update */
+	float PrefetchDistance;
+
+	/** Number of sections loaded in the last update */
+	int32 LoadedSectionCount;
+
+	/** Highest value of LoadedSectionCount */
+	int32 PeakLoadedSectionCount;
+
+	/** Number of times the rail reached a section before it was visible */
+	int32 StallCount;
+
+	/** Time the rail spent in sections that were not visible yet (in seconds) */
+	float StallSeconds;
+};
@@ -0,0 +1,198 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonCourseTable.h"
+
+#include "Algo/BinarySearch.h"
+
+/** Number of steps used to measure the length of every segment */
+static const int32 CourseTableLengthSteps = 4;
+
+FLylatDragoonCourseTable::FLylatDragoonCourseTable()
+	: SampleInterval(1.0f)
+{
+}
+
+void FLylatDragoonCourseTable::Build(const TArray<FVector>& SampledLocations, float InSampleInterval)
+{
+	Reset();
+
+	const int32 SampleCount = SampledLocations.Num();
+	if (SampleCount < 2 || InSampleInterval <= 0.0f)
+	{
+		return;
+	}
+
+	SampleInterval = InSampleInterval;
+	Start = FLylatDragoonCoursePoint(SampledLocations[0]);
+	Locations.SetNumUninitialized(SampleCount);
+	for (int32 Sample = 0; Sample < SampleCount; ++Sample)
+	{
+		Locations[Sample] = FLylatDragoonCoursePoint(SampledLocations[Sample]) - Start;
+	}
+	Tangents.SetNumUninitialized(SampleCount);
+	Rotations.SetNumUninitialized(SampleCount);
+	Distances.SetNumUninitialized(SampleCount);
+
+	// Central differences inside, one sided at both ends
+	for (int32 Sample = 0; Sample < SampleCount; ++Sample)
+	{
+		const int32 Previous = FMath::Max(Sample - 1, 0);
+		const int32 Next = FMath::Min(Sample + 1, SampleCount - 1);
+		Tangents[Sample] = (Locations[Next] - Locations[Previous]).ToVector() / ((Next - Previous) * SampleInterval);
+	}
+
+	// Orientation following the direction of the course. Keep the last one while the course is stopped
+	FQuat PreviousRotation = FQuat::Identity;
+	for (int32 Sample = 0; Sample < SampleCount; ++Sample)
+	{
+		FQuat Rotation = Tangents[Sample].IsNearlyZero() ? PreviousRotation : Tangents[Sample].Rotation().Quaternion();
+		if ((Rotation | PreviousRotation) < 0.0f)
+		{
+			Rotation = Rotation * -1.0f;
+		}
+		Rotations[Sample] = Rotation;
+		PreviousRotation = Rotation;
+	}
+
+	// Accumulated length, measuring every segment along the curve
+	double Distance = 0.0;
+	Distances[0] = 0.0f;
+	for (int32 Sample = 0; Sample < SampleCount - 1; ++Sample)
+	{
+		FLylatDragoonCoursePoint PreviousLocation = Locations[Sample];
+		for (int32 Step = 1; Step <= CourseTableLengthSteps; ++Step)
+		{
+			const FLylatDragoonCoursePoint Location = GetSegmentLocation(Sample, (float)Step / CourseTableLengthSteps);
+			Distance += (Location - PreviousLocation).ToVector().Size();
+			PreviousLocation = Location;
+		}
+		Distances[Sample + 1] = (float)Distance;
+	}
+}
+
+void FLylatDragoonCourseTable::Reset()
+{
+	Locations.Reset();
+	Tangents.Reset();
+	Rotations.Reset();
+	Distances.Reset();
+}
+
+void FLylatDragoonCourseTable::ApplyWorldOffset(const FVector& Offset)
+{
+	Start = Start + FLylatDragoonCoursePoint(Offset);
+}
+
+void FLylatDragoonCourseTable::GetSegment(float Time, int32& OutSample, float& OutAlpha) const
+{
+	const int32 LastSample = Locations.Num() - 1;
+	const float SamplePosition = FMath::Clamp(Time / SampleInterval, 0.0f, (float)LastSample);
+
+	OutSample = FMath::Min(FMath::FloorToInt(SamplePosition), LastSample - 1);
+	OutAlpha = SamplePosition - OutSample;
+}
+
+FLylatDragoonCoursePoint FLylatDragoonCourseTable::GetSegmentLocation(int32 Sample, float Alpha) const
+{
+	// Hermite basis, the same curve as FMath::CubicInterp
+	const double Alpha2 = (double)Alpha * Alpha;
+	const double Alpha3 = Alpha2 * Alpha;
+	const double H00 = 2.0 * Alpha3 - 3.0 * Alpha2 + 1.0;
+	const double H10 = Alpha3 - 2.0 * Alpha2 + Alpha;
+	const double H01 = -2.0 * Alpha3 + 3.0 * Alpha2;
+	const double H11 = Alpha3 - Alpha2;
+
+	return Locations[Sample] * H00 + FLylatDragoonCoursePoint(Tangents[Sample]) * (SampleInterval * H10) + Locations[Sample + 1] * H01 + FLylatDragoonCoursePoint(Tangents[Sample + 1]) * (SampleInterval * H11);
+}
+
+FVector FLylatDragoonCourseTable::GetLocationAtTime(float Time) const
+{
+	if (!IsValid())
+	{
+		return FVector::ZeroVector;
+	}
+
+	int32 Sample;
+	float Alpha;
+	GetSegment(Time, Sample, Alpha);
+
+	// Far from the start the world location is only precise once the start is added, after a rebase it is small again
+	return (Start + GetSegmentLocation(Sample, Alpha)).ToVector();
+}
+
+FVector FLylatDragoonCourseTable::GetVelocityAtTime(float Time) const
+{
+	if (!IsValid())
+	{
+		return FVector::ZeroVector;
+	}
+
+	int32 Sample;
+	float Alpha;
+	GetSegment(Time, Sample, Alpha);
+
+	// Derivative of the Hermite curve of the segment, converted from segment space to seconds
+	const float Alpha2 = Alpha * Alpha;
+	const float H00 = 6.0f * Alpha2 - 6.0f * Alpha;
+	const float H10 = 3.0f * Alpha2 - 4.0f * Alpha + 1.0f;
+	const float H01 = -6.0f * Alpha2 + 6.0f * Alpha;
+	const float H11 = 3.0f * Alpha2 - 2.0f * Alpha;
+
+	// H00 is -H01, so the locations only come in through the segment, which is small
+	const FVector Segment = (Locations[Sample + 1] - Locations[Sample]).ToVector();
+	const FVector SegmentDerivative = Segment * H01 + Tangents[Sample] * (SampleInterval * H10) + Tangents[Sample + 1] * (SampleInterval * H11);
+	return SegmentDerivative / SampleInterval;
+}
+
+FVector FLylatDragoonCourseTable::GetDirectionAtTime(float Time) const
+{
+	const FVector Velocity = GetVelocityAtTime(Time);
+	return Velocity.IsNearlyZero() ? GetRotationAtTime(Time).GetForwardVector() : Velocity.GetUnsafeNormal();
+}
+
+FQuat FLylatDragoonCourseTable::GetRotationAtTime(float Time) const
+{
+	if (!IsValid())
+	{
+		return FQuat::Identity;
+	}
+
+	int32 Sample;
+	float Alpha;
+	GetSegment(Time, Sample, Alpha);
+
+	return FQuat::Slerp(Rotations[Sample], Rotations[Sample + 1], Alpha);
+}
+
+float FLylatDragoonCourseTable::GetDistanceAtTime(float Time) const
+{
+	if (!IsValid())
+	{
+		return 0.0f;
+	}
+
+	int32 Sample;
+	float Alpha;
+	GetSegment(Time, Sample, Alpha);
+
+	return FMath::Lerp(Distances[Sample], Distances[Sample + 1], Alpha);
+}
+
+float FLylatDragoonCourseTable::GetTimeAtDistance(float Distance) const
+{
+	if (!IsValid())
+	{
+		return 0.0f;
+	}
+
+	// First sample further than the distance, the segment ends there
+	const int32 LastSample = Distances.Num() - 1;
+	const int32 Next = FMath::Clamp(Algo::UpperBound(Distances, Distance), 1, LastSample);
+	const int32 Sample = Next - 1;
+
+	const float SegmentLength = Distances[Next] - Distances[Sample];
+	const float Alpha = SegmentLength > KINDA_SMALL_NUMBER ? FMath::Clamp((Distance - Distances[Sample]) / SegmentLength, 0.0f, 1.0f) : 0.0f;
+
+	return (Sample + Alpha) * SampleInterval;
+}
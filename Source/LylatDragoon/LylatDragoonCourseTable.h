@@ -0,0 +1,96 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/** Location on the course in double precision */
+struct FLylatDragoonCoursePoint
+{
+	double X;
+	double Y;
+	double Z;
+
+	FLylatDragoonCoursePoint() : X(0.0), Y(0.0), Z(0.0) {}
+	FLylatDragoonCoursePoint(double InX, double InY, double InZ) : X(InX), Y(InY), Z(InZ) {}
+	explicit FLylatDragoonCoursePoint(const FVector& Vector) : X(Vector.X), Y(Vector.Y), Z(Vector.Z) {}
+
+	FORCEINLINE FLylatDragoonCoursePoint operator+(const FLylatDragoonCoursePoint& Other) const { return FLylatDragoonCoursePoint(X + Other.X, Y + Other.Y, Z + Other.Z); }
+	FORCEINLINE FLylatDragoonCoursePoint operator-(const FLylatDragoonCoursePoint& Other) const { return FLylatDragoonCoursePoint(X - Other.X, Y - Other.Y, Z - Other.Z); }
+	FORCEINLINE FLylatDragoonCoursePoint operator*(double Scale) const { return FLylatDragoonCoursePoint(X * Scale, Y * Scale, Z * Scale); }
+
+	FORCEINLINE FVector ToVector() const { return FVector((float)X, (float)Y, (float)Z); }
+};
+
+/**
+ * Path of the level course baked into samples evenly spaced in time.
+ * Locations are interpolated with Hermite curves, so the direction of the course is the analytic derivative
+ * of the curve instead of the difference between two frames. The accumulated length of the path is stored
+ * for every sample, so the course can be queried by time in O(1) and by distance in O(log n).
+ * The samples are kept in double precision relative to the start of the course, and only the start moves when the
+ * world origin is rebased, so the course is as precise a hundred kilometres from its start as next to it.
+ */
+struct LYLATDRAGOON_API FLylatDragoonCourseTable
+{
+	FLylatDragoonCourseTable();
+
+	/** Build the table from locations sampled every SampleInterval seconds */
+	void Build(const TArray<FVector>& SampledLocations, float InSampleInterval);
+
+	/** Remove every sample */
+	void Reset();
+
+	/** Move the course, when the world origin is rebased */
+	void ApplyWorldOffset(const FVector& Offset);
+
+	FORCEINLINE bool IsValid() const { return Locations.Num() >= 2; }
+
+	/** Returns the time from the first to the last sample (in seconds) */
+	FORCEINLINE float GetDuration() const { return IsValid() ? (Locations.Num() - 1) * SampleInterval : 0.0f; }
+
+	/** Returns the length of the whole course */
+	FORCEINLINE float GetLength() const { return IsValid() ? Distances.Last() : 0.0f; }
+
+	FVector GetLocationAtTime(float Time) const;
+
+	/** Returns the unit direction of the course at the given time */
+	FVector GetDirectionAtTime(float Time) const;
+
+	/** Returns the velocity of the course at the given time, with a play rate of one (units per second) */
+	FVector GetVelocityAtTime(float Time) const;
+
+	FQuat GetRotationAtTime(float Time) const;
+
+	/** Returns the length of the course from the start to the given time */
+	float GetDistanceAtTime(float Time) const;
+
+	/** Returns the time when the course is at the given distance from the start */
+	float GetTimeAtDistance(float Distance) const;
+
+	FORCEINLINE FVector GetLocationAtDistance(float Distance) const { return GetLocationAtTime(GetTimeAtDistance(Distance)); }
+
+	FORCEINLINE FQuat GetRotationAtDistance(float Distance) const { return GetRotationAtTime(GetTimeAtDistance(Distance)); }
+
+private:
+
+	/** Find the segment of the given time and the position inside it */
+	void GetSegment(float Time, int32& OutSample, float& OutAlpha) const;
+
+	/** Returns the location on a segment relative to the start of the course */
+	FLylatDragoonCoursePoint GetSegmentLocation(int32 Sample, float Alpha) const;
+
+	/** Time between two samples (in seconds) */
+	float SampleInterval;
+
+	/** World location of the first sample */
+	FLylatDragoonCoursePoint Start;
+
+	/** Location of every sample relative to the first one */
+	TArray<FLylatDragoonCoursePoint> Locations;
+
+	/** Velocity at every sample (units per second) */
+	TArray<FVector> Tangents;
+
+	TArray<FQuat> Rotations;
+
+	/** Length of the course from the start to every sample */
+	TArray<float> Distances;
+};
@@ -0,0 +1,146 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonDamageQueue.h"
+
+#include "LylatDragoonArena.h"
+
+#include "Engine/Engine.h"
+#include "GameFramework/DamageType.h"
+
+static TAutoConsoleVariable<int32> CVarShowDamage(
+	TEXT("LylatDragoon.ShowDamage"),
+	0,
+	TEXT("Show on screen the number of hits and damaged targets of every frame."));
+
+ULylatDragoonDamageQueue::ULylatDragoonDamageQueue(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	// Overlaps and projectile hits of the frame are all known after physics
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+
+	LastHitCount = 0;
+	LastTargetCount = 0;
+	TotalHitCount = 0;
+
+	CollisionDamageType = UDamageType::StaticClass();
+	ProjectileDamageType = UDamageType::StaticClass();
+	ExplosionDamageType = UDamageType::StaticClass();
+}
+
+void ULylatDragoonDamageQueue::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UE_LOG(LogFlying, Log, TEXT("%s applied %lld hits"), *GetName(), TotalHitCount);
+
+	PendingEntries.Empty();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ULylatDragoonDamageQueue::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	ResolveDamage();
+
+	LYLATDRAGOON_SET_COUNTER(DamageHits, LastHitCount);
+	LYLATDRAGOON_SET_COUNTER(DamagedTargets, LastTargetCount);
+
+	if (CVarShowDamage.GetValueOnGameThread() != 0 && GEngine)
+	{
+		GEngine->AddOnScreenDebugMessage((uint64)GetUniqueID(), 0.0f, FColor::Yellow, FString::Printf(TEXT("Hits: %d, targets damaged: %d, total hits: %lld"), LastHitCount, LastTargetCount, TotalHitCount));
+	}
+}
+
+void ULylatDragoonDamageQueue::QueueDamage(AActor* Target, AActor* Causer, AController* Instigator, float Amount, ELylatDragoonDamageKind Kind)
+{
+	if (!Target || Amount == 0.0f)
+	{
+		return;
+	}
+
+	FLylatDragoonDamageEntry Entry;
+	Entry.Target = Target;
+	Entry.Causer = Causer;
+	Entry.Instigator = Instigator;
+	Entry.Amount = Amount;
+	Entry.Kind = Kind;
+	PendingEntries.Add(Entry);
+}
+
+void ULylatDragoonDamageQueue::ResolveDamage()
+{
+	LYLATDRAGOON_SCOPE_CYCLE_COUNTER(DamageResolution);
+
+	LastHitCount = 0;
+	LastTargetCount = 0;
+
+	if (PendingEntries.Num() == 0)
+	{
+		return;
+	}
+
+	// TakeDamage can queue more damage, it will be applied next frame. The hits being applied only live in this scope
+	FLylatDragoonArena& FrameArena = FLylatDragoonArena::GetFrameArena();
+	FLylatDragoonArenaScope ArenaScope(FrameArena);
+	TLylatDragoonArenaArray<FLylatDragoonDamageEntry> ResolvingEntries(FrameArena);
+	ResolvingEntries.Append(PendingEntries.GetData(), PendingEntries.Num());
+	PendingEntries.Reset();
+
+	LastHitCount = ResolvingEntries.Num();
+	TotalHitCount += LastHitCount;
+
+	// Group the hits by target and kind, keeping the order they were queued in inside every group
+	::StableSort(ResolvingEntries.GetData(), ResolvingEntries.Num(), [](const FLylatDragoonDamageEntry& A, const FLylatDragoonDamageEntry& B)
+	{
+		if (A.Target.Get() != B.Target.Get())
+		{
+			return A.Target.Get() < B.Target.Get();
+		}
+		return A.Kind < B.Kind;
+	});
+
+	int32 First = 0;
+	while (First < ResolvingEntries.Num())
+	{
+		const FLylatDragoonDamageEntry& FirstEntry = ResolvingEntries[First];
+
+		// The biggest hit names the causer and the instigator of the whole group
+		float TotalAmount = 0.0f;
+		int32 BiggestHit = First;
+		int32 Last = First;
+		for (; Last < ResolvingEntries.Num() && ResolvingEntries[Last].Target == FirstEntry.Target && ResolvingEntries[Last].Kind == FirstEntry.Kind; ++Last)
+		{
+			TotalAmount += ResolvingEntries[Last].Amount;
+			if (ResolvingEntries[Last].Amount > ResolvingEntries[BiggestHit].Amount)
+			{
+				BiggestHit = Last;
+			}
+		}
+
+		AActor* Target = FirstEntry.Target.Get();
+		if (Target && !Target->IsPendingKill())
+		{
+			const FLylatDragoonDamageEntry& Entry = ResolvingEntries[BiggestHit];
+			Target->TakeDamage(TotalAmount, FDamageEvent(GetDamageType(Entry.Kind)), Entry.Instigator.Get(), Entry.Causer.Get());
+			LastTargetCount++;
+		}
+
+		First = Last;
+	}
+}
+
+TSubclassOf<UDamageType> ULylatDragoonDamageQueue::GetDamageType(ELylatDragoonDamageKind Kind) const
+{
+	switch (Kind)
+	{
+	case ELylatDragoonDamageKind::Collision:
+		return CollisionDamageType;
+	case ELylatDragoonDamageKind::Projectile:
+		return ProjectileDamageType;
+	case ELylatDragoonDamageKind::Explosion:
+		return ExplosionDamageType;
+	}
+	return UDamageType::StaticClass();
+}
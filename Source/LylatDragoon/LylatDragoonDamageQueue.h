@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Components/ActorComponent.h"
+#include "LylatDragoonDamageQueue.generated.h"
+
+/** What caused a damage entry */
+enum class ELylatDragoonDamageKind : uint8
+{
+	Collision,
+	Projectile,
+	Explosion
+};
+
+/** One hit waiting to be applied */
+struct FLylatDragoonDamageEntry
+{
+	TWeakObjectPtr<AActor> Target;
+	TWeakObjectPtr<AActor> Causer;
+	TWeakObjectPtr<AController> Instigator;
+	float Amount;
+	ELylatDragoonDamageKind Kind;
+};
+
+/**
+ * Collects the damage of the frame and applies it in one place, after physics. Hits found in the middle of
+ * overlap callbacks or of the projectile simulation are only queued, so TakeDamage never runs inside them.
+ * All the hits of a target of the same kind in the frame are added together and applied with a single TakeDamage call,
+ * with the damage type of the kind in its damage event.
+ * Damage queued while the queue is being applied waits until the next frame. The hits being applied are coalesced in
+ * the frame arena.
+ */
+UCLASS(ClassGroup = Combat, meta = (BlueprintSpawnableComponent))
+class LYLATDRAGOON_API ULylatDragoonDamageQueue : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	ULylatDragoonDamageQueue(const FObjectInitializer& ObjectInitializer);
+
+	// Begin UActorComponent overrides
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	// End UActorComponent overrides
+
+	/** Damage type of the hits of the pawns and enemies running into something */
+	UPROPERTY(Category = Combat, EditAnywhere)
+	TSubclassOf<class UDamageType> CollisionDamageType;
+
+	/** Damage type of the hits of the projectiles and bullets */
+	UPROPERTY(Category = Combat, EditAnywhere)
+	TSubclassOf<class UDamageType> ProjectileDamageType;
+
+	/** Damage type of the hits of explosions */
+	UPROPERTY(Category = Combat, EditAnywhere)
+	TSubclassOf<class UDamageType> ExplosionDamageType;
+
+	/** Queue damage to be applied to the target in this frame. The causer must outlive the frame, never pass a pooled actor */
+	void QueueDamage(AActor* Target, AActor* Causer, AController* Instigator, float Amount, ELylatDragoonDamageKind Kind);
+
+	/** Returns the number of hits applied in the last frame */
+	FORCEINLINE int32 GetLastHitCount() const { return LastHitCount; }
+
+	/** Returns the number of TakeDamage calls of the last frame, one per target hit */
+	FORCEINLINE int32 GetLastTargetCount() const { return LastTargetCount; }
+
+	/** Returns the number of hits applied since the game started */
+	FORCEINLINE int64 GetTotalHitCount() const { return TotalHitCount; }
+
+private:
+
+	/** Apply the hits queued until now, coalesced by target and kind */
+	void ResolveDamage();
+
+	/** Returns the damage type applied for a kind of damage */
+	TSubclassOf<class UDamageType> GetDamageType(ELylatDragoonDamageKind Kind) const;
+
+	/** Hits queued for this frame */
+	TArray<FLylatDragoonDamageEntry> PendingEntries;
+
+	/** Number of hits applied in the last frame */
+	int32 LastHitCount;
+
+	/** Number of TakeDamage calls of the last frame */
+	int32 LastTargetCount;
+
+	/** Number of hits applied since the game started */
+	int64 TotalHitCount;
+};
@@ -3,6 +3,20 @@
 #include "LylatDragoon.h"
 #include "LylatDragoonEnemy.h"
 
+#include "LylatDragoonBulletField.h"
+#include "LylatDragoonEnemySimulation.h"
+#include "LylatDragoonGameMode.h"
+#include "LylatDragoonPlayerController.h"
+#include "LylatDragoonSwarm.h"
+
+#include "GameFramework/GameStateBase.h"
+#include "UnrealNetwork.h"
+
+static TAutoConsoleVariable<int32> CVarSwarmRendering(
+	TEXT("LylatDragoon.SwarmRendering"),
+	1,
+	TEXT("Draw the enemies that are not heroes as instances of the swarm. Applies to the enemies spawned afterwards."));
+
 
 // Sets default values
 ALylatDragoonEnemy::ALylatDragoonEnemy()
@@ -10,28 +24,170 @@ ALylatDragoonEnemy::ALylatDragoonEnemy()
  	// Set this pawn to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
-	// Structure to hold one-time initialization
-	struct FConstructorStatics
-	{
-		ConstructorHelpers::FObjectFinderOptional<UStaticMesh> PlaneMesh;
-		FConstructorStatics()
-			: PlaneMesh(TEXT("/Game/Flying/Meshes/UFO.UFO"))
-		{
-		}
-	};
-	static FConstructorStatics ConstructorStatics;
-
-	// Create static mesh component
+	// Create static mesh component. The mesh is a soft reference, loaded by the spawner ahead of the wave
 	PlaneMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("PlaneMesh0"));
-	PlaneMesh->SetStaticMesh(ConstructorStatics.PlaneMesh.Get());
 	RootComponent = PlaneMesh;
+	PlaneMeshAsset = FSoftObjectPath(TEXT("/Game/Flying/Meshes/UFO.UFO"));
+
+	MaxHealth = 30.0f;
+	CurrentHealth = MaxHealth;
+	HitRadius = 0.0f;
+	BulletPattern = nullptr;
+	bHero = false;
+
+	SwarmInstanceIndex = INDEX_NONE;
+	EntityIndex = INDEX_NONE;
+	SpawnerIndex = INDEX_NONE;
+
+	BulletSeed = 0;
+	BulletStartTime = -1.0f;
+
+	TickBucket = ELylatDragoonEnemyTickBucket::Full;
+	LastTickWorldTime = -1.0f;
 }
 
 // Called when the game starts or when spawned
 void ALylatDragoonEnemy::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	// Clients already have the health replicated by the server
+	if (Role == ROLE_Authority)
+	{
+		CurrentHealth = MaxHealth;
+	}
+
+	if (!PlaneMesh->GetStaticMesh() && !PlaneMeshAsset.IsNull())
+	{
+		UStaticMesh* Mesh = PlaneMeshAsset.Get();
+		if (!Mesh)
+		{
+			UE_LOG(LogFlying, Warning, TEXT("%s was not preloaded for %s, loading it synchronously"), *PlaneMeshAsset.ToString(), *GetName());
+			Mesh = PlaneMeshAsset.LoadSynchronous();
+		}
+		PlaneMesh->SetStaticMesh(Mesh);
+	}
+
+	if (HitRadius <= 0.0f)
+	{
+		HitRadius = PlaneMesh->Bounds.SphereRadius;
+	}
+
+	ALylatDragoonGameMode* GameMode = GetWorld()->GetAuthGameMode<ALylatDragoonGameMode>();
+	if (GameMode)
+	{
+		GameMode->RegisterEnemy(this);
+
+		// The mesh keeps the collision, but it is no longer rendered on its own
+		if (!bHero && CVarSwarmRendering.GetValueOnGameThread() != 0)
+		{
+			GameMode->GetSwarm()->AddEnemy(this);
+			if (SwarmInstanceIndex != INDEX_NONE)
+			{
+				PlaneMesh->SetHiddenInGame(true);
+			}
+		}
+
+		// The emitters stop by themselves once the enemy is destroyed. The clients start the same emitter from the
+		// replicated seed, for display only
+		if (BulletPattern)
+		{
+			BulletSeed = GameMode->GetBulletField()->StartPattern(BulletPattern, this);
+			BulletStartTime = GetWorld()->GetGameState()->GetServerWorldTimeSeconds();
+		}
+	}
+	else if (BulletStartTime >= 0.0f)
+	{
+		StartDisplayPattern();
+	}
+}
+
+// Called when the enemy is removed from the level
+void ALylatDragoonEnemy::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	ALylatDragoonGameMode* GameMode = GetWorld()->GetAuthGameMode<ALylatDragoonGameMode>();
+	if (GameMode)
+	{
+		GameMode->UnregisterEnemy(this);
+
+		if (SwarmInstanceIndex != INDEX_NONE)
+		{
+			GameMode->GetSwarm()->RemoveEnemy(this);
+		}
+
+		if (EntityIndex != INDEX_NONE)
+		{
+			GameMode->GetEnemySimulation()->RemoveEnemy(this);
+		}
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+// Called every frame the enemy ticks, with the time since its last tick
+void ALylatDragoonEnemy::TickActor(float DeltaTime, enum ELevelTick TickType, FActorTickFunction& ThisTickFunction)
+{
+	// Make up the frames skipped while ticking at reduced rate or dormant
+	const float WorldTime = GetWorld()->GetTimeSeconds();
+	const float CatchUpDeltaTime = LastTickWorldTime >= 0.0f ? FMath::Max(WorldTime - LastTickWorldTime, DeltaTime) : DeltaTime;
+	LastTickWorldTime = WorldTime;
+
+	Super::TickActor(CatchUpDeltaTime, TickType, ThisTickFunction);
+}
+
+void ALylatDragoonEnemy::GetPreloadAssets(TSubclassOf<ALylatDragoonEnemy> EnemyClass, TArray<FSoftObjectPath>& OutAssets)
+{
+	const ALylatDragoonEnemy* DefaultEnemy = EnemyClass ? EnemyClass->GetDefaultObject<ALylatDragoonEnemy>() : nullptr;
+	if (DefaultEnemy && !DefaultEnemy->PlaneMesh->GetStaticMesh() && !DefaultEnemy->PlaneMeshAsset.IsNull())
+	{
+		OutAssets.AddUnique(DefaultEnemy->PlaneMeshAsset.ToSoftObjectPath());
+	}
+}
+
+void ALylatDragoonEnemy::SetTickBucket(ELylatDragoonEnemyTickBucket NewTickBucket, float ReducedTickInterval)
+{
+	// Changing the tick function moves it between the engine lists, only do it when the bucket changes.
+	// The reduced interval follows the frame rate, setting it doesn't touch the lists
+	if (NewTickBucket == TickBucket)
+	{
+		if (NewTickBucket == ELylatDragoonEnemyTickBucket::Reduced)
+		{
+			SetActorTickInterval(ReducedTickInterval);
+			UpdateSimulationTickInterval();
+		}
+		return;
+	}
+
+	switch (NewTickBucket)
+	{
+	case ELylatDragoonEnemyTickBucket::Full:
+		SetActorTickInterval(0.0f);
+		SetActorTickEnabled(true);
+		break;
+	case ELylatDragoonEnemyTickBucket::Reduced:
+		SetActorTickInterval(ReducedTickInterval);
+		SetActorTickEnabled(true);
+		break;
+	case ELylatDragoonEnemyTickBucket::Dormant:
+		SetActorTickEnabled(false);
+		break;
+	}
+
+	TickBucket = NewTickBucket;
+	UpdateSimulationTickInterval();
+}
+
+void ALylatDragoonEnemy::UpdateSimulationTickInterval()
+{
+	// Only enemies on a course are in the simulation, and only on the server
+	if (EntityIndex != INDEX_NONE)
+	{
+		ALylatDragoonGameMode* GameMode = GetWorld()->GetAuthGameMode<ALylatDragoonGameMode>();
+		if (GameMode)
+		{
+			GameMode->GetEnemySimulation()->UpdateTickInterval(this);
+		}
+	}
 }
 
 // Called every frame
@@ -47,3 +203,46 @@ void ALylatDragoonEnemy::SetupPlayerInputComponent(UInputComponent* PlayerInputC
 	Super::SetupPlayerInputComponent(PlayerInputComponent);
 }
 
+void ALylatDragoonEnemy::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(ALylatDragoonEnemy, CurrentHealth);
+	DOREPLIFETIME_CONDITION(ALylatDragoonEnemy, BulletSeed, COND_InitialOnly);
+	DOREPLIFETIME_CONDITION(ALylatDragoonEnemy, BulletStartTime, COND_InitialOnly);
+}
+
+void ALylatDragoonEnemy::OnRep_BulletStartTime()
+{
+	// The initial properties arrive before BeginPlay, which starts the pattern then
+	if (HasActorBegunPlay())
+	{
+		StartDisplayPattern();
+	}
+}
+
+void ALylatDragoonEnemy::StartDisplayPattern()
+{
+	ALylatDragoonPlayerController* PlayerController = Cast<ALylatDragoonPlayerController>(GetWorld()->GetFirstPlayerController());
+	AGameStateBase* GameState = GetWorld()->GetGameState();
+	if (!BulletPattern || !PlayerController || !GameState)
+	{
+		return;
+	}
+
+	// Catch up with the bullets fired since the server started the pattern
+	PlayerController->GetDisplayBulletField()->StartPattern(BulletPattern, this, BulletSeed, GameState->GetServerWorldTimeSeconds() - BulletStartTime);
+}
+
+// Called when a projectile or the player hits the enemy
+float ALylatDragoonEnemy::TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
+{
+	CurrentHealth -= Damage;
+
+	if (CurrentHealth <= 0.0f)
+	{
+		Destroy();
+	}
+
+	return Super::TakeDamage(Damage, DamageEvent, EventInstigator, DamageCauser);
+}
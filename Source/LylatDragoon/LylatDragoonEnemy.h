@@ -5,6 +5,17 @@
 #include "GameFramework/Pawn.h"
 #include "LylatDragoonEnemy.generated.h"
 
+/** How often an enemy ticks, assigned every frame by the enemy significance */
+enum class ELylatDragoonEnemyTickBucket : uint8
+{
+	/** Tick every frame */
+	Full,
+	/** Tick every few frames */
+	Reduced,
+	/** Don't tick */
+	Dormant
+};
+
 UCLASS()
 class LYLATDRAGOON_API ALylatDragoonEnemy : public APawn
 {
@@ -20,14 +31,97 @@ public:
 
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+
+	// Called when the enemy is removed from the level
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	
+	// Called every frame the enemy ticks, with the time since its last tick
+	virtual void TickActor(float DeltaTime, enum ELevelTick TickType, FActorTickFunction& ThisTickFunction) override;
+
 	// Called every frame
 	virtual void Tick( float DeltaSeconds ) override;
 
 	// Called to bind functionality to input
 	virtual void SetupPlayerInputComponent(UInputComponent* PlayerInputComponent) override;
 
+	// Returns the properties replicated to the clients
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	// Called when a projectile or the player hits the enemy
+	virtual float TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser) override;
+
+	/** Max level of health */
+	UPROPERTY(Category = Health, EditAnywhere)
+	float MaxHealth;
+
+	/** The current value of the health, replicated for the health bars of the clients */
+	UPROPERTY(Category = Health, BlueprintReadOnly, Replicated)
+	float CurrentHealth;
+
+	/** Radius of the sphere used to check projectile hits. If zero the bounds of the mesh are used */
+	UPROPERTY(Category = Combat, EditAnywhere)
+	float HitRadius;
+
+	/** Mesh of the enemy, loaded with the wave. Only used when the mesh component has no mesh set */
+	UPROPERTY(Category = Mesh, EditDefaultsOnly)
+	TSoftObjectPtr<UStaticMesh> PlaneMeshAsset;
+
+	/** Pattern of bullets fired at the players from when the enemy spawns, none if the enemy doesn't shoot */
+	UPROPERTY(Category = Combat, EditAnywhere)
+	class ULylatDragoonBulletPattern* BulletPattern;
+
+	/** Hero enemies are drawn with their own mesh, the rest are drawn as instances by the swarm */
+	UPROPERTY(Category = Mesh, EditAnywhere)
+	bool bHero;
+
+	/** Change how often the enemy ticks. The interval is only used in the reduced bucket */
+	void SetTickBucket(ELylatDragoonEnemyTickBucket NewTickBucket, float ReducedTickInterval);
+
+	/** Add the assets an enemy of the class needs when spawned, besides the class itself */
+	static void GetPreloadAssets(TSubclassOf<ALylatDragoonEnemy> EnemyClass, TArray<FSoftObjectPath>& OutAssets);
+
+	/** Returns how often the enemy ticks */
+	FORCEINLINE ELylatDragoonEnemyTickBucket GetTickBucket() const { return TickBucket; }
+
 	/** Returns PlaneMesh subobject **/
 	FORCEINLINE class UStaticMeshComponent* GetPlaneMesh() const { return PlaneMesh; }
+
+private:
+
+	friend class ALylatDragoonEnemySpawner;
+	friend class ALylatDragoonSwarm;
+	friend class ULylatDragoonEnemySimulation;
+
+	/** Move the enemy on its course at the rate of its tick bucket */
+	void UpdateSimulationTickInterval();
+
+	/** Fire the pattern of the server from the display bullet field of a client */
+	void StartDisplayPattern();
+
+	UFUNCTION()
+	void OnRep_BulletStartTime();
+
+	/** Seed of the emitter firing the pattern on the server */
+	UPROPERTY(Replicated)
+	int32 BulletSeed;
+
+	/** Server world time the pattern started at, negative until it starts */
+	UPROPERTY(ReplicatedUsing = OnRep_BulletStartTime)
+	float BulletStartTime;
+
+	/** Index of the instance drawing this enemy in the swarm, INDEX_NONE when drawn with its own mesh */
+	int32 SwarmInstanceIndex;
+
+	/** Index of this enemy in the store of the enemy simulation, INDEX_NONE when not on a course */
+	int32 EntityIndex;
+
+	/** Index of this enemy in the enemies spawned by the spawner, INDEX_NONE when not spawned by it */
+	int32 SpawnerIndex;
+
+	/** How often the enemy ticks */
+	ELylatDragoonEnemyTickBucket TickBucket;
+
+	/** World time of the last tick, negative before the first one */
+	float LastTickWorldTime;
 	
 };
@@ -3,26 +3,114 @@
 #include "LylatDragoon.h"
 #include "LylatDragoonEnemyCourse.h"
 
+#include "LylatDragoonEnemySimulation.h"
+#include "LylatDragoonGameMode.h"
+
+#include "Components/SplineComponent.h"
+
 
 // Sets default values
 ALylatDragoonEnemyCourse::ALylatDragoonEnemyCourse()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
+ 	// The enemies on the course are moved by the enemy simulation, the course itself doesn't need to tick
+	PrimaryActorTick.bCanEverTick = false;
+
+	// Create the spline component
+	Spline = CreateDefaultSubobject<USplineComponent>(TEXT("Spline0"));
+	RootComponent = Spline;
 
+	Duration = 10.0f;
+	BakedSampleCount = 64;
+	bLoop = false;
+
+	FallbackLocation = FVector::ZeroVector;
+	FallbackRotation = FQuat::Identity;
 }
 
 // Called when the game starts or when spawned
 void ALylatDragoonEnemyCourse::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	BakePath();
+}
+
+// Called when the course is removed from the level
+void ALylatDragoonEnemyCourse::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	ALylatDragoonGameMode* GameMode = GetWorld()->GetAuthGameMode<ALylatDragoonGameMode>();
+	if (GameMode)
+	{
+		GameMode->GetEnemySimulation()->RemoveCourse(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+// Called when the world origin is rebased
+void ALylatDragoonEnemyCourse::ApplyWorldOffset(const FVector& InOffset, bool bWorldShift)
+{
+	Super::ApplyWorldOffset(InOffset, bWorldShift);
+
+	for (FVector& Location : SampleLocations)
+	{
+		Location += InOffset;
+	}
+	FallbackLocation += InOffset;
+}
+
+void ALylatDragoonEnemyCourse::AddEnemy(ALylatDragoonEnemy* Enemy, float StartTime, const FVector& Offset)
+{
+	ALylatDragoonGameMode* GameMode = GetWorld()->GetAuthGameMode<ALylatDragoonGameMode>();
+	if (GameMode)
+	{
+		GameMode->GetEnemySimulation()->AddEnemy(Enemy, this, StartTime, Offset);
+	}
 }
 
-// Called every frame
-void ALylatDragoonEnemyCourse::Tick( float DeltaTime )
+void ALylatDragoonEnemyCourse::Evaluate(float Time, FVector& OutLocation, FQuat& OutRotation) const
 {
-	Super::Tick( DeltaTime );
+	const int32 LastSample = SampleLocations.Num() - 1;
+	if (LastSample < 1)
+	{
+		OutLocation = LastSample == 0 ? SampleLocations[0] : FallbackLocation;
+		OutRotation = LastSample == 0 ? SampleRotations[0] : FallbackRotation;
+		return;
+	}
+
+	const float SampleDuration = Duration / LastSample;
+	const float SamplePosition = SampleDuration > 0.0f ? FMath::Clamp(Time / SampleDuration, 0.0f, (float)LastSample) : 0.0f;
+	const int32 Sample = FMath::Min(FMath::FloorToInt(SamplePosition), LastSample - 1);
+	const float Alpha = SamplePosition - Sample;
+
+	// Hermite interpolation with the tangents scaled to the duration of a segment
+	OutLocation = FMath::CubicInterp(SampleLocations[Sample], SampleTangents[Sample] * SampleDuration, SampleLocations[Sample + 1], SampleTangents[Sample + 1] * SampleDuration, Alpha);
 
+	OutRotation = FQuat::FastLerp(SampleRotations[Sample], SampleRotations[Sample + 1], Alpha);
+	OutRotation.Normalize();
 }
 
+void ALylatDragoonEnemyCourse::BakePath()
+{
+	const int32 SampleCount = FMath::Max(BakedSampleCount, 2);
+	const float SplineLength = Spline->GetSplineLength();
+	const float Speed = Duration > 0.0f ? SplineLength / Duration : 0.0f;
+
+	FallbackLocation = GetActorLocation();
+	FallbackRotation = GetActorQuat();
+
+	SampleLocations.SetNumUninitialized(SampleCount);
+	SampleTangents.SetNumUninitialized(SampleCount);
+	SampleRotations.SetNumUninitialized(SampleCount);
+
+	// Samples evenly spaced in distance, so the enemies fly the course at constant speed
+	for (int32 Sample = 0; Sample < SampleCount; ++Sample)
+	{
+		const float Distance = SplineLength * Sample / (SampleCount - 1);
+		const FVector Direction = Spline->GetDirectionAtDistanceAlongSpline(Distance, ESplineCoordinateSpace::World);
+
+		SampleLocations[Sample] = Spline->GetLocationAtDistanceAlongSpline(Distance, ESplineCoordinateSpace::World);
+		SampleTangents[Sample] = Direction * Speed;
+		SampleRotations[Sample] = Spline->GetQuaternionAtDistanceAlongSpline(Distance, ESplineCoordinateSpace::World);
+	}
+}
@@ -5,10 +5,18 @@
 #include "GameFramework/Actor.h"
 #include "LylatDragoonEnemyCourse.generated.h"
 
+/**
+ * Path followed by a group of enemies. The spline is baked on BeginPlay into a table of samples
+ * evenly spaced in time, which the enemy simulation evaluates for every enemy on the course.
+ */
 UCLASS()
 class LYLATDRAGOON_API ALylatDragoonEnemyCourse : public AActor
 {
 	GENERATED_BODY()
+
+	/** Spline used to author the path of the enemies */
+	UPROPERTY(Category = Course, VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	class USplineComponent* Spline;
 	
 public:	
 	// Sets default values for this actor's properties
@@ -17,9 +25,49 @@ public:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 	
-	// Called every frame
-	virtual void Tick( float DeltaSeconds ) override;
+	// Called when the course is removed from the level
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
-	
+	// Called when the world origin is rebased
+	virtual void ApplyWorldOffset(const FVector& InOffset, bool bWorldShift) override;
+
+	/** Time an enemy takes to go from the start to the end of the course (in seconds) */
+	UPROPERTY(Category = Course, EditAnywhere)
+	float Duration;
+
+	/** Number of samples of the baked path */
+	UPROPERTY(Category = Course, EditAnywhere)
+	int32 BakedSampleCount;
+
+	/** If true the enemies start again when they reach the end, otherwise they are destroyed */
+	UPROPERTY(Category = Course, EditAnywhere)
+	bool bLoop;
+
+	/** Put an enemy on the course. The offset is relative to the path and a negative start time delays the enemy */
+	void AddEnemy(class ALylatDragoonEnemy* Enemy, float StartTime, const FVector& Offset);
+
+	/** Evaluate the baked path at the given time. Only reads the baked samples so it can be called from any thread */
+	void Evaluate(float Time, FVector& OutLocation, FQuat& OutRotation) const;
+
+	/** Bake the spline into samples evenly spaced in time */
+	void BakePath();
+
+	/** Returns Spline subobject **/
+	FORCEINLINE class USplineComponent* GetSpline() const { return Spline; }
+
+private:
+
+	/** Location of the path at every sample, in world space */
+	TArray<FVector> SampleLocations;
+
+	/** Velocity of the path at every sample, in world space per second */
+	TArray<FVector> SampleTangents;
+
+	/** Orientation of the path at every sample */
+	TArray<FQuat> SampleRotations;
+
+	/** Location and orientation of the course, used when nothing is baked */
+	FVector FallbackLocation;
+	FQuat FallbackRotation;
 	
 };
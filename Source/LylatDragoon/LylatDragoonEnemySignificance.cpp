@@ -0,0 +1,184 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonEnemySignificance.h"
+
+#include "LylatDragoonEnemy.h"
+#include "LylatDragoonGameMode.h"
+#include "LylatDragoonLevelCourse.h"
+
+#include "EngineUtils.h"
+#include "Engine/Engine.h"
+
+static TAutoConsoleVariable<int32> CVarShowEnemySignificance(
+	TEXT("LylatDragoon.ShowEnemySignificance"),
+	0,
+	TEXT("Show on screen the number of enemies ticking at full rate, reduced rate or dormant."));
+
+ULylatDragoonEnemySignificance::ULylatDragoonEnemySignificance(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	// Rank the enemies once the pawn, the camera and the enemies moved. The buckets apply on the next frame
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+
+	MaxFullRateEnemies = 32;
+	ReducedRateFrames = 4;
+	FullRateDistance = 5000.0f;
+	DormantDistance = 30000.0f;
+	BehindDistance = 1000.0f;
+	ViewAngleMargin = 10.0f;
+
+	FullRateCount = 0;
+	ReducedRateCount = 0;
+	DormantCount = 0;
+
+	CourseLocation = FVector::ZeroVector;
+	CourseDirection = FVector::ForwardVector;
+	ViewLocation = FVector::ZeroVector;
+	ViewDirection = FVector::ForwardVector;
+	CosHalfFOV = 0.0f;
+	TanHalfFOV = 1.0f;
+	bHasView = false;
+	ReducedTickInterval = 0.0f;
+
+	LevelCourse = nullptr;
+}
+
+void ULylatDragoonEnemySignificance::BeginPlay()
+{
+	Super::BeginPlay();
+
+	for (TActorIterator<ALylatDragoonLevelCourse> LCItr(GetWorld()); LCItr; ++LCItr)
+	{
+		LevelCourse = *LCItr;
+		break;
+	}
+}
+
+void ULylatDragoonEnemySignificance::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	LYLATDRAGOON_SCOPE_CYCLE_COUNTER(Significance);
+
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	ALylatDragoonGameMode* GameMode = Cast<ALylatDragoonGameMode>(GetOwner());
+	APlayerController* PlayerController = GetWorld()->GetFirstPlayerController();
+	if (!GameMode || !LevelCourse || !PlayerController || !PlayerController->PlayerCameraManager)
+	{
+		return;
+	}
+
+	LYLATDRAGOON_SET_COUNTER(EnemiesAlive, GameMode->GetEnemies().Num());
+
+	CourseLocation = LevelCourse->GetActorLocation();
+	CourseDirection = LevelCourse->GetMovementDirection().GetSafeNormal();
+
+	ViewLocation = PlayerController->PlayerCameraManager->GetCameraLocation();
+	ViewDirection = PlayerController->PlayerCameraManager->GetCameraRotation().Vector();
+	const float HalfFOVRadians = FMath::DegreesToRadians(FMath::Clamp(PlayerController->PlayerCameraManager->GetFOVAngle() * 0.5f + ViewAngleMargin, 1.0f, 89.0f));
+	CosHalfFOV = FMath::Cos(HalfFOVRadians);
+	TanHalfFOV = FMath::Tan(HalfFOVRadians);
+	bHasView = true;
+
+	// Just under N frames at the current frame rate, so the reduced enemies tick every Nth frame
+	ReducedTickInterval = (FMath::Max(ReducedRateFrames, 1) - 0.5f) * DeltaTime;
+
+	FullRateCount = 0;
+	ReducedRateCount = 0;
+	DormantCount = 0;
+	RankedEnemies.Reset(GameMode->GetEnemies().Num());
+
+	for (ALylatDragoonEnemy* Enemy : GameMode->GetEnemies())
+	{
+		FRankedEnemy RankedEnemy;
+		if (!GetSignificance(Enemy, RankedEnemy.Significance))
+		{
+			Enemy->SetTickBucket(ELylatDragoonEnemyTickBucket::Dormant, 0.0f);
+			DormantCount++;
+			continue;
+		}
+
+		RankedEnemy.Enemy = Enemy;
+		RankedEnemies.Add(RankedEnemy);
+	}
+
+	RankedEnemies.Sort([](const FRankedEnemy& A, const FRankedEnemy& B) { return A.Significance > B.Significance; });
+
+	for (int32 Rank = 0; Rank < RankedEnemies.Num(); ++Rank)
+	{
+		const FRankedEnemy& RankedEnemy = RankedEnemies[Rank];
+		if (Rank < MaxFullRateEnemies && RankedEnemy.Significance > 0.0f)
+		{
+			RankedEnemy.Enemy->SetTickBucket(ELylatDragoonEnemyTickBucket::Full, 0.0f);
+			FullRateCount++;
+		}
+		else
+		{
+			RankedEnemy.Enemy->SetTickBucket(ELylatDragoonEnemyTickBucket::Reduced, ReducedTickInterval);
+			ReducedRateCount++;
+		}
+	}
+
+	if (CVarShowEnemySignificance.GetValueOnGameThread() != 0 && GEngine)
+	{
+		GEngine->AddOnScreenDebugMessage((uint64)GetUniqueID(), 0.0f, FColor::Yellow, FString::Printf(TEXT("Enemies at full rate: %d, reduced rate: %d, dormant: %d"), FullRateCount, ReducedRateCount, DormantCount));
+	}
+}
+
+void ULylatDragoonEnemySignificance::AssignBucket(ALylatDragoonEnemy* Enemy)
+{
+	// Before the first ranking the enemy keeps ticking every frame
+	if (!bHasView)
+	{
+		return;
+	}
+
+	// The full rate slots left from the last ranking go to the new enemies first, the rest tick at reduced rate
+	float Significance = 0.0f;
+	if (!GetSignificance(Enemy, Significance))
+	{
+		Enemy->SetTickBucket(ELylatDragoonEnemyTickBucket::Dormant, 0.0f);
+		DormantCount++;
+	}
+	else if (FullRateCount < MaxFullRateEnemies && Significance > 0.0f)
+	{
+		Enemy->SetTickBucket(ELylatDragoonEnemyTickBucket::Full, 0.0f);
+		FullRateCount++;
+	}
+	else
+	{
+		Enemy->SetTickBucket(ELylatDragoonEnemyTickBucket::Reduced, ReducedTickInterval);
+		ReducedRateCount++;
+	}
+}
+
+bool ULylatDragoonEnemySignificance::GetSignificance(const ALylatDragoonEnemy* Enemy, float& OutSignificance) const
+{
+	const FVector EnemyLocation = Enemy->GetActorLocation();
+
+	const float CourseDistance = FVector::DotProduct(EnemyLocation - CourseLocation, CourseDirection);
+	if (CourseDistance < -BehindDistance || CourseDistance > DormantDistance)
+	{
+		return false;
+	}
+
+	// Fraction of the screen covered by the enemy, zero if out of the view
+	float ScreenRelevance = 0.0f;
+	const FVector ToEnemy = EnemyLocation - ViewLocation;
+	const float ViewDistance = ToEnemy.Size();
+	if (ViewDistance <= Enemy->HitRadius)
+	{
+		ScreenRelevance = 1.0f;
+	}
+	else if (FVector::DotProduct(ToEnemy, ViewDirection) >= CosHalfFOV * ViewDistance)
+	{
+		ScreenRelevance = FMath::Min(Enemy->HitRadius / (ViewDistance * TanHalfFOV), 1.0f);
+	}
+
+	// Closeness ahead on the course, so enemies about to come into view are updated before they appear
+	const float CourseRelevance = FullRateDistance > 0.0f ? FMath::Clamp(1.0f - CourseDistance / FullRateDistance, 0.0f, 1.0f) : 0.0f;
+
+	OutSignificance = ScreenRelevance + CourseRelevance;
+	return true;
+}
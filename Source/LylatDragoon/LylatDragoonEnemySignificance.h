@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Components/ActorComponent.h"
+#include "LylatDragoonEnemySignificance.generated.h"
+
+/**
+ * Ranks the enemies every frame by how far ahead they are on the level course and by how much of the screen they
+ * cover, and decides how often each one ticks:
+ *   Full     the most relevant enemies tick every frame
+ *   Reduced  enemies ahead of the player but less relevant tick every ReducedRateFrames frames
+ *   Dormant  enemies behind the player or too far ahead don't tick at all
+ * Enemies that tick less than every frame get the time they skipped added to their next tick, and the enemy simulation
+ * moves them on their course at the same rate.
+ * The buckets are assigned after everything else was updated, so they take effect on the next frame. Enemies spawned
+ * in between get a bucket from the view of the last ranking as soon as they register.
+ */
+UCLASS(ClassGroup = Combat, meta = (BlueprintSpawnableComponent))
+class LYLATDRAGOON_API ULylatDragoonEnemySignificance : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	ULylatDragoonEnemySignificance(const FObjectInitializer& ObjectInitializer);
+
+	// Begin UActorComponent overrides
+	virtual void BeginPlay() override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	// End UActorComponent overrides
+
+	/** Maximum number of enemies ticking every frame */
+	UPROPERTY(Category = Significance, EditAnywhere)
+	int32 MaxFullRateEnemies;
+
+	/** Number of frames between two ticks of the enemies with reduced rate */
+	UPROPERTY(Category = Significance, EditAnywhere)
+	int32 ReducedRateFrames;
+
+	/** Enemies closer than this distance ahead on the course are relevant even if they are not on screen */
+	UPROPERTY(Category = Significance, EditAnywhere)
+	float FullRateDistance;
+
+	/** Enemies further than this distance ahead on the course are dormant */
+	UPROPERTY(Category = Significance, EditAnywhere)
+	float DormantDistance;
+
+	/** Enemies further than this distance behind the course are dormant */
+	UPROPERTY(Category = Significance, EditAnywhere)
+	float BehindDistance;
+
+	/** Added to the field of view of the camera when checking if an enemy is on screen (in degrees) */
+	UPROPERTY(Category = Significance, EditAnywhere)
+	float ViewAngleMargin;
+
+	/** Returns the number of enemies in each bucket in the last frame */
+	FORCEINLINE int32 GetFullRateCount() const { return FullRateCount; }
+	FORCEINLINE int32 GetReducedRateCount() const { return ReducedRateCount; }
+	FORCEINLINE int32 GetDormantCount() const { return DormantCount; }
+
+	/** Put a new enemy in its bucket right away, from the view of the last ranking, until it is ranked with the others */
+	void AssignBucket(class ALylatDragoonEnemy* Enemy);
+
+private:
+
+	/** Compute how relevant the enemy is from the view of the last ranking. Returns false if the enemy is dormant */
+	bool GetSignificance(const class ALylatDragoonEnemy* Enemy, float& OutSignificance) const;
+
+	/** Enemy with the significance computed this frame */
+	struct FRankedEnemy
+	{
+		class ALylatDragoonEnemy* Enemy;
+		float Significance;
+	};
+
+	/** Course and camera of the last ranking */
+	FVector CourseLocation;
+	FVector CourseDirection;
+	FVector ViewLocation;
+	FVector ViewDirection;
+	float CosHalfFOV;
+	float TanHalfFOV;
+
+	/** Indicates if the enemies were ranked at least once, so the view above is set */
+	bool bHasView;
+
+	/** Tick interval of the reduced bucket at the frame rate of the last ranking */
+	float ReducedTickInterval;
+
+	/** Scratch buffer with the enemies which are not dormant */
+	TArray<FRankedEnemy> RankedEnemies;
+
+	/** Number of enemies in each bucket in the last frame */
+	int32 FullRateCount;
+	int32 ReducedRateCount;
+	int32 DormantCount;
+
+	/** Used to find how far along the course the enemies are */
+	class ALylatDragoonLevelCourse* LevelCourse;
+};
@@ -0,0 +1,173 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonEnemySimulation.h"
+
+#include "LylatDragoonEnemy.h"
+#include "LylatDragoonEnemyCourse.h"
+
+#include "Async/ParallelFor.h"
+#include "Engine/Engine.h"
+
+static TAutoConsoleVariable<int32> CVarParallelEnemySimulation(
+	TEXT("LylatDragoon.ParallelEnemySimulation"),
+	1,
+	TEXT("Update the enemy simulation on the worker threads. When 0 every chunk is updated on the game thread."));
+
+static TAutoConsoleVariable<int32> CVarShowEnemySimulation(
+	TEXT("LylatDragoon.ShowEnemySimulation"),
+	0,
+	TEXT("Show on screen the number of simulated enemies and how their update is split."));
+
+ULylatDragoonEnemySimulation::ULylatDragoonEnemySimulation(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	// The enemies are in place before physics, so overlaps and projectile hits see where they are this frame
+	PrimaryComponentTick.TickGroup = TG_PrePhysics;
+
+	ChunkSize = 64;
+	MinParallelEnemies = 256;
+}
+
+void ULylatDragoonEnemySimulation::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Store.Reset();
+	Actors.Empty();
+	FinishedActors.Empty();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ULylatDragoonEnemySimulation::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	const int32 EnemyCount = Store.Num();
+	const int32 EnemiesPerChunk = FMath::Max(ChunkSize, 1);
+	const int32 ChunkCount = FMath::DivideAndRoundUp(EnemyCount, EnemiesPerChunk);
+	const bool bSingleThread = CVarParallelEnemySimulation.GetValueOnGameThread() == 0 || EnemyCount < MinParallelEnemies;
+
+	{
+		LYLATDRAGOON_SCOPE_CYCLE_COUNTER(EnemySimulation);
+
+		// Every chunk only touches its own range of the store, and the courses are only read
+		FLylatDragoonEnemyStore& LocalStore = Store;
+		ParallelFor(ChunkCount, [&LocalStore, EnemiesPerChunk, EnemyCount, DeltaTime](int32 Chunk)
+		{
+			const int32 First = Chunk * EnemiesPerChunk;
+			LocalStore.Update(First, FMath::Min(EnemiesPerChunk, EnemyCount - First), DeltaTime);
+		}, bSingleThread);
+	}
+
+	WriteBack();
+
+	if (CVarShowEnemySimulation.GetValueOnGameThread() != 0 && GEngine)
+	{
+		GEngine->AddOnScreenDebugMessage((uint64)GetUniqueID(), 0.0f, FColor::Yellow, FString::Printf(TEXT("Simulated enemies: %d, chunks: %d (%s)"), EnemyCount, ChunkCount, bSingleThread ? TEXT("game thread") : TEXT("parallel")));
+	}
+}
+
+void ULylatDragoonEnemySimulation::ApplyWorldOffset(const FVector& InOffset, bool bWorldShift)
+{
+	Super::ApplyWorldOffset(InOffset, bWorldShift);
+
+	// Course times and offsets are relative to the courses, only the last results are in world space
+	for (FVector& Location : Store.Locations)
+	{
+		Location += InOffset;
+	}
+}
+
+void ULylatDragoonEnemySimulation::WriteBack()
+{
+	LYLATDRAGOON_SCOPE_CYCLE_COUNTER(EnemyWriteBack);
+
+	FinishedActors.Reset();
+
+	for (int32 Index = 0; Index < Store.Num(); ++Index)
+	{
+		ALylatDragoonEnemy* Enemy = Actors[Index];
+		switch (Store.States[Index])
+		{
+		case ELylatDragoonEnemyState::Waiting:
+		case ELylatDragoonEnemyState::Flying:
+			if (Store.Moved[Index])
+			{
+				Enemy->SetActorLocationAndRotation(Store.Locations[Index], Store.Rotations[Index], false, nullptr, ETeleportType::TeleportPhysics);
+			}
+			break;
+		case ELylatDragoonEnemyState::Finished:
+			FinishedActors.Add(Enemy);
+			break;
+		}
+	}
+
+	// Destroying an enemy removes it from the store, so it can't happen in the middle of the pass
+	for (ALylatDragoonEnemy* Enemy : FinishedActors)
+	{
+		Enemy->Destroy();
+	}
+	FinishedActors.Reset();
+}
+
+void ULylatDragoonEnemySimulation::AddEnemy(ALylatDragoonEnemy* Enemy, const ALylatDragoonEnemyCourse* Course, float StartTime, const FVector& Offset)
+{
+	if (!Enemy || Enemy->EntityIndex != INDEX_NONE)
+	{
+		return;
+	}
+
+	Enemy->EntityIndex = Store.Add(Course, StartTime, Offset, Enemy->GetActorLocation(), Enemy->GetActorQuat(), GetTickInterval(Enemy));
+	Actors.Add(Enemy);
+}
+
+void ULylatDragoonEnemySimulation::UpdateTickInterval(ALylatDragoonEnemy* Enemy)
+{
+	const int32 Index = Enemy ? Enemy->EntityIndex : INDEX_NONE;
+	if (Actors.IsValidIndex(Index) && Actors[Index] == Enemy)
+	{
+		Store.TickIntervals[Index] = GetTickInterval(Enemy);
+	}
+}
+
+void ULylatDragoonEnemySimulation::RemoveEnemy(ALylatDragoonEnemy* Enemy)
+{
+	const int32 Index = Enemy ? Enemy->EntityIndex : INDEX_NONE;
+	if (!Actors.IsValidIndex(Index) || Actors[Index] != Enemy)
+	{
+		return;
+	}
+
+	Store.RemoveAtSwap(Index);
+	Actors.RemoveAtSwap(Index, 1, false);
+	if (Actors.IsValidIndex(Index))
+	{
+		Actors[Index]->EntityIndex = Index;
+	}
+	Enemy->EntityIndex = INDEX_NONE;
+}
+
+float ULylatDragoonEnemySimulation::GetTickInterval(const ALylatDragoonEnemy* Enemy)
+{
+	switch (Enemy->GetTickBucket())
+	{
+	case ELylatDragoonEnemyTickBucket::Reduced:
+		return Enemy->GetActorTickInterval();
+	case ELylatDragoonEnemyTickBucket::Dormant:
+		return -1.0f;
+	default:
+		return 0.0f;
+	}
+}
+
+void ULylatDragoonEnemySimulation::RemoveCourse(const ALylatDragoonEnemyCourse* Course)
+{
+	for (int32 Index = 0; Index < Store.Num(); ++Index)
+	{
+		if (Store.Courses[Index] == Course)
+		{
+			Store.Courses[Index] = nullptr;
+		}
+	}
+}
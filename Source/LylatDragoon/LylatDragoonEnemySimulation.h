@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Components/ActorComponent.h"
+#include "LylatDragoonEnemyStore.h"
+#include "LylatDragoonEnemySimulation.generated.h"
+
+/**
+ * Moves every enemy on its course. The state of the enemies lives in an entity store that is updated in
+ * chunks on the worker threads, then the results are written back to the enemy actors in a single pass on
+ * the game thread. Health stays on the actors, since damage is applied on the game thread by the damage queue.
+ * Enemies move at the rate of their tick bucket: reduced rate enemies are updated on their interval with the time
+ * they skipped, dormant enemies only advance their time on the course.
+ */
+UCLASS(ClassGroup = Combat, meta = (BlueprintSpawnableComponent))
+class LYLATDRAGOON_API ULylatDragoonEnemySimulation : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	ULylatDragoonEnemySimulation(const FObjectInitializer& ObjectInitializer);
+
+	// Begin UActorComponent overrides
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual void ApplyWorldOffset(const FVector& InOffset, bool bWorldShift) override;
+	// End UActorComponent overrides
+
+	/** Number of enemies updated by every task */
+	UPROPERTY(Category = Simulation, EditAnywhere)
+	int32 ChunkSize;
+
+	/** Below this number of enemies the update stays on the game thread, where it is cheaper than waking the workers */
+	UPROPERTY(Category = Simulation, EditAnywhere)
+	int32 MinParallelEnemies;
+
+	/** Put an enemy on a course. The offset is relative to the path and a negative start time delays the enemy */
+	void AddEnemy(class ALylatDragoonEnemy* Enemy, const class ALylatDragoonEnemyCourse* Course, float StartTime, const FVector& Offset);
+
+	/** Move the enemy at the rate of its tick bucket, called whenever the bucket or its interval change */
+	void UpdateTickInterval(class ALylatDragoonEnemy* Enemy);
+
+	/** Remove an enemy from the simulation, moving the last enemy into its place */
+	void RemoveEnemy(class ALylatDragoonEnemy* Enemy);
+
+	/** Stop the enemies following a course that is removed from the level. They stay where they are */
+	void RemoveCourse(const class ALylatDragoonEnemyCourse* Course);
+
+	/** Returns the state of the simulated enemies */
+	FORCEINLINE const FLylatDragoonEnemyStore& GetStore() const { return Store; }
+
+private:
+
+	/** Write the transforms computed by the update to the actors and destroy the enemies at the end of their course */
+	void WriteBack();
+
+	/** Returns the interval of the store for the tick bucket of the enemy */
+	static float GetTickInterval(const class ALylatDragoonEnemy* Enemy);
+
+	/** State of the enemies */
+	FLylatDragoonEnemyStore Store;
+
+	/** Actor of every enemy, with the same index as the store */
+	UPROPERTY(Transient)
+	TArray<class ALylatDragoonEnemy*> Actors;
+
+	/** Enemies at the end of their course, gathered during the write back */
+	UPROPERTY(Transient)
+	TArray<class ALylatDragoonEnemy*> FinishedActors;
+};
@@ -3,20 +3,91 @@
 #include "LylatDragoon.h"
 #include "LylatDragoonEnemySpawner.h"
 
+#include "LylatDragoonAssetStreamer.h"
+#include "LylatDragoonEnemy.h"
+#include "LylatDragoonEnemyCourse.h"
+#include "LylatDragoonGameMode.h"
+#include "LylatDragoonLevelCourse.h"
+#include "LylatDragoonSoakRecorder.h"
+
+#include "LevelSequenceActor.h"
+
+#include "EngineUtils.h"
+
 
 // Sets default values
 ALylatDragoonEnemySpawner::ALylatDragoonEnemySpawner()
+	: WaveArena(4 * 1024)
 {
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
 
+	SpawnBudgetMicroseconds = 500.0f;
+	PreloadLeadTime = 5.0f;
+
+	NextWave = 0;
+	NextPreloadWave = 0;
+	LastPlaybackPosition = 0.0f;
+	NextPendingSpawn = 0;
+	PendingSpawns = TLylatDragoonArenaArray<FPendingSpawn>(WaveArena);
 }
 
 // Called when the game starts or when spawned
 void ALylatDragoonEnemySpawner::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	// The server spawns the enemies, the clients get them replicated
+	if (GetNetMode() == NM_Client)
+	{
+		SetActorTickEnabled(false);
+		return;
+	}
+
+	if (!LevelCourse)
+	{
+		for (TActorIterator<ALylatDragoonLevelCourse> LCItr(GetWorld()); LCItr; ++LCItr)
+		{
+			LevelCourse = *LCItr;
+			break;
+		}
+	}
+
+	Waves.Sort([](const FLylatDragoonEnemyWave& A, const FLylatDragoonEnemyWave& B) { return A.TriggerTime < B.TriggerTime; });
+
+	// The soak test can run with more enemies than the level was designed for
+	const float EnemyScale = FLylatDragoonSoakSettings::Get().EnemyScale;
+
+	int32 TotalEnemies = 0;
+	for (FLylatDragoonEnemyWave& Wave : Waves)
+	{
+		if (EnemyScale != 1.0f)
+		{
+			Wave.Count = FMath::RoundToInt(Wave.Count * EnemyScale);
+		}
+		TotalEnemies += Wave.Count;
+	}
+	PendingSpawns.Reserve(TotalEnemies);
+	SpawnedEnemies.Reserve(TotalEnemies);
+	SpawnedEnemyWaves.Reserve(TotalEnemies);
+	WaveStates.SetNumZeroed(Waves.Num());
+
+	// The first waves are loaded with the level
+	PreloadWaves(0.0f);
+}
+
+// Called when the spawner is removed from the level
+void ALylatDragoonEnemySpawner::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// The waves still playing hold their manifests until now
+	for (int32 WaveIndex = 0; WaveIndex < NextPreloadWave; ++WaveIndex)
+	{
+		ReleaseWave(WaveIndex);
+	}
+
+	UE_LOG(LogFlying, Log, TEXT("Wave arena of %s peaked at %d bytes"), *GetName(), WaveArena.GetPeakBytes());
+
+	Super::EndPlay(EndPlayReason);
 }
 
 // Called every frame
@@ -24,5 +95,231 @@ void ALylatDragoonEnemySpawner::Tick( float DeltaTime )
 {
 	Super::Tick( DeltaTime );
 
+	if (LevelCourse && LevelCourse->SequenceController && LevelCourse->SequenceController->SequencePlayer)
+	{
+		const float PlaybackPosition = LevelCourse->SequenceController->SequencePlayer->GetPlaybackPosition();
+
+		// The sequence went back, usually because the player died
+		if (PlaybackPosition < LastPlaybackPosition)
+		{
+			ResetWaves();
+		}
+		LastPlaybackPosition = PlaybackPosition;
+
+		PreloadWaves(PlaybackPosition);
+		TriggerWaves(PlaybackPosition);
+	}
+
+	ProcessPendingSpawns();
+
+	LYLATDRAGOON_ADD_COUNTER(WaveArenaPeak, WaveArena.GetPeakBytes());
+}
+
+void ALylatDragoonEnemySpawner::PreloadWaves(float PlaybackPosition)
+{
+	ALylatDragoonGameMode* GameMode = GetWorld()->GetAuthGameMode<ALylatDragoonGameMode>();
+	if (!GameMode)
+	{
+		return;
+	}
+
+	// The manifests of the waves still playing stay loaded when the waves are reset, requesting them again does nothing
+	while (Waves.IsValidIndex(NextPreloadWave) && Waves[NextPreloadWave].TriggerTime - PreloadLeadTime <= PlaybackPosition)
+	{
+		const FLylatDragoonEnemyWave& Wave = Waves[NextPreloadWave];
+
+		// The assets of the enemies are only known once their class is loaded
+		TArray<FSoftObjectPath> Assets = Wave.PreloadAssets;
+		if (!Wave.EnemyClass.IsNull())
+		{
+			Assets.AddUnique(Wave.EnemyClass.ToSoftObjectPath());
+		}
+		WaveStates[NextPreloadWave].bReleased = false;
+		GameMode->GetAssetStreamer()->RequestAssets(GetWaveManifestName(NextPreloadWave, TEXT("Class")), Assets, FStreamableDelegate::CreateUObject(this, &ALylatDragoonEnemySpawner::OnWaveClassLoaded, NextPreloadWave));
+
+		NextPreloadWave++;
+	}
+}
+
+void ALylatDragoonEnemySpawner::OnWaveClassLoaded(int32 WaveIndex)
+{
+	ALylatDragoonGameMode* GameMode = GetWorld() ? GetWorld()->GetAuthGameMode<ALylatDragoonGameMode>() : nullptr;
+	// The wave can be over before its class finished loading
+	if (!GameMode || !Waves.IsValidIndex(WaveIndex) || WaveStates[WaveIndex].bReleased)
+	{
+		return;
+	}
+
+	TArray<FSoftObjectPath> Assets;
+	ALylatDragoonEnemy::GetPreloadAssets(Waves[WaveIndex].EnemyClass.Get(), Assets);
+	if (Assets.Num() > 0)
+	{
+		GameMode->GetAssetStreamer()->RequestAssets(GetWaveManifestName(WaveIndex, TEXT("Content")), Assets);
+	}
+}
+
+FName ALylatDragoonEnemySpawner::GetWaveManifestName(int32 WaveIndex, const TCHAR* Part) const
+{
+	return FName(*FString::Printf(TEXT("%s.Wave%d.%s"), *GetName(), WaveIndex, Part));
+}
+
+void ALylatDragoonEnemySpawner::TriggerWaves(float PlaybackPosition)
+{
+	while (Waves.IsValidIndex(NextWave) && Waves[NextWave].TriggerTime <= PlaybackPosition)
+	{
+		WaveStates[NextWave].EnemiesLeft = Waves[NextWave].Count;
+		if (Waves[NextWave].Count <= 0)
+		{
+			ReleaseWave(NextWave);
+		}
+
+		for (int32 EnemyIndex = 0; EnemyIndex < Waves[NextWave].Count; ++EnemyIndex)
+		{
+			FPendingSpawn PendingSpawn;
+			PendingSpawn.WaveIndex = NextWave;
+			PendingSpawn.EnemyIndex = EnemyIndex;
+			PendingSpawns.Add(PendingSpawn);
+		}
+
+		NextWave++;
+	}
 }
 
+void ALylatDragoonEnemySpawner::ProcessPendingSpawns()
+{
+	LYLATDRAGOON_SCOPE_CYCLE_COUNTER(Spawning);
+
+	if (NextPendingSpawn >= PendingSpawns.Num())
+	{
+		return;
+	}
+
+	const double BudgetSeconds = SpawnBudgetMicroseconds / 1000000.0;
+	const double StartTime = FPlatformTime::Seconds();
+	int32 SpawnedCount = 0;
+
+	do
+	{
+		const FPendingSpawn& PendingSpawn = PendingSpawns[NextPendingSpawn++];
+		const FLylatDragoonEnemyWave& Wave = Waves[PendingSpawn.WaveIndex];
+
+		const int32 WaveIndex = PendingSpawn.WaveIndex;
+		UClass* EnemyClass = Wave.EnemyClass.Get();
+		if (!EnemyClass && !Wave.EnemyClass.IsNull())
+		{
+			UE_LOG(LogFlying, Warning, TEXT("%s was not preloaded for wave %d of %s, loading it synchronously"), *Wave.EnemyClass.ToString(), PendingSpawn.WaveIndex, *GetName());
+			EnemyClass = Wave.EnemyClass.LoadSynchronous();
+		}
+
+		if (EnemyClass)
+		{
+			const FVector RelativeLocation = Wave.SpawnOffset + Wave.Spacing * PendingSpawn.EnemyIndex;
+			const FTransform SpawnTM(GetActorRotation(), GetActorTransform().TransformPosition(RelativeLocation));
+
+			FActorSpawnParameters SpawnParams;
+			SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+			ALylatDragoonEnemy* Enemy = GetWorld()->SpawnActor<ALylatDragoonEnemy>(EnemyClass, SpawnTM, SpawnParams);
+			if (Enemy)
+			{
+				Enemy->SpawnerIndex = SpawnedEnemies.Add(Enemy);
+				SpawnedEnemyWaves.Add(WaveIndex);
+				Enemy->OnDestroyed.AddDynamic(this, &ALylatDragoonEnemySpawner::OnEnemyDestroyed);
+				SpawnedCount++;
+
+				if (Wave.EnemyCourse)
+				{
+					Wave.EnemyCourse->AddEnemy(Enemy, -Wave.CourseTimeSpacing * PendingSpawn.EnemyIndex, RelativeLocation);
+				}
+				continue;
+			}
+		}
+
+		// The enemy could not be spawned, the wave doesn't wait for it
+		RemoveWaveEnemy(WaveIndex);
+	}
+	while (NextPendingSpawn < PendingSpawns.Num() && FPlatformTime::Seconds() - StartTime < BudgetSeconds);
+
+	LYLATDRAGOON_SET_COUNTER(EnemiesSpawned, SpawnedCount);
+
+	// Everything queued was spawned, reuse the memory for the next waves
+	if (NextPendingSpawn >= PendingSpawns.Num())
+	{
+		PendingSpawns.Empty();
+		WaveArena.Reset();
+		NextPendingSpawn = 0;
+	}
+}
+
+void ALylatDragoonEnemySpawner::ResetWaves()
+{
+	// The waves are not over, they only start again
+	for (const TWeakObjectPtr<ALylatDragoonEnemy>& Enemy : SpawnedEnemies)
+	{
+		if (Enemy.IsValid())
+		{
+			Enemy->OnDestroyed.RemoveDynamic(this, &ALylatDragoonEnemySpawner::OnEnemyDestroyed);
+			Enemy->Destroy();
+		}
+	}
+
+	SpawnedEnemies.Reset();
+	SpawnedEnemyWaves.Reset();
+	PendingSpawns.Empty();
+	WaveArena.Reset();
+	NextPendingSpawn = 0;
+	NextWave = 0;
+
+	// Waves released since are requested again when the sequence reaches them
+	for (FWaveState& WaveState : WaveStates)
+	{
+		WaveState.EnemiesLeft = 0;
+	}
+	NextPreloadWave = 0;
+}
+
+void ALylatDragoonEnemySpawner::RemoveWaveEnemy(int32 WaveIndex)
+{
+	FWaveState& WaveState = WaveStates[WaveIndex];
+	WaveState.EnemiesLeft--;
+	if (WaveState.EnemiesLeft <= 0)
+	{
+		ReleaseWave(WaveIndex);
+	}
+}
+
+void ALylatDragoonEnemySpawner::ReleaseWave(int32 WaveIndex)
+{
+	if (WaveStates[WaveIndex].bReleased)
+	{
+		return;
+	}
+	WaveStates[WaveIndex].bReleased = true;
+
+	ALylatDragoonGameMode* GameMode = GetWorld()->GetAuthGameMode<ALylatDragoonGameMode>();
+	if (GameMode)
+	{
+		GameMode->GetAssetStreamer()->ReleaseAssets(GetWaveManifestName(WaveIndex, TEXT("Class")));
+		GameMode->GetAssetStreamer()->ReleaseAssets(GetWaveManifestName(WaveIndex, TEXT("Content")));
+	}
+}
+
+void ALylatDragoonEnemySpawner::OnEnemyDestroyed(AActor* DestroyedActor)
+{
+	ALylatDragoonEnemy* Enemy = Cast<ALylatDragoonEnemy>(DestroyedActor);
+	const int32 Index = Enemy ? Enemy->SpawnerIndex : INDEX_NONE;
+	if (SpawnedEnemies.IsValidIndex(Index) && SpawnedEnemies[Index] == Enemy)
+	{
+		// Keep the lists packed moving the last enemy into the slot, so clearing a wave stays linear
+		const int32 WaveIndex = SpawnedEnemyWaves[Index];
+		SpawnedEnemies.RemoveAtSwap(Index, 1, false);
+		SpawnedEnemyWaves.RemoveAtSwap(Index, 1, false);
+		if (SpawnedEnemies.IsValidIndex(Index) && SpawnedEnemies[Index].IsValid())
+		{
+			SpawnedEnemies[Index]->SpawnerIndex = Index;
+		}
+		Enemy->SpawnerIndex = INDEX_NONE;
+
+		RemoveWaveEnemy(WaveIndex);
+	}
+}
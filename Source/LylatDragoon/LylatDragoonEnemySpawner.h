@@ -3,8 +3,58 @@
 #pragma once
 
 #include "GameFramework/Actor.h"
+#include "LylatDragoonArena.h"
 #include "LylatDragoonEnemySpawner.generated.h"
 
+/** Group of enemies spawned together when the level course reaches a time of the sequence */
+USTRUCT()
+struct FLylatDragoonEnemyWave
+{
+	GENERATED_BODY()
+
+	/** Time of the level sequence when the wave is spawned (in seconds) */
+	UPROPERTY(Category = Wave, EditAnywhere)
+	float TriggerTime;
+
+	/** Class of the enemies of the wave, loaded ahead of the trigger time */
+	UPROPERTY(Category = Wave, EditAnywhere)
+	TSoftClassPtr<class ALylatDragoonEnemy> EnemyClass;
+
+	/** Other assets loaded with the wave, like the content of the section of the course where it plays */
+	UPROPERTY(Category = Wave, EditAnywhere)
+	TArray<FSoftObjectPath> PreloadAssets;
+
+	/** Number of enemies of the wave */
+	UPROPERTY(Category = Wave, EditAnywhere)
+	int32 Count;
+
+	/** Location of the first enemy, relative to the spawner or to the path of the enemy course */
+	UPROPERTY(Category = Wave, EditAnywhere)
+	FVector SpawnOffset;
+
+	/** Distance between an enemy and the next one, relative to the spawner or to the path of the enemy course */
+	UPROPERTY(Category = Wave, EditAnywhere)
+	FVector Spacing;
+
+	/** Course followed by the enemies of the wave. If empty the enemies stay where they are spawned */
+	UPROPERTY(Category = Wave, EditAnywhere)
+	class ALylatDragoonEnemyCourse* EnemyCourse;
+
+	/** Delay between an enemy and the next one to start following the course (in seconds) */
+	UPROPERTY(Category = Wave, EditAnywhere)
+	float CourseTimeSpacing;
+
+	FLylatDragoonEnemyWave()
+		: TriggerTime(0.0f)
+		, Count(1)
+		, SpawnOffset(FVector::ZeroVector)
+		, Spacing(FVector::ZeroVector)
+		, EnemyCourse(nullptr)
+		, CourseTimeSpacing(0.0f)
+	{
+	}
+};
+
 UCLASS()
 class LYLATDRAGOON_API ALylatDragoonEnemySpawner : public AActor
 {
@@ -17,9 +67,99 @@ public:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 	
+	// Called when the spawner is removed from the level
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	// Called every frame
 	virtual void Tick( float DeltaSeconds ) override;
 
-	
+	/** The level course whose sequence triggers the waves. If empty the first one in the level is used */
+	UPROPERTY(Category = Spawn, EditAnywhere)
+	class ALylatDragoonLevelCourse* LevelCourse;
+
+	/** Waves of enemies spawned by this spawner */
+	UPROPERTY(Category = Spawn, EditAnywhere)
+	TArray<FLylatDragoonEnemyWave> Waves;
+
+	/** Time we can spend spawning enemies every frame (in microseconds). At least one enemy is spawned per frame */
+	UPROPERTY(Category = Spawn, EditAnywhere)
+	float SpawnBudgetMicroseconds;
+
+	/** Time of the level sequence before the trigger time of a wave when its assets start loading (in seconds) */
+	UPROPERTY(Category = Spawn, EditAnywhere)
+	float PreloadLeadTime;
+
+private:
+
+	/** Enemy waiting to be spawned */
+	struct FPendingSpawn
+	{
+		int32 WaveIndex;
+		int32 EnemyIndex;
+	};
+
+	/** Progress of a wave, to release its assets once it is over */
+	struct FWaveState
+	{
+		/** Enemies of the wave waiting to be spawned or alive, once it was triggered */
+		int32 EnemiesLeft;
+
+		/** Indicates if the manifests of the wave were released */
+		bool bReleased;
+	};
+
+	/** Start loading the assets of every wave close enough to its trigger time */
+	void PreloadWaves(float PlaybackPosition);
+
+	/** Load what the enemies of a wave need, once their class is loaded */
+	void OnWaveClassLoaded(int32 WaveIndex);
+
+	/** Returns the name of the manifest of a wave in the asset streamer */
+	FName GetWaveManifestName(int32 WaveIndex, const TCHAR* Part) const;
+
+	/** Queue the enemies of every wave whose trigger time was reached */
+	void TriggerWaves(float PlaybackPosition);
+
+	/** Spawn the queued enemies until the budget of this frame is spent */
+	void ProcessPendingSpawns();
+
+	/** Destroy the enemies spawned and start again from the first wave */
+	void ResetWaves();
+
+	/** Count an enemy of a wave out, releasing the wave when it was the last one */
+	void RemoveWaveEnemy(int32 WaveIndex);
+
+	/** Release the manifests of a wave, they are requested again if the waves start again */
+	void ReleaseWave(int32 WaveIndex);
+
+	UFUNCTION()
+	void OnEnemyDestroyed(AActor* DestroyedActor);
+
+	/** Index of the next wave to trigger. Waves are sorted by trigger time */
+	int32 NextWave;
+
+	/** Index of the next wave to preload */
+	int32 NextPreloadWave;
+
+	/** Playback position of the sequence in the last frame, used to detect when it goes back */
+	float LastPlaybackPosition;
+
+	/** Holds the data of the waves being spawned, reset once they are all spawned or when the waves start again */
+	FLylatDragoonArena WaveArena;
+
+	/** Enemies waiting to be spawned, in order, in the wave arena */
+	TLylatDragoonArenaArray<FPendingSpawn> PendingSpawns;
+
+	/** Index of the next enemy to spawn in PendingSpawns */
+	int32 NextPendingSpawn;
+
+	/** Enemies spawned by this spawner and alive */
+	TArray<TWeakObjectPtr<class ALylatDragoonEnemy>> SpawnedEnemies;
+
+	/** Wave of every enemy of SpawnedEnemies */
+	TArray<int32> SpawnedEnemyWaves;
+
+	/** Progress of every wave */
+	TArray<FWaveState> WaveStates;
 	
 };
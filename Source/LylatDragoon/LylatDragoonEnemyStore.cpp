@@ -0,0 +1,127 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonEnemyStore.h"
+
+#include "LylatDragoonEnemyCourse.h"
+
+void FLylatDragoonEnemyStore::Reserve(int32 Number)
+{
+	Courses.Reserve(Number);
+	CourseTimes.Reserve(Number);
+	Offsets.Reserve(Number);
+	States.Reserve(Number);
+	StateTimes.Reserve(Number);
+	Locations.Reserve(Number);
+	Rotations.Reserve(Number);
+	TickIntervals.Reserve(Number);
+	SkippedTimes.Reserve(Number);
+	Moved.Reserve(Number);
+}
+
+int32 FLylatDragoonEnemyStore::Add(const ALylatDragoonEnemyCourse* Course, float StartTime, const FVector& Offset, const FVector& Location, const FQuat& Rotation, float TickInterval)
+{
+	Courses.Add(Course);
+	Offsets.Add(Offset);
+	States.Add(StartTime < 0.0f ? ELylatDragoonEnemyState::Waiting : ELylatDragoonEnemyState::Flying);
+	StateTimes.Add(0.0f);
+	Locations.Add(Location);
+	Rotations.Add(Rotation);
+	TickIntervals.Add(TickInterval);
+	SkippedTimes.Add(0.0f);
+	Moved.Add(false);
+	return CourseTimes.Add(StartTime);
+}
+
+void FLylatDragoonEnemyStore::RemoveAtSwap(int32 Index)
+{
+	Courses.RemoveAtSwap(Index, 1, false);
+	CourseTimes.RemoveAtSwap(Index, 1, false);
+	Offsets.RemoveAtSwap(Index, 1, false);
+	States.RemoveAtSwap(Index, 1, false);
+	StateTimes.RemoveAtSwap(Index, 1, false);
+	Locations.RemoveAtSwap(Index, 1, false);
+	Rotations.RemoveAtSwap(Index, 1, false);
+	TickIntervals.RemoveAtSwap(Index, 1, false);
+	SkippedTimes.RemoveAtSwap(Index, 1, false);
+	Moved.RemoveAtSwap(Index, 1, false);
+}
+
+void FLylatDragoonEnemyStore::Reset()
+{
+	Courses.Reset();
+	CourseTimes.Reset();
+	Offsets.Reset();
+	States.Reset();
+	StateTimes.Reset();
+	Locations.Reset();
+	Rotations.Reset();
+	TickIntervals.Reset();
+	SkippedTimes.Reset();
+	Moved.Reset();
+}
+
+void FLylatDragoonEnemyStore::Update(int32 First, int32 Count, float DeltaTime)
+{
+	for (int32 Index = First; Index < First + Count; ++Index)
+	{
+		Moved[Index] = false;
+
+		const ALylatDragoonEnemyCourse* Course = Courses[Index];
+		if (!Course || States[Index] == ELylatDragoonEnemyState::Finished)
+		{
+			continue;
+		}
+
+		// Enemies at reduced rate wait for their interval, then make up the frames they skipped
+		const float TickInterval = TickIntervals[Index];
+		float& SkippedTime = SkippedTimes[Index];
+		SkippedTime += DeltaTime;
+		if (TickInterval > 0.0f && SkippedTime < TickInterval)
+		{
+			continue;
+		}
+
+		const float StepTime = SkippedTime;
+		SkippedTime = 0.0f;
+
+		StateTimes[Index] += StepTime;
+
+		float& CourseTime = CourseTimes[Index];
+		CourseTime += StepTime;
+
+		if (States[Index] == ELylatDragoonEnemyState::Waiting && CourseTime >= 0.0f)
+		{
+			States[Index] = ELylatDragoonEnemyState::Flying;
+			StateTimes[Index] = CourseTime;
+		}
+
+		if (CourseTime > Course->Duration)
+		{
+			if (Course->bLoop && Course->Duration > 0.0f)
+			{
+				CourseTime = FMath::Fmod(CourseTime, Course->Duration);
+			}
+			else
+			{
+				States[Index] = ELylatDragoonEnemyState::Finished;
+				StateTimes[Index] = 0.0f;
+				continue;
+			}
+		}
+
+		// Dormant enemies keep their time on the course, so they still finish it, but are not moved
+		if (TickInterval < 0.0f)
+		{
+			continue;
+		}
+
+		FVector PathLocation;
+		FQuat PathRotation;
+		Course->Evaluate(CourseTime, PathLocation, PathRotation);
+
+		Locations[Index] = PathLocation + PathRotation.RotateVector(Offsets[Index]);
+		Rotations[Index] = PathRotation;
+		Moved[Index] = true;
+	}
+}
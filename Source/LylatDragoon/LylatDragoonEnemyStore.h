@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/** What an enemy of the store is doing */
+enum class ELylatDragoonEnemyState : uint8
+{
+	/** Held at the start of its course until its start time */
+	Waiting,
+	/** Flying its course */
+	Flying,
+	/** Reached the end of a course that doesn't loop, the enemy is removed on the next write back */
+	Finished
+};
+
+/**
+ * Simulation state of every enemy, stored as structure of arrays so it can be updated in chunks on worker
+ * threads. Everything needed by the update lives here, the enemy actors are only written to afterwards.
+ */
+struct LYLATDRAGOON_API FLylatDragoonEnemyStore
+{
+	/** Course followed by every enemy, null for the enemies that don't move */
+	TArray<const class ALylatDragoonEnemyCourse*> Courses;
+
+	/** Time of every enemy on its course, negative while waiting to start */
+	TArray<float> CourseTimes;
+
+	/** Offset of every enemy from the path of its course, in the frame of the path */
+	TArray<FVector> Offsets;
+
+	/** What every enemy is doing */
+	TArray<ELylatDragoonEnemyState> States;
+
+	/** Time since every enemy entered its current state */
+	TArray<float> StateTimes;
+
+	/** Time between two updates of every enemy: zero updates every frame, negative only advances the course time */
+	TArray<float> TickIntervals;
+
+	/** Time every enemy skipped since its last update, added to its next one */
+	TArray<float> SkippedTimes;
+
+	/** Transform computed by the last update */
+	TArray<FVector> Locations;
+	TArray<FQuat> Rotations;
+
+	/** Indicates if the transform of every enemy was computed by the last update */
+	TArray<bool> Moved;
+
+	FORCEINLINE int32 Num() const { return CourseTimes.Num(); }
+
+	/** Make room for the given number of enemies without further allocations */
+	void Reserve(int32 Number);
+
+	/** Add an enemy and return its index */
+	int32 Add(const class ALylatDragoonEnemyCourse* Course, float StartTime, const FVector& Offset, const FVector& Location, const FQuat& Rotation, float TickInterval);
+
+	/** Remove an enemy moving the last one into its index */
+	void RemoveAtSwap(int32 Index);
+
+	/** Remove every enemy keeping the memory */
+	void Reset();
+
+	/**
+	 * Advance the enemies in [First, First + Count) and compute their transform. Enemies only read their own state.
+	 * Enemies with a tick interval accumulate the time until it is reached, then advance by all of it at once
+	 */
+	void Update(int32 First, int32 Count, float DeltaTime);
+};
@@ -0,0 +1,257 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonFlightModel.h"
+
+FLylatDragoonFlightParams::FLylatDragoonFlightParams()
+	: MaxEnergy(100.0f)
+	, EnergyConsuptionRate(10.0f)
+	, EnergyCooldownTime(3.0f)
+	, EnergyRecoveryRate(10.0f)
+	, SpeedChangeRate(2.5f)
+	, MinSpeed(0.5f)
+	, MaxSpeed(2.0f)
+	, SpeedRecoveryRate(1.0f)
+	, MovementRotationDegrees(10.0f)
+	, RotChangeBarrellRollRate(20.0f)
+	, RotChangeRate(10.0f)
+	, RotationRecoveryRate(2.5f)
+	, MovRefPointDistance(100.0f)
+	, RightMovementLimit(1000.0f)
+	, LeftMovementLimit(-1000.0f)
+	, UpMovementLimit(500.0f)
+	, DownMovementLimit(-500.0f)
+	, BarrelRollDuration(0.5f)
+{
+}
+
+FLylatDragoonFlightInput::FLylatDragoonFlightInput()
+	: Thrust(0.0f)
+	, Right(0.0f)
+	, Up(0.0f)
+	, bLeftTiltPressed(false)
+	, bRightTiltPressed(false)
+	, bLeftBarrelRoll(false)
+	, bRightBarrelRoll(false)
+{
+}
+
+FLylatDragoonCourseFrame::FLylatDragoonCourseFrame()
+	: Location(FVector::ZeroVector)
+	, Rotation(FRotator::ZeroRotator)
+{
+}
+
+FLylatDragoonCourseFrame::FLylatDragoonCourseFrame(const FVector& InLocation, const FRotator& InRotation)
+	: Location(InLocation)
+	, Rotation(InRotation)
+{
+}
+
+FLylatDragoonCourseFrame FLylatDragoonCourseFrame::Interpolate(const FLylatDragoonCourseFrame& A, const FLylatDragoonCourseFrame& B, float Alpha)
+{
+	return FLylatDragoonCourseFrame(FMath::Lerp(A.Location, B.Location, Alpha), FQuat::Slerp(A.Rotation.Quaternion(), B.Rotation.Quaternion(), Alpha).Rotator());
+}
+
+FLylatDragoonFlightState::FLylatDragoonFlightState()
+	: Location(FVector::ZeroVector)
+	, Rotation(FRotator::ZeroRotator)
+	, PositionOffset(FVector::ZeroVector)
+	, Energy(0.0f)
+	, EnergyCooldownRemaining(0.0f)
+	, BarrelRollRemaining(0.0f)
+	, BarrelRollDirection(0)
+	, PlayRate(1.0f)
+{
+}
+
+void FLylatDragoonFlightModel::Step(FLylatDragoonFlightState& State, const FLylatDragoonFlightInput& Input, const FLylatDragoonFlightParams& Params, const FLylatDragoonCourseFrame& Course, float DeltaTime)
+{
+	float Thrust = Input.Thrust;
+
+	if (!State.IsEnergyInCooldown())
+	{
+		if (Thrust != 0.0f)
+		{
+			State.Energy -= DeltaTime * Params.EnergyConsuptionRate;
+		}
+
+		if (State.Energy < 0.0f)
+		{
+			State.Energy = 0.0f;
+			State.EnergyCooldownRemaining = Params.EnergyCooldownTime;
+			Thrust = 0.0f;
+		}
+		else
+		{
+			State.Energy = FMath::Clamp(State.Energy + DeltaTime * Params.EnergyRecoveryRate, 0.0f, Params.MaxEnergy);
+		}
+	}
+	else
+	{
+		State.EnergyCooldownRemaining -= DeltaTime;
+		Thrust = 0.0f;
+	}
+
+	float DesirePlayRate = State.PlayRate + Thrust;
+	float FinalPlayRate = FMath::Clamp(FMath::FInterpTo(State.PlayRate, DesirePlayRate, DeltaTime, Params.SpeedChangeRate), Params.MinSpeed, Params.MaxSpeed);
+	State.PlayRate = FMath::FInterpTo(FinalPlayRate, 1.0f, DeltaTime, Params.SpeedRecoveryRate);
+
+	if (!State.IsDoingBarrelRoll() && (Input.bLeftBarrelRoll || Input.bRightBarrelRoll))
+	{
+		State.BarrelRollDirection = Input.bLeftBarrelRoll ? -1 : 1;
+		State.BarrelRollRemaining = Params.BarrelRollDuration;
+	}
+
+	// Calculate the rotation according to the input
+	FRotator DesireRotation = State.Rotation;
+	DesireRotation.Yaw += Input.Right * Params.MovementRotationDegrees;
+	if (State.IsDoingBarrelRoll())
+	{
+		DesireRotation.Roll += State.BarrelRollDirection * 45.0f;
+	}
+	else
+	{
+		DesireRotation.Roll = Input.bRightTiltPressed ? 90.0f : DesireRotation.Roll + Input.Right * Params.MovementRotationDegrees;
+		DesireRotation.Roll = Input.bLeftTiltPressed ? -90.0f : DesireRotation.Roll + Input.Right * Params.MovementRotationDegrees;
+	}
+	DesireRotation.Pitch += Input.Up * Params.MovementRotationDegrees;
+	float RotationSpeed = State.IsDoingBarrelRoll() ? Params.RotChangeBarrellRollRate : Params.RotChangeRate;
+	FRotator FinalRotation = FMath::RInterpTo(State.Rotation, DesireRotation, DeltaTime, RotationSpeed);
+	FinalRotation = FMath::RInterpTo(FinalRotation, Course.Rotation, DeltaTime, Params.RotationRecoveryRate);
+
+	//Calculate the position according to the rotation
+	FVector FinalForwardDirection = FinalRotation.Vector();
+	FVector FinalLocation = FMath::LinePlaneIntersection(State.Location, State.Location + FinalForwardDirection * Params.MovRefPointDistance, Course.Location, Course.Rotation.Vector());
+
+	// The limits apply along the axes of the course, whatever its direction in the world
+	FVector PositionOffset = Course.Rotation.UnrotateVector(Course.Location - FinalLocation);
+	PositionOffset.X = 0.0f;
+	PositionOffset.Y = FMath::Clamp(PositionOffset.Y, Params.LeftMovementLimit, Params.RightMovementLimit);
+	PositionOffset.Z = FMath::Clamp(PositionOffset.Z, Params.DownMovementLimit, Params.UpMovementLimit);
+
+	State.Location = Course.GetLocationAtOffset(PositionOffset);
+	State.Rotation = FinalRotation;
+	State.PositionOffset = PositionOffset;
+
+	if (State.IsDoingBarrelRoll())
+	{
+		State.BarrelRollRemaining -= DeltaTime;
+		if (State.BarrelRollRemaining <= 0.0f)
+		{
+			State.BarrelRollRemaining = 0.0f;
+			State.BarrelRollDirection = 0;
+		}
+	}
+}
+
+FLylatDragoonFlightStepper::FLylatDragoonFlightStepper()
+	: FixedDeltaTime(1.0f / 120.0f)
+	, MaxSubsteps(8)
+	, Accumulator(0.0f)
+	, StepCount(0)
+{
+}
+
+void FLylatDragoonFlightStepper::Reset(const FLylatDragoonFlightState& State)
+{
+	PreviousState = State;
+	CurrentState = State;
+	Accumulator = 0.0f;
+}
+
+int32 FLylatDragoonFlightStepper::Advance(float DeltaTime, const FLylatDragoonFlightInput& Input, const FLylatDragoonFlightParams& Params, const FLylatDragoonCourseFrame& PreviousCourse, const FLylatDragoonCourseFrame& Course)
+{
+	check(FixedDeltaTime > 0.0f);
+
+	FLylatDragoonFlightInput StepInput = Input;
+	int32 Steps = 0;
+
+	Accumulator += DeltaTime;
+	while (Accumulator >= FixedDeltaTime && Steps < MaxSubsteps)
+	{
+		Accumulator -= FixedDeltaTime;
+
+		// Where the end of this step falls inside the frame
+		const float CourseAlpha = DeltaTime > 0.0f ? FMath::Clamp((DeltaTime - Accumulator) / DeltaTime, 0.0f, 1.0f) : 1.0f;
+
+		PreviousState = CurrentState;
+		FLylatDragoonFlightModel::Step(CurrentState, StepInput, Params, FLylatDragoonCourseFrame::Interpolate(PreviousCourse, Course, CourseAlpha), FixedDeltaTime);
+
+		StepInput.bLeftBarrelRoll = false;
+		StepInput.bRightBarrelRoll = false;
+
+		++Steps;
+		++StepCount;
+	}
+
+	// Drop the time we couldn't simulate this frame
+	if (Accumulator >= FixedDeltaTime)
+	{
+		Accumulator = FMath::Fmod(Accumulator, FixedDeltaTime);
+	}
+
+	return Steps;
+}
+
+FLylatDragoonFlightState FLylatDragoonFlightStepper::GetPresentationState(const FLylatDragoonCourseFrame& Course) const
+{
+	const float Alpha = Accumulator / FixedDeltaTime;
+
+	// Blend the offset from the course instead of the location, so the pawn stays on the course of now
+	FLylatDragoonFlightState State = CurrentState;
+	State.PositionOffset = FMath::Lerp(PreviousState.PositionOffset, CurrentState.PositionOffset, Alpha);
+	State.Location = Course.GetLocationAtOffset(State.PositionOffset);
+	State.Rotation = FQuat::Slerp(PreviousState.Rotation.Quaternion(), CurrentState.Rotation.Quaternion(), Alpha).Rotator();
+	State.Energy = FMath::Lerp(PreviousState.Energy, CurrentState.Energy, Alpha);
+
+	return State;
+}
+
+void FLylatDragoonFlightStepper::ApplyWorldOffset(const FVector& Offset)
+{
+	PreviousState.Location += Offset;
+	CurrentState.Location += Offset;
+}
+
+void FLylatDragoonFlightStepper::MovePositionOffset(const FVector& Delta, const FLylatDragoonCourseFrame& Course)
+{
+	PreviousState.PositionOffset += Delta;
+	CurrentState.PositionOffset += Delta;
+	CurrentState.Location = Course.GetLocationAtOffset(CurrentState.PositionOffset);
+	PreviousState.Location -= Course.Rotation.RotateVector(Delta);
+}
+
+static void BenchmarkFlightModel(const TArray<FString>& Args)
+{
+	const int32 StepCount = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 1000000;
+	const float DeltaTime = 1.0f / 120.0f;
+
+	FLylatDragoonFlightParams Params;
+	FLylatDragoonFlightInput Input;
+	FLylatDragoonFlightState State;
+	State.Energy = Params.MaxEnergy;
+	FLylatDragoonCourseFrame Course(FVector::ZeroVector, FRotator(0.0f, 90.0f, 0.0f));
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	for (int32 Step = 0; Step < StepCount; ++Step)
+	{
+		// Weave around the course, thrusting every few seconds
+		Input.Right = FMath::Sin(Step * 0.01f);
+		Input.Up = FMath::Cos(Step * 0.013f);
+		Input.Thrust = (Step / 600) % 2 == 0 ? 1.0f : 0.0f;
+		Course.Location.Y += 1000.0f * State.PlayRate * DeltaTime;
+
+		FLylatDragoonFlightModel::Step(State, Input, Params, Course, DeltaTime);
+	}
+
+	const double ElapsedSeconds = FPlatformTime::Seconds() - StartTime;
+	UE_LOG(LogFlying, Display, TEXT("Flight model: %d steps in %.2f ms, %.0f steps per second (final offset %s)"),
+		StepCount, ElapsedSeconds * 1000.0, StepCount / FMath::Max(ElapsedSeconds, 1e-9), *State.PositionOffset.ToString());
+}
+
+static FAutoConsoleCommand BenchmarkFlightModelCommand(
+	TEXT("LylatDragoon.BenchFlightModel"),
+	TEXT("Run the flight model the given number of steps (one million by default) and log the steps per second."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkFlightModel));
@@ -0,0 +1,159 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/** Tuning of the flight model. See the properties of ALylatDragoonPawn with the same names */
+struct FLylatDragoonFlightParams
+{
+	float MaxEnergy;
+	float EnergyConsuptionRate;
+	float EnergyCooldownTime;
+	float EnergyRecoveryRate;
+
+	float SpeedChangeRate;
+	float MinSpeed;
+	float MaxSpeed;
+	float SpeedRecoveryRate;
+
+	float MovementRotationDegrees;
+	float RotChangeBarrellRollRate;
+	float RotChangeRate;
+	float RotationRecoveryRate;
+
+	float MovRefPointDistance;
+	float RightMovementLimit;
+	float LeftMovementLimit;
+	float UpMovementLimit;
+	float DownMovementLimit;
+
+	/** For how long a barrel roll lasts (in seconds) */
+	float BarrelRollDuration;
+
+	FLylatDragoonFlightParams();
+};
+
+/** Input of the pilot during a step */
+struct FLylatDragoonFlightInput
+{
+	float Thrust;
+	float Right;
+	float Up;
+
+	bool bLeftTiltPressed;
+	bool bRightTiltPressed;
+
+	/** Start a barrel roll, ignored if we are already doing one */
+	bool bLeftBarrelRoll;
+	bool bRightBarrelRoll;
+
+	FLylatDragoonFlightInput();
+};
+
+/** Location and rotation of the level course the pawn follows */
+struct FLylatDragoonCourseFrame
+{
+	FVector Location;
+	FRotator Rotation;
+
+	FLylatDragoonCourseFrame();
+	FLylatDragoonCourseFrame(const FVector& InLocation, const FRotator& InRotation);
+
+	/** Blend between two frames of the course */
+	static FLylatDragoonCourseFrame Interpolate(const FLylatDragoonCourseFrame& A, const FLylatDragoonCourseFrame& B, float Alpha);
+
+	/** Returns the world location at the given offset from the course, in the frame of the course */
+	FORCEINLINE FVector GetLocationAtOffset(const FVector& PositionOffset) const { return Location - Rotation.RotateVector(PositionOffset); }
+};
+
+/** Everything the flight model integrates */
+struct FLylatDragoonFlightState
+{
+	FVector Location;
+	FRotator Rotation;
+
+	/**
+	 * Offset from the pawn to the level course in the frame of the course (Y right, Z up, X always zero), inside the
+	 * movement limits. Being relative to the course, it stays precise however far the course is from the origin
+	 */
+	FVector PositionOffset;
+
+	float Energy;
+
+	/** Time left of the energy cooldown. The energy is in cooldown while this is positive */
+	float EnergyCooldownRemaining;
+
+	/** Time left of the barrel roll. We are doing a barrel roll while this is positive */
+	float BarrelRollRemaining;
+
+	/** -1 for a barrel roll to the left, 1 to the right, 0 when we are not doing one */
+	int32 BarrelRollDirection;
+
+	/** Play rate of the level sequence */
+	float PlayRate;
+
+	FLylatDragoonFlightState();
+
+	FORCEINLINE bool IsEnergyInCooldown() const { return EnergyCooldownRemaining > 0.0f; }
+
+	FORCEINLINE bool IsDoingBarrelRoll() const { return BarrelRollDirection != 0; }
+};
+
+/**
+ * Flight of the pawn along the level course, without any dependency on actors or on the world.
+ * Step integrates the state over a fixed time step, so the handling is the same at any frame rate.
+ */
+struct LYLATDRAGOON_API FLylatDragoonFlightModel
+{
+	/** Advance the state by DeltaTime with the given input and course frame */
+	static void Step(FLylatDragoonFlightState& State, const FLylatDragoonFlightInput& Input, const FLylatDragoonFlightParams& Params, const FLylatDragoonCourseFrame& Course, float DeltaTime);
+};
+
+/**
+ * Runs the flight model at a fixed rate for a variable frame rate. The time of every frame is accumulated and
+ * consumed in fixed steps, and the state presented is blended between the last two steps with the time left.
+ */
+struct LYLATDRAGOON_API FLylatDragoonFlightStepper
+{
+	FLylatDragoonFlightStepper();
+
+	/** Time of a step (in seconds) */
+	float FixedDeltaTime;
+
+	/** Max number of steps in a frame, the time left is dropped so a long hitch doesn't stall the game */
+	int32 MaxSubsteps;
+
+	/** Start from the given state, forgetting the time accumulated */
+	void Reset(const FLylatDragoonFlightState& State);
+
+	/**
+	 * Run the steps that fit in the time of this frame. The course frame of every step is blended between the course
+	 * in the last frame and the course now. The barrel roll requests of the input only apply to the first step.
+	 * Returns the number of steps run.
+	 */
+	int32 Advance(float DeltaTime, const FLylatDragoonFlightInput& Input, const FLylatDragoonFlightParams& Params, const FLylatDragoonCourseFrame& PreviousCourse, const FLylatDragoonCourseFrame& Course);
+
+	/** Returns the state of the last step */
+	FORCEINLINE const FLylatDragoonFlightState& GetState() const { return CurrentState; }
+
+	/** Returns the state to present, blended between the last two steps and placed on the course frame of now */
+	FLylatDragoonFlightState GetPresentationState(const FLylatDragoonCourseFrame& Course) const;
+
+	/** Move the world locations of the states, when the world origin is rebased */
+	void ApplyWorldOffset(const FVector& Offset);
+
+	/** Move the pawn by the given offset in the frame of the course, in the last two steps so the blend doesn't undo it */
+	void MovePositionOffset(const FVector& Delta, const FLylatDragoonCourseFrame& Course);
+
+	/** Returns the total number of steps run */
+	FORCEINLINE uint32 GetStepCount() const { return StepCount; }
+
+private:
+
+	FLylatDragoonFlightState PreviousState;
+	FLylatDragoonFlightState CurrentState;
+
+	/** Time not consumed by the steps yet */
+	float Accumulator;
+
+	uint32 StepCount;
+};
@@ -2,11 +2,129 @@
 
 #include "LylatDragoon.h"
 #include "LylatDragoonGameMode.h"
+#include "LylatDragoonArena.h"
+#include "LylatDragoonAssetStreamer.h"
+#include "LylatDragoonBulletField.h"
+#include "LylatDragoonDamageQueue.h"
+#include "LylatDragoonEnemy.h"
+#include "LylatDragoonEnemySignificance.h"
+#include "LylatDragoonEnemySimulation.h"
 #include "LylatDragoonPawn.h"
+#include "LylatDragoonProjectilePool.h"
+#include "LylatDragoonSoakRecorder.h"
+#include "LylatDragoonSwarm.h"
+#include "LylatDragoonTargeting.h"
+
+#include "Engine/Engine.h"
+#include "Misc/CoreDelegates.h"
 
 ALylatDragoonGameMode::ALylatDragoonGameMode(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
 	// set default pawn class to our flying pawn
 	DefaultPawnClass = ALylatDragoonPawn::StaticClass();
+
+	// Create the projectile pool
+	ProjectilePool = CreateDefaultSubobject<ULylatDragoonProjectilePool>(TEXT("ProjectilePool0"));
+
+	// Create the asset streamer
+	AssetStreamer = CreateDefaultSubobject<ULylatDragoonAssetStreamer>(TEXT("AssetStreamer0"));
+
+	// Create the enemy simulation
+	EnemySimulation = CreateDefaultSubobject<ULylatDragoonEnemySimulation>(TEXT("EnemySimulation0"));
+
+	// Create the enemy significance
+	EnemySignificance = CreateDefaultSubobject<ULylatDragoonEnemySignificance>(TEXT("EnemySignificance0"));
+
+	// Create the damage queue
+	DamageQueue = CreateDefaultSubobject<ULylatDragoonDamageQueue>(TEXT("DamageQueue0"));
+
+	// Create the targeting
+	Targeting = CreateDefaultSubobject<ULylatDragoonTargeting>(TEXT("Targeting0"));
+
+	Swarm = nullptr;
+	BulletField = nullptr;
+	SoakRecorder = nullptr;
+}
+
+void ALylatDragoonGameMode::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Record the frame times when launched for a soak test
+	if (FLylatDragoonSoakSettings::Get().bEnabled)
+	{
+		SoakRecorder = NewObject<ULylatDragoonSoakRecorder>(this, TEXT("SoakRecorder0"));
+		SoakRecorder->RegisterComponent();
+	}
+
+	// Check the clients once they had the time to join and fly
+	float CoopCheckSeconds = 0.0f;
+	if (FParse::Value(FCommandLine::Get(), TEXT("LylatCheckCoop="), CoopCheckSeconds))
+	{
+		FTimerHandle TimerHandle;
+		GetWorldTimerManager().SetTimer(TimerHandle, this, &ALylatDragoonGameMode::RunCoopCheck, FMath::Max(CoopCheckSeconds, 1.0f), false);
+	}
+
+	BeginFrameHandle = FCoreDelegates::OnBeginFrame.AddUObject(this, &ALylatDragoonGameMode::OnBeginFrame);
+}
+
+void ALylatDragoonGameMode::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	FCoreDelegates::OnBeginFrame.Remove(BeginFrameHandle);
+
+	UE_LOG(LogFlying, Log, TEXT("Frame arena peaked at %d bytes"), FLylatDragoonArena::GetFrameArena().GetPeakBytes());
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ALylatDragoonGameMode::OnBeginFrame()
+{
+	// Scratch data of the frame is never kept, so whatever is left can go
+	FLylatDragoonArena& FrameArena = FLylatDragoonArena::GetFrameArena();
+	LYLATDRAGOON_SET_COUNTER(FrameArenaPeak, FrameArena.GetPeakBytes());
+	FrameArena.Reset();
+}
+
+void ALylatDragoonGameMode::RunCoopCheck()
+{
+	GEngine->Exec(GetWorld(), TEXT("LylatDragoon.CheckCoop"));
+	FPlatformMisc::RequestExit(false);
+}
+
+ALylatDragoonSwarm* ALylatDragoonGameMode::GetSwarm()
+{
+	if (!Swarm)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.Owner = this;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		Swarm = GetWorld()->SpawnActor<ALylatDragoonSwarm>(SpawnParams);
+	}
+	return Swarm;
+}
+
+ALylatDragoonBulletField* ALylatDragoonGameMode::GetBulletField()
+{
+	if (!BulletField)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.Owner = this;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		BulletField = GetWorld()->SpawnActor<ALylatDragoonBulletField>(SpawnParams);
+	}
+	return BulletField;
+}
+
+void ALylatDragoonGameMode::RegisterEnemy(ALylatDragoonEnemy* Enemy)
+{
+	Enemies.AddUnique(Enemy);
+
+	// Tick at the rate of the bucket the enemy spawned in, instead of every frame until the next ranking
+	EnemySignificance->AssignBucket(Enemy);
+}
+
+void ALylatDragoonGameMode::UnregisterEnemy(ALylatDragoonEnemy* Enemy)
+{
+	Enemies.RemoveSingleSwap(Enemy, false);
 }
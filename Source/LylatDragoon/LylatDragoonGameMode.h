@@ -8,8 +8,97 @@ class ALylatDragoonGameMode : public AGameMode
 {
 	GENERATED_BODY()
 
+	/** Pool of projectiles shared by everyone who shoots */
+	UPROPERTY(Category = Combat, VisibleDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	class ULylatDragoonProjectilePool* ProjectilePool;
+
+	/** Loads the content of the game ahead of need */
+	UPROPERTY(Category = Content, VisibleDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	class ULylatDragoonAssetStreamer* AssetStreamer;
+
+	/** Moves the enemies on their courses */
+	UPROPERTY(Category = Combat, VisibleDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	class ULylatDragoonEnemySimulation* EnemySimulation;
+
+	/** Decides how often every enemy ticks */
+	UPROPERTY(Category = Combat, VisibleDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	class ULylatDragoonEnemySignificance* EnemySignificance;
+
+	/** Applies the damage of every hit once per frame */
+	UPROPERTY(Category = Combat, VisibleDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	class ULylatDragoonDamageQueue* DamageQueue;
+
+	/** Finds the enemies to lock on */
+	UPROPERTY(Category = Combat, VisibleDefaultsOnly, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	class ULylatDragoonTargeting* Targeting;
+
 public:
 	ALylatDragoonGameMode(const FObjectInitializer& ObjectInitializer);
+
+	// Begin AActor overrides
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	// End AActor overrides
+
+	/** Add an enemy to the list of enemies alive */
+	void RegisterEnemy(class ALylatDragoonEnemy* Enemy);
+
+	/** Remove an enemy from the list of enemies alive */
+	void UnregisterEnemy(class ALylatDragoonEnemy* Enemy);
+
+	/** Returns the actor drawing the enemies that are not heroes, spawning it the first time */
+	class ALylatDragoonSwarm* GetSwarm();
+
+	/** Returns the actor firing and drawing the bullets of the enemies, spawning it the first time */
+	class ALylatDragoonBulletField* GetBulletField();
+
+	/** Returns the enemies alive in the level */
+	FORCEINLINE const TArray<class ALylatDragoonEnemy*>& GetEnemies() const { return Enemies; }
+
+	/** Returns AssetStreamer subobject **/
+	FORCEINLINE class ULylatDragoonAssetStreamer* GetAssetStreamer() const { return AssetStreamer; }
+
+	/** Returns EnemySimulation subobject **/
+	FORCEINLINE class ULylatDragoonEnemySimulation* GetEnemySimulation() const { return EnemySimulation; }
+
+	/** Returns EnemySignificance subobject **/
+	FORCEINLINE class ULylatDragoonEnemySignificance* GetEnemySignificance() const { return EnemySignificance; }
+
+	/** Returns DamageQueue subobject **/
+	FORCEINLINE class ULylatDragoonDamageQueue* GetDamageQueue() const { return DamageQueue; }
+
+	/** Returns Targeting subobject **/
+	FORCEINLINE class ULylatDragoonTargeting* GetTargeting() const { return Targeting; }
+
+	/** Returns ProjectilePool subobject **/
+	FORCEINLINE class ULylatDragoonProjectilePool* GetProjectilePool() const { return ProjectilePool; }
+
+private:
+
+	/** Run the co-op check and exit, when launched with -LylatCheckCoop */
+	void RunCoopCheck();
+
+	/** Reset the frame arena before anything is updated in the new frame */
+	void OnBeginFrame();
+
+	/** Handle of OnBeginFrame in the core delegates */
+	FDelegateHandle BeginFrameHandle;
+
+	/** Enemies alive in the level */
+	UPROPERTY(Transient)
+	TArray<class ALylatDragoonEnemy*> Enemies;
+
+	/** Draws the enemies that are not heroes */
+	UPROPERTY(Transient)
+	class ALylatDragoonSwarm* Swarm;
+
+	/** Fires and draws the bullets of the enemies */
+	UPROPERTY(Transient)
+	class ALylatDragoonBulletField* BulletField;
+
+	/** Frame time recorder, only created for soak tests */
+	UPROPERTY(Transient)
+	class ULylatDragoonSoakRecorder* SoakRecorder;
 };
 
 
@@ -2,16 +2,47 @@
 
 #include "LylatDragoon.h"
 #include "LylatDragoonHUD.h"
+#include "LylatDragoonEnemy.h"
+#include "LylatDragoonGameMode.h"
 #include "LylatDragoonPawn.h"
 
+#include "CanvasItem.h"
+#include "Engine/Canvas.h"
+#include "Engine/Engine.h"
+#include "EngineUtils.h"
+#include "RenderUtils.h"
+#include "SceneView.h"
+
+static TAutoConsoleVariable<int32> CVarShowHUDMarkers(
+	TEXT("LylatDragoon.ShowHUDMarkers"),
+	0,
+	TEXT("Show on screen the number of enemy markers and the time spent drawing them."));
+
+static TAutoConsoleVariable<int32> CVarHUDTestMarkers(
+	TEXT("LylatDragoon.HUDTestMarkers"),
+	0,
+	TEXT("Add the given number of markers around the aim point, to measure the cost of the markers."));
+
 ALylatDragoonHUD::ALylatDragoonHUD(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
 	CrosshairSize = 1.0f;
+	LockOnMarkerSize = 24.0f;
+	LockOnMarkerColor = FLinearColor::Red;
+	MarkerSize = 32.0f;
+	MarkerThickness = 2.0f;
+	MarkerColor = FLinearColor::White;
+	HealthBarHeight = 3.0f;
+	HealthColor = FLinearColor::Green;
+	OffScreenArrowSize = 12.0f;
+	OffScreenMargin = 24.0f;
+	MaxMarkerDistance = 30000.0f;
 }
 
 void ALylatDragoonHUD::DrawHUD()
 {
+	LYLATDRAGOON_SCOPE_CYCLE_COUNTER(HUDDraw);
+
 	Super::DrawHUD();
 
 	ALylatDragoonPawn* LDPawn = Cast<ALylatDragoonPawn>(PlayerOwner->GetPawn());
@@ -20,6 +51,82 @@ void ALylatDragoonHUD::DrawHUD()
 		FVector CrosshairLocation = Project(LDPawn->GetAimPointLocation());
 
 		DrawTextureSimple(CrosshairTexture, CrosshairLocation.X - ((CrosshairTexture->GetSurfaceWidth() * CrosshairSize) / 2), CrosshairLocation.Y - ((CrosshairTexture->GetSurfaceHeight() * CrosshairSize) / 2), CrosshairSize);
+
+		DrawMarkers(LDPawn);
+	}
+}
+
+void ALylatDragoonHUD::DrawMarkers(ALylatDragoonPawn* LDPawn)
+{
+	if (!Canvas || !Canvas->SceneView)
+	{
+		return;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	// Every enemy alive, from the game mode where it runs, from the enemies replicated by the server on clients
+	Markers.Reset();
+	const TArray<TWeakObjectPtr<ALylatDragoonEnemy>>& LockedTargets = LDPawn->GetLockedTargets();
+	ALylatDragoonGameMode* GameMode = GetWorld()->GetAuthGameMode<ALylatDragoonGameMode>();
+	if (GameMode)
+	{
+		for (ALylatDragoonEnemy* Enemy : GameMode->GetEnemies())
+		{
+			Markers.Add(Enemy->GetActorLocation(), Enemy->CurrentHealth / FMath::Max(Enemy->MaxHealth, 1.0f), LockedTargets.Contains(Enemy));
+		}
+	}
+	else
+	{
+		for (TActorIterator<ALylatDragoonEnemy> EnemyItr(GetWorld()); EnemyItr; ++EnemyItr)
+		{
+			ALylatDragoonEnemy* Enemy = *EnemyItr;
+			Markers.Add(Enemy->GetActorLocation(), Enemy->CurrentHealth / FMath::Max(Enemy->MaxHealth, 1.0f), LockedTargets.Contains(Enemy));
+		}
+	}
+
+	// The same markers every frame, scattered around the aim point
+	const int32 TestMarkerCount = CVarHUDTestMarkers.GetValueOnGameThread();
+	FRandomStream TestRandom(0);
+	for (int32 Index = 0; Index < TestMarkerCount; ++Index)
+	{
+		Markers.Add(LDPawn->GetAimPointLocation() + TestRandom.GetUnitVector() * TestRandom.FRandRange(0.0f, 20000.0f), TestRandom.FRand(), false);
+	}
+
+	FLylatDragoonHUDMarkerStyle Style;
+	Style.MarkerSize = MarkerSize;
+	Style.MarkerThickness = MarkerThickness;
+	Style.LockOnMarkerSize = LockOnMarkerSize;
+	Style.HealthBarHeight = HealthBarHeight;
+	Style.OffScreenArrowSize = OffScreenArrowSize;
+	Style.OffScreenMargin = OffScreenMargin;
+	Style.MaxMarkerDistance = MaxMarkerDistance;
+	Style.MarkerColor = MarkerColor;
+	Style.LockOnMarkerColor = LockOnMarkerColor;
+	Style.HealthColor = HealthColor;
+
+	Markers.Project(Canvas->SceneView->ViewMatrices.GetViewProjectionMatrix(), Canvas->ClipX, Canvas->ClipY);
+	MarkerTriangles.Reset();
+	const int32 DrawnCount = Markers.BuildTriangles(MarkerTriangles, Style, Canvas->ClipX, Canvas->ClipY);
+
+	// One canvas item for every marker. The triangles are swapped in and out of the item to keep their memory
+	const int32 TriangleCount = MarkerTriangles.Num();
+	if (TriangleCount > 0)
+	{
+		FCanvasTriangleItem TriangleItem(FVector2D::ZeroVector, FVector2D::ZeroVector, FVector2D::ZeroVector, GWhiteTexture);
+		Exchange(TriangleItem.TriangleList, MarkerTriangles);
+		TriangleItem.BlendMode = SE_BLEND_Translucent;
+		Canvas->DrawItem(TriangleItem);
+		Exchange(TriangleItem.TriangleList, MarkerTriangles);
+	}
+
+	LYLATDRAGOON_SET_COUNTER(HUDMarkers, DrawnCount);
+
+	if (CVarShowHUDMarkers.GetValueOnGameThread() != 0 && GEngine)
+	{
+		const double ElapsedMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		GEngine->AddOnScreenDebugMessage((uint64)GetUniqueID(), 0.0f, FColor::Yellow, FString::Printf(TEXT("HUD markers: %d of %d drawn, %d triangles, %.3f ms"),
+			DrawnCount, Markers.Num(), TriangleCount, ElapsedMs));
 	}
 }
 
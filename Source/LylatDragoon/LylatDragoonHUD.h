@@ -3,6 +3,7 @@
 #pragma once
 
 #include "GameFramework/HUD.h"
+#include "LylatDragoonHUDMarkers.h"
 #include "LylatDragoonHUD.generated.h"
 
 /**
@@ -27,4 +28,52 @@ public:
 	UPROPERTY(Category = LDHUD, EditAnywhere)
 	float CrosshairSize;
 
+	/** Size of the square drawn around the locked targets (in pixels) */
+	UPROPERTY(Category = LDHUD, EditAnywhere)
+	float LockOnMarkerSize;
+
+	UPROPERTY(Category = LDHUD, EditAnywhere)
+	FLinearColor LockOnMarkerColor;
+
+	/** Size of the brackets drawn around the enemies (in pixels) */
+	UPROPERTY(Category = LDHUD, EditAnywhere)
+	float MarkerSize;
+
+	/** Thickness of the lines of the brackets (in pixels) */
+	UPROPERTY(Category = LDHUD, EditAnywhere)
+	float MarkerThickness;
+
+	UPROPERTY(Category = LDHUD, EditAnywhere)
+	FLinearColor MarkerColor;
+
+	/** Height of the health bar under the brackets (in pixels) */
+	UPROPERTY(Category = LDHUD, EditAnywhere)
+	float HealthBarHeight;
+
+	UPROPERTY(Category = LDHUD, EditAnywhere)
+	FLinearColor HealthColor;
+
+	/** Size of the arrows pointing to the enemies off screen (in pixels) */
+	UPROPERTY(Category = LDHUD, EditAnywhere)
+	float OffScreenArrowSize;
+
+	/** Distance between the arrows and the edge of the screen (in pixels) */
+	UPROPERTY(Category = LDHUD, EditAnywhere)
+	float OffScreenMargin;
+
+	/** Enemies further from the camera have no marker */
+	UPROPERTY(Category = LDHUD, EditAnywhere)
+	float MaxMarkerDistance;
+
+private:
+
+	/** Project the markers of the enemies and draw them with a single batch of triangles */
+	void DrawMarkers(class ALylatDragoonPawn* LDPawn);
+
+	/** Markers of the enemies in this frame */
+	FLylatDragoonHUDMarkers Markers;
+
+	/** Triangles of the markers, kept to reuse the memory */
+	TArray<struct FCanvasUVTri> MarkerTriangles;
+
 };
@@ -0,0 +1,224 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonHUDMarkers.h"
+
+#include "CanvasItem.h"
+#include "Engine/Canvas.h"
+
+FLylatDragoonHUDMarkerStyle::FLylatDragoonHUDMarkerStyle()
+	: MarkerSize(32.0f)
+	, MarkerThickness(2.0f)
+	, LockOnMarkerSize(24.0f)
+	, HealthBarHeight(3.0f)
+	, OffScreenArrowSize(12.0f)
+	, OffScreenMargin(24.0f)
+	, MaxMarkerDistance(30000.0f)
+	, MarkerColor(FLinearColor::White)
+	, LockOnMarkerColor(FLinearColor::Red)
+	, HealthColor(FLinearColor::Green)
+	, HealthBackgroundColor(0.0f, 0.0f, 0.0f, 0.5f)
+{
+}
+
+void FLylatDragoonHUDMarkers::Add(const FVector& Location, float InHealth, bool bLockedOn)
+{
+	LocationX.Add(Location.X);
+	LocationY.Add(Location.Y);
+	LocationZ.Add(Location.Z);
+	LockedOn.Add(bLockedOn);
+	Health.Add(InHealth);
+}
+
+void FLylatDragoonHUDMarkers::Reset()
+{
+	LocationX.Reset();
+	LocationY.Reset();
+	LocationZ.Reset();
+	Health.Reset();
+	LockedOn.Reset();
+	ScreenX.Reset();
+	ScreenY.Reset();
+	Depth.Reset();
+}
+
+void FLylatDragoonHUDMarkers::Project(const FMatrix& ViewProjectionMatrix, float ViewWidth, float ViewHeight)
+{
+	const int32 Count = Num();
+	const int32 VectorCount = Count & ~3;
+
+	ScreenX.SetNumUninitialized(Count, false);
+	ScreenY.SetNumUninitialized(Count, false);
+	Depth.SetNumUninitialized(Count, false);
+
+	const float* RESTRICT LocX = LocationX.GetData();
+	const float* RESTRICT LocY = LocationY.GetData();
+	const float* RESTRICT LocZ = LocationZ.GetData();
+	float* RESTRICT OutX = ScreenX.GetData();
+	float* RESTRICT OutY = ScreenY.GetData();
+	float* RESTRICT OutDepth = Depth.GetData();
+
+	// Same mapping as UCanvas::Project. Points behind the view are divided by -W, so they stay on their side of the screen
+	const float HalfWidth = ViewWidth * 0.5f;
+	const float HalfHeight = ViewHeight * 0.5f;
+	const FMatrix& M = ViewProjectionMatrix;
+
+	// Four markers per iteration, with the X, Y and W rows of the matrix splatted
+	const VectorRegister M00 = VectorSetFloat1(M.M[0][0]), M10 = VectorSetFloat1(M.M[1][0]), M20 = VectorSetFloat1(M.M[2][0]), M30 = VectorSetFloat1(M.M[3][0]);
+	const VectorRegister M01 = VectorSetFloat1(M.M[0][1]), M11 = VectorSetFloat1(M.M[1][1]), M21 = VectorSetFloat1(M.M[2][1]), M31 = VectorSetFloat1(M.M[3][1]);
+	const VectorRegister M03 = VectorSetFloat1(M.M[0][3]), M13 = VectorSetFloat1(M.M[1][3]), M23 = VectorSetFloat1(M.M[2][3]), M33 = VectorSetFloat1(M.M[3][3]);
+	const VectorRegister VHalfWidth = VectorSetFloat1(HalfWidth);
+	const VectorRegister VHalfHeight = VectorSetFloat1(HalfHeight);
+	const VectorRegister VSmall = VectorSetFloat1(KINDA_SMALL_NUMBER);
+
+	for (int32 Index = 0; Index < VectorCount; Index += 4)
+	{
+		const VectorRegister X = VectorLoad(LocX + Index);
+		const VectorRegister Y = VectorLoad(LocY + Index);
+		const VectorRegister Z = VectorLoad(LocZ + Index);
+
+		const VectorRegister ClipX = VectorMultiplyAdd(X, M00, VectorMultiplyAdd(Y, M10, VectorMultiplyAdd(Z, M20, M30)));
+		const VectorRegister ClipY = VectorMultiplyAdd(X, M01, VectorMultiplyAdd(Y, M11, VectorMultiplyAdd(Z, M21, M31)));
+		const VectorRegister ClipW = VectorMultiplyAdd(X, M03, VectorMultiplyAdd(Y, M13, VectorMultiplyAdd(Z, M23, M33)));
+		const VectorRegister InvW = VectorReciprocalAccurate(VectorMax(VectorAbs(ClipW), VSmall));
+
+		VectorStore(VectorMultiplyAdd(VectorMultiply(ClipX, InvW), VHalfWidth, VHalfWidth), OutX + Index);
+		VectorStore(VectorSubtract(VHalfHeight, VectorMultiply(VectorMultiply(ClipY, InvW), VHalfHeight)), OutY + Index);
+		VectorStore(ClipW, OutDepth + Index);
+	}
+
+	// Remaining markers
+	for (int32 Index = VectorCount; Index < Count; ++Index)
+	{
+		const FVector4 Clip = M.TransformFVector4(FVector4(LocX[Index], LocY[Index], LocZ[Index], 1.0f));
+		const float InvW = 1.0f / FMath::Max(FMath::Abs(Clip.W), KINDA_SMALL_NUMBER);
+
+		OutX[Index] = HalfWidth + Clip.X * InvW * HalfWidth;
+		OutY[Index] = HalfHeight - Clip.Y * InvW * HalfHeight;
+		OutDepth[Index] = Clip.W;
+	}
+}
+
+static FORCEINLINE void AddTriangle(TArray<FCanvasUVTri>& Triangles, const FVector2D& A, const FVector2D& B, const FVector2D& C, const FLinearColor& Color)
+{
+	FCanvasUVTri& Triangle = Triangles[Triangles.AddUninitialized()];
+	Triangle.V0_Pos = A;
+	Triangle.V1_Pos = B;
+	Triangle.V2_Pos = C;
+	Triangle.V0_UV = Triangle.V1_UV = Triangle.V2_UV = FVector2D::ZeroVector;
+	Triangle.V0_Color = Triangle.V1_Color = Triangle.V2_Color = Color;
+}
+
+static FORCEINLINE void AddQuad(TArray<FCanvasUVTri>& Triangles, float Left, float Top, float Right, float Bottom, const FLinearColor& Color)
+{
+	AddTriangle(Triangles, FVector2D(Left, Top), FVector2D(Right, Top), FVector2D(Right, Bottom), Color);
+	AddTriangle(Triangles, FVector2D(Left, Top), FVector2D(Right, Bottom), FVector2D(Left, Bottom), Color);
+}
+
+int32 FLylatDragoonHUDMarkers::BuildTriangles(TArray<FCanvasUVTri>& OutTriangles, const FLylatDragoonHUDMarkerStyle& Style, float ViewWidth, float ViewHeight) const
+{
+	const FVector2D Center(ViewWidth * 0.5f, ViewHeight * 0.5f);
+	const float Thickness = Style.MarkerThickness;
+	int32 DrawnCount = 0;
+
+	for (int32 Index = 0; Index < Depth.Num(); ++Index)
+	{
+		if (FMath::Abs(Depth[Index]) > Style.MaxMarkerDistance)
+		{
+			continue;
+		}
+		++DrawnCount;
+
+		const float X = ScreenX[Index];
+		const float Y = ScreenY[Index];
+		if (Depth[Index] > 0.0f && X >= 0.0f && X <= ViewWidth && Y >= 0.0f && Y <= ViewHeight)
+		{
+			// Corners of a bracket around the marker
+			const float HalfSize = (LockedOn[Index] ? Style.LockOnMarkerSize : Style.MarkerSize) * 0.5f;
+			const float Corner = HalfSize * 0.4f;
+			const FLinearColor& Color = LockedOn[Index] ? Style.LockOnMarkerColor : Style.MarkerColor;
+			const float Left = X - HalfSize;
+			const float Right = X + HalfSize;
+			const float Top = Y - HalfSize;
+			const float Bottom = Y + HalfSize;
+			AddQuad(OutTriangles, Left, Top, Left + Corner, Top + Thickness, Color);
+			AddQuad(OutTriangles, Left, Top, Left + Thickness, Top + Corner, Color);
+			AddQuad(OutTriangles, Right - Corner, Top, Right, Top + Thickness, Color);
+			AddQuad(OutTriangles, Right - Thickness, Top, Right, Top + Corner, Color);
+			AddQuad(OutTriangles, Left, Bottom - Thickness, Left + Corner, Bottom, Color);
+			AddQuad(OutTriangles, Left, Bottom - Corner, Left + Thickness, Bottom, Color);
+			AddQuad(OutTriangles, Right - Corner, Bottom - Thickness, Right, Bottom, Color);
+			AddQuad(OutTriangles, Right - Thickness, Bottom - Corner, Right, Bottom, Color);
+
+			// Health bar under the bracket
+			const float BarTop = Bottom + Thickness;
+			const float BarBottom = BarTop + Style.HealthBarHeight;
+			AddQuad(OutTriangles, Left, BarTop, Right, BarBottom, Style.HealthBackgroundColor);
+			AddQuad(OutTriangles, Left, BarTop, Left + (Right - Left) * FMath::Clamp(Health[Index], 0.0f, 1.0f), BarBottom, Style.HealthColor);
+		}
+		else
+		{
+			// Arrow on the edge of the screen, pointing from the center towards the marker
+			FVector2D Direction = FVector2D(X, Y) - Center;
+			Direction = Direction.IsNearlyZero() ? FVector2D(0.0f, 1.0f) : Direction.GetSafeNormal();
+			const float ScaleX = FMath::Abs(Direction.X) > KINDA_SMALL_NUMBER ? (Center.X - Style.OffScreenMargin) / FMath::Abs(Direction.X) : MAX_flt;
+			const float ScaleY = FMath::Abs(Direction.Y) > KINDA_SMALL_NUMBER ? (Center.Y - Style.OffScreenMargin) / FMath::Abs(Direction.Y) : MAX_flt;
+			const FVector2D Base = Center + Direction * FMath::Max(FMath::Min(ScaleX, ScaleY), 0.0f);
+			const FVector2D Side(-Direction.Y, Direction.X);
+			const float Size = Style.OffScreenArrowSize;
+			AddTriangle(OutTriangles, Base + Direction * Size, Base + Side * (Size * 0.5f), Base - Side * (Size * 0.5f),
+				LockedOn[Index] ? Style.LockOnMarkerColor : Style.MarkerColor);
+		}
+	}
+
+	return DrawnCount;
+}
+
+static void BenchmarkHUDMarkers(const TArray<FString>& Args)
+{
+	const int32 MarkerCount = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 1000;
+	const int32 FrameCount = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 1000;
+	const float ViewWidth = 1920.0f;
+	const float ViewHeight = 1080.0f;
+
+	// A view at the origin looking down X, like the camera of the pawn
+	const FMatrix ViewMatrix(FPlane(0, 0, 1, 0), FPlane(1, 0, 0, 0), FPlane(0, 1, 0, 0), FPlane(0, 0, 0, 1));
+	const FMatrix ProjectionMatrix = FReversedZPerspectiveMatrix(FMath::DegreesToRadians(45.0f), ViewWidth, ViewHeight, 10.0f);
+	const FMatrix ViewProjectionMatrix = ViewMatrix * ProjectionMatrix;
+
+	// Markers all around the view, most of them in front of it
+	FRandomStream Random(0);
+	FLylatDragoonHUDMarkers Markers;
+	FLylatDragoonHUDMarkerStyle Style;
+	TArray<FCanvasUVTri> Triangles;
+
+	double ProjectSeconds = 0.0;
+	double BuildSeconds = 0.0;
+	int32 DrawnCount = 0;
+	for (int32 Frame = 0; Frame < FrameCount; ++Frame)
+	{
+		Markers.Reset();
+		for (int32 Index = 0; Index < MarkerCount; ++Index)
+		{
+			Markers.Add(FVector(Random.FRandRange(-5000.0f, 25000.0f), Random.FRandRange(-8000.0f, 8000.0f), Random.FRandRange(-5000.0f, 5000.0f)), Random.FRand(), Index % 50 == 0);
+		}
+
+		const double StartTime = FPlatformTime::Seconds();
+		Markers.Project(ViewProjectionMatrix, ViewWidth, ViewHeight);
+		const double ProjectedTime = FPlatformTime::Seconds();
+		Triangles.Reset();
+		DrawnCount = Markers.BuildTriangles(Triangles, Style, ViewWidth, ViewHeight);
+		const double EndTime = FPlatformTime::Seconds();
+
+		ProjectSeconds += ProjectedTime - StartTime;
+		BuildSeconds += EndTime - ProjectedTime;
+	}
+
+	UE_LOG(LogFlying, Display, TEXT("HUD markers: %d markers, %d drawn with %d triangles, projection %.4f ms, triangles %.4f ms per frame"),
+		MarkerCount, DrawnCount, Triangles.Num(), ProjectSeconds * 1000.0 / FrameCount, BuildSeconds * 1000.0 / FrameCount);
+}
+
+static FAutoConsoleCommand BenchmarkHUDMarkersCommand(
+	TEXT("LylatDragoon.BenchHUDMarkers"),
+	TEXT("Project the given number of HUD markers (1000 by default) and build their triangles for the given number of frames (1000 by default) and log the time per frame."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&BenchmarkHUDMarkers));
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/** Look of the markers, see the properties of ALylatDragoonHUD with the same names */
+struct FLylatDragoonHUDMarkerStyle
+{
+	float MarkerSize;
+	float MarkerThickness;
+	float LockOnMarkerSize;
+	float HealthBarHeight;
+	float OffScreenArrowSize;
+	float OffScreenMargin;
+	float MaxMarkerDistance;
+
+	FLinearColor MarkerColor;
+	FLinearColor LockOnMarkerColor;
+	FLinearColor HealthColor;
+	FLinearColor HealthBackgroundColor;
+
+	FLylatDragoonHUDMarkerStyle();
+};
+
+/**
+ * Markers of the enemies drawn by the HUD, stored as structure of arrays. Every frame the markers are projected
+ * to the screen four at a time with the view-projection matrix, and turned into a single list of triangles:
+ * brackets and a health bar for the markers on screen, an arrow on the edge of the screen for the others.
+ */
+struct LYLATDRAGOON_API FLylatDragoonHUDMarkers
+{
+	TArray<float> LocationX;
+	TArray<float> LocationY;
+	TArray<float> LocationZ;
+
+	/** Health left, from 0 to 1 */
+	TArray<float> Health;
+
+	TArray<bool> LockedOn;
+
+	/** Position on screen (in pixels) and depth in front of the view, computed by Project */
+	TArray<float> ScreenX;
+	TArray<float> ScreenY;
+	TArray<float> Depth;
+
+	FORCEINLINE int32 Num() const { return Health.Num(); }
+
+	/** Add a marker */
+	void Add(const FVector& Location, float InHealth, bool bLockedOn);
+
+	/** Remove every marker keeping the memory */
+	void Reset();
+
+	/** Project every marker to a view of the given size (in pixels). Markers behind the view get a negative depth */
+	void Project(const FMatrix& ViewProjectionMatrix, float ViewWidth, float ViewHeight);
+
+	/** Append the triangles of the projected markers, culling the ones too far. Returns the number of markers drawn */
+	int32 BuildTriangles(TArray<struct FCanvasUVTri>& OutTriangles, const FLylatDragoonHUDMarkerStyle& Style, float ViewWidth, float ViewHeight) const;
+};
@@ -0,0 +1,288 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonInputRecording.h"
+
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace LylatDragoonInputRecording
+{
+	/** Identifies the file as an input recording */
+	static const uint32 Magic = 0x4C44494E;
+
+	/** Increase when the format of the stream changes */
+	static const uint32 Version = 1;
+
+	/** Bits of the flags byte stored before every frame. The low bits flag the axes that changed. */
+	static const uint8 ActionsFlag = 1 << (uint8)ELylatDragoonInputAxis::Count;
+	static const uint8 DeltaTimeFlag = ActionsFlag << 1;
+
+	static_assert((uint8)ELylatDragoonInputAxis::Count <= 6, "The axes and the flags have to fit in one byte");
+
+	/** Decode one frame on top of the previous one */
+	static void DecodeFrame(FArchive& Ar, const FLylatDragoonInputFrame& PreviousFrame, FLylatDragoonInputFrame& OutFrame)
+	{
+		OutFrame.DeltaTime = PreviousFrame.DeltaTime;
+		FMemory::Memcpy(OutFrame.Axes, PreviousFrame.Axes, sizeof(OutFrame.Axes));
+		OutFrame.AxisSetMask = PreviousFrame.AxisSetMask;
+		OutFrame.Actions.Reset();
+
+		uint8 Flags = 0;
+		Ar << Flags;
+
+		for (int32 Axis = 0; Axis < (int32)ELylatDragoonInputAxis::Count; ++Axis)
+		{
+			if (Flags & (1 << Axis))
+			{
+				Ar << OutFrame.Axes[Axis];
+				OutFrame.AxisSetMask |= 1 << Axis;
+			}
+		}
+
+		if (Flags & ActionsFlag)
+		{
+			uint8 ActionCount = 0;
+			Ar << ActionCount;
+			for (uint8 ActionIndex = 0; ActionIndex < ActionCount; ++ActionIndex)
+			{
+				uint8 Action = 0;
+				Ar << Action;
+				OutFrame.Actions.Add((ELylatDragoonInputAction)FMath::Min<uint8>(Action, (uint8)ELylatDragoonInputAction::Count - 1));
+			}
+		}
+
+		if (Flags & DeltaTimeFlag)
+		{
+			Ar << OutFrame.DeltaTime;
+		}
+
+		Ar << OutFrame.StateHash;
+	}
+}
+
+FLylatDragoonInputFrame::FLylatDragoonInputFrame()
+	: DeltaTime(0.0f)
+	, AxisSetMask(0)
+	, StateHash(0)
+{
+	FMemory::Memzero(Axes, sizeof(Axes));
+}
+
+FLylatDragoonInputRecorder::FLylatDragoonInputRecorder()
+	: FrameCount(0)
+	, Recording(false)
+{
+}
+
+void FLylatDragoonInputRecorder::Start(const FString& InMapName)
+{
+	CurrentFrame = FLylatDragoonInputFrame();
+	PreviousFrame = FLylatDragoonInputFrame();
+	MapName = InMapName;
+	Stream.Reset();
+	FrameCount = 0;
+	Recording = true;
+}
+
+void FLylatDragoonInputRecorder::Stop()
+{
+	Recording = false;
+}
+
+void FLylatDragoonInputRecorder::RecordAxis(ELylatDragoonInputAxis Axis, float Value)
+{
+	if (Recording)
+	{
+		CurrentFrame.Axes[(int32)Axis] = Value;
+		CurrentFrame.AxisSetMask |= 1 << (int32)Axis;
+	}
+}
+
+void FLylatDragoonInputRecorder::RecordAction(ELylatDragoonInputAction Action)
+{
+	if (Recording)
+	{
+		CurrentFrame.Actions.Add(Action);
+	}
+}
+
+void FLylatDragoonInputRecorder::EndFrame(float DeltaTime, uint32 StateHash)
+{
+	using namespace LylatDragoonInputRecording;
+
+	if (!Recording)
+	{
+		return;
+	}
+
+	CurrentFrame.DeltaTime = DeltaTime;
+	CurrentFrame.StateHash = StateHash;
+
+	// Only what differs from the previous frame is written. Values are compared bit by bit, so replaying gives back
+	// exactly the same floats.
+	uint8 Flags = 0;
+	for (int32 Axis = 0; Axis < (int32)ELylatDragoonInputAxis::Count; ++Axis)
+	{
+		const uint8 AxisBit = 1 << Axis;
+		const bool bNewlySet = (CurrentFrame.AxisSetMask & AxisBit) && !(PreviousFrame.AxisSetMask & AxisBit);
+		if (bNewlySet || FMemory::Memcmp(&CurrentFrame.Axes[Axis], &PreviousFrame.Axes[Axis], sizeof(float)) != 0)
+		{
+			Flags |= AxisBit;
+		}
+	}
+	if (CurrentFrame.Actions.Num() > 0)
+	{
+		Flags |= ActionsFlag;
+	}
+	if (FMemory::Memcmp(&CurrentFrame.DeltaTime, &PreviousFrame.DeltaTime, sizeof(float)) != 0)
+	{
+		Flags |= DeltaTimeFlag;
+	}
+
+	FMemoryWriter Writer(Stream);
+	Writer.Seek(Stream.Num());
+
+	Writer << Flags;
+
+	for (int32 Axis = 0; Axis < (int32)ELylatDragoonInputAxis::Count; ++Axis)
+	{
+		if (Flags & (1 << Axis))
+		{
+			Writer << CurrentFrame.Axes[Axis];
+		}
+	}
+
+	if (Flags & ActionsFlag)
+	{
+		uint8 ActionCount = (uint8)FMath::Min(CurrentFrame.Actions.Num(), 255);
+		Writer << ActionCount;
+		for (uint8 ActionIndex = 0; ActionIndex < ActionCount; ++ActionIndex)
+		{
+			uint8 Action = (uint8)CurrentFrame.Actions[ActionIndex];
+			Writer << Action;
+		}
+	}
+
+	if (Flags & DeltaTimeFlag)
+	{
+		Writer << CurrentFrame.DeltaTime;
+	}
+
+	Writer << CurrentFrame.StateHash;
+
+	FrameCount++;
+
+	// The axes keep their value until a new callback arrives, the actions only last one frame
+	PreviousFrame = CurrentFrame;
+	CurrentFrame.Actions.Reset();
+}
+
+bool FLylatDragoonInputRecorder::SaveToFile(const FString& Filename) const
+{
+	using namespace LylatDragoonInputRecording;
+
+	TArray<uint8> FileData;
+	FileData.Reserve(Stream.Num() + 64);
+
+	FMemoryWriter Writer(FileData);
+
+	uint32 FileMagic = Magic;
+	uint32 FileVersion = Version;
+	int32 FileFrameCount = FrameCount;
+	FString FileMapName = MapName;
+	Writer << FileMagic;
+	Writer << FileVersion;
+	Writer << FileFrameCount;
+	Writer << FileMapName;
+
+	FileData.Append(Stream);
+
+	return FFileHelper::SaveArrayToFile(FileData, *Filename);
+}
+
+FLylatDragoonInputPlayer::FLylatDragoonInputPlayer()
+	: StreamOffset(0)
+	, FrameCount(0)
+	, FrameIndex(0)
+{
+}
+
+bool FLylatDragoonInputPlayer::LoadFromFile(const FString& Filename)
+{
+	using namespace LylatDragoonInputRecording;
+
+	PreviousFrame = FLylatDragoonInputFrame();
+	Stream.Reset();
+	StreamOffset = 0;
+	FrameCount = 0;
+	FrameIndex = 0;
+
+	TArray<uint8> FileData;
+	if (!FFileHelper::LoadFileToArray(FileData, *Filename))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(FileData);
+
+	uint32 FileMagic = 0;
+	uint32 FileVersion = 0;
+	Reader << FileMagic;
+	Reader << FileVersion;
+	if (Reader.IsError() || FileMagic != Magic || FileVersion != Version)
+	{
+		return false;
+	}
+
+	Reader << FrameCount;
+	Reader << MapName;
+	if (Reader.IsError() || FrameCount < 0)
+	{
+		FrameCount = 0;
+		return false;
+	}
+
+	Stream.Append(FileData.GetData() + Reader.Tell(), FileData.Num() - Reader.Tell());
+	return true;
+}
+
+bool FLylatDragoonInputPlayer::NextFrame(FLylatDragoonInputFrame& OutFrame)
+{
+	if (!IsPlaying())
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Stream);
+	Reader.Seek(StreamOffset);
+
+	LylatDragoonInputRecording::DecodeFrame(Reader, PreviousFrame, OutFrame);
+	if (Reader.IsError())
+	{
+		// Truncated file, stop the replay here
+		FrameCount = FrameIndex;
+		return false;
+	}
+
+	StreamOffset = Reader.Tell();
+	FrameIndex++;
+	PreviousFrame = OutFrame;
+	return true;
+}
+
+float FLylatDragoonInputPlayer::PeekNextDeltaTime() const
+{
+	if (!IsPlaying())
+	{
+		return 0.0f;
+	}
+
+	FMemoryReader Reader(Stream);
+	Reader.Seek(StreamOffset);
+
+	FLylatDragoonInputFrame NextFrame;
+	LylatDragoonInputRecording::DecodeFrame(Reader, PreviousFrame, NextFrame);
+	return Reader.IsError() ? 0.0f : NextFrame.DeltaTime;
+}
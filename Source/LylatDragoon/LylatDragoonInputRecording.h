@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/** Axes bound by the pawn, in the order they are stored */
+enum class ELylatDragoonInputAxis : uint8
+{
+	Thrust,
+	MoveUp,
+	MoveRight,
+	Count
+};
+
+/** Action events bound by the pawn */
+enum class ELylatDragoonInputAction : uint8
+{
+	LeftTiltPressed,
+	LeftTiltReleased,
+	LeftTiltDouble,
+	RightTiltPressed,
+	RightTiltReleased,
+	RightTiltDouble,
+	Fire,
+	LockOnPressed,
+	LockOnReleased,
+	Count
+};
+
+/** Input callbacks received by the pawn during one frame */
+struct FLylatDragoonInputFrame
+{
+	FLylatDragoonInputFrame();
+
+	/** Delta time of the frame (in seconds) */
+	float DeltaTime;
+
+	/** Last value received for every axis */
+	float Axes[(int32)ELylatDragoonInputAxis::Count];
+
+	/** Bit mask of the axes that were received at least once */
+	uint8 AxisSetMask;
+
+	/** Action events in the order they were received */
+	TArray<ELylatDragoonInputAction, TInlineAllocator<4>> Actions;
+
+	/** Hash of the pawn state at the end of the frame */
+	uint32 StateHash;
+};
+
+/**
+ * Records the input callbacks of the pawn into a compact binary stream. Every frame only stores the axes that changed
+ * since the previous frame, the actions and the delta time when it changed, plus a hash of the state used to detect
+ * divergences when the stream is replayed.
+ */
+class FLylatDragoonInputRecorder
+{
+public:
+
+	FLylatDragoonInputRecorder();
+
+	/** Start a new recording, discarding the previous one */
+	void Start(const FString& InMapName);
+
+	/** Stop recording, keeping what was recorded */
+	void Stop();
+
+	/** Returns true while recording */
+	FORCEINLINE bool IsRecording() const { return Recording; }
+
+	/** Store the value of an axis received in the current frame */
+	void RecordAxis(ELylatDragoonInputAxis Axis, float Value);
+
+	/** Store an action received in the current frame */
+	void RecordAction(ELylatDragoonInputAction Action);
+
+	/** Close the current frame and append it to the stream */
+	void EndFrame(float DeltaTime, uint32 StateHash);
+
+	/** Write the stream to a file, returns false if it could not be written */
+	bool SaveToFile(const FString& Filename) const;
+
+	/** Returns the number of frames recorded */
+	FORCEINLINE int32 GetFrameCount() const { return FrameCount; }
+
+	/** Returns the size of the recorded stream in bytes */
+	FORCEINLINE int32 GetStreamSize() const { return Stream.Num(); }
+
+private:
+
+	/** Frame being recorded */
+	FLylatDragoonInputFrame CurrentFrame;
+
+	/** Last frame written to the stream, the next one is stored as a delta from it */
+	FLylatDragoonInputFrame PreviousFrame;
+
+	/** Name of the map being recorded */
+	FString MapName;
+
+	/** Encoded frames, without the header */
+	TArray<uint8> Stream;
+
+	/** Number of frames in the stream */
+	int32 FrameCount;
+
+	/** Indicates if the callbacks are being recorded */
+	bool Recording;
+};
+
+/**
+ * Reads back a stream written by FLylatDragoonInputRecorder one frame at a time.
+ */
+class FLylatDragoonInputPlayer
+{
+public:
+
+	FLylatDragoonInputPlayer();
+
+	/** Load a recording, returns false if the file is missing or not a recording */
+	bool LoadFromFile(const FString& Filename);
+
+	/** Decode the next frame, returns false at the end of the recording */
+	bool NextFrame(FLylatDragoonInputFrame& OutFrame);
+
+	/** Returns the delta time of the frame after the last decoded one, or 0 at the end of the recording */
+	float PeekNextDeltaTime() const;
+
+	/** Returns true if a recording is loaded and not played to the end */
+	FORCEINLINE bool IsPlaying() const { return FrameIndex < FrameCount; }
+
+	/** Returns the index of the next frame to decode */
+	FORCEINLINE int32 GetFrameIndex() const { return FrameIndex; }
+
+	/** Returns the number of frames in the recording */
+	FORCEINLINE int32 GetFrameCount() const { return FrameCount; }
+
+	/** Returns the name of the map the recording was made in */
+	FORCEINLINE const FString& GetMapName() const { return MapName; }
+
+private:
+
+	/** Last decoded frame, the next one is a delta from it */
+	FLylatDragoonInputFrame PreviousFrame;
+
+	/** Name of the map the recording was made in */
+	FString MapName;
+
+	/** Encoded frames, without the header */
+	TArray<uint8> Stream;
+
+	/** Read position in the stream */
+	int64 StreamOffset;
+
+	/** Number of frames in the recording */
+	int32 FrameCount;
+
+	/** Index of the next frame to decode */
+	int32 FrameIndex;
+};
@@ -3,29 +3,329 @@
 #include "LylatDragoon.h"
 #include "LylatDragoonLevelCourse.h"
 
+#include "LylatDragoonCourseDistanceField.h"
+#include "LylatDragoonCourseStreaming.h"
+#include "LylatDragoonFlightModel.h"
+
+#include "LevelSequenceActor.h"
+#include "MovieScene.h"
+#include "MovieSceneTimeHelpers.h"
+#include "Sections/MovieScene3DTransformSection.h"
+#include "Tracks/MovieScene3DTransformTrack.h"
+
 
 // Sets default values
 ALylatDragoonLevelCourse::ALylatDragoonLevelCourse()
 {
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
+
+	CourseSamplesPerSecond = 30.0f;
+	OriginRebaseDistance = 500000.0f;
+
+	// Create the course streaming
+	CourseStreaming = CreateDefaultSubobject<ULylatDragoonCourseStreaming>(TEXT("CourseStreaming0"));
+
+	// Create the course distance field
+	CourseDistanceField = CreateDefaultSubobject<ULylatDragoonCourseDistanceField>(TEXT("CourseDistanceField0"));
+
+	CourseTime = 0.0f;
+	CourseDistance = 0.0f;
+	LastUpdateFrame = 0;
 }
 
 // Called when the game starts or when spawned
 void ALylatDragoonLevelCourse::BeginPlay()
 {
 	Super::BeginPlay();
+
+	// The sequence moves the course, so it has to be evaluated before the course is updated
+	if (SequenceController)
+	{
+		AddTickPrerequisiteActor(SequenceController);
+
+#if LYLATDRAGOON_VALIDATE_TICK_ORDER
+		if (SequenceController->PrimaryActorTick.TickGroup > PrimaryActorTick.TickGroup)
+		{
+			UE_LOG(LogFlying, Warning, TEXT("%s is updated in an earlier tick group than its sequence %s"), *GetName(), *SequenceController->GetName());
+		}
+#endif
+	}
+
+	BuildCourseTable();
+
+	CourseStreaming->LoadStartSections();
 }
 
 // Called every frame
 void ALylatDragoonLevelCourse::Tick( float DeltaTime )
 {
+	LYLATDRAGOON_SCOPE_CYCLE_COUNTER(CourseUpdate);
+
 	Super::Tick( DeltaTime );
 
-	MovementDirection = GetActorLocation() - PreviousLocation;
+	if (CourseTable.IsValid() && SequenceController && SequenceController->SequencePlayer)
+	{
+		CourseTime = SequenceController->SequencePlayer->GetPlaybackPosition();
+		CourseDistance = CourseTable.GetDistanceAtTime(CourseTime);
+		MovementDirection = CourseTable.GetDirectionAtTime(CourseTime);
 
-	SetActorRotation(MovementDirection.Rotation());
+		// The sequence keys the location in the original world space, the table follows the rebased origin
+		SetActorLocationAndRotation(CourseTable.GetLocationAtTime(CourseTime), CourseTable.GetRotationAtTime(CourseTime));
+	}
+	else
+	{
+		// Without a baked course follow the movement of the last frame
+		MovementDirection = GetActorLocation() - PreviousLocation;
+
+		SetActorRotation(MovementDirection.Rotation());
+	}
 
 	PreviousLocation = GetActorLocation();
+
+	LastUpdateFrame = GFrameCounter;
+
+	RebaseOrigin();
+}
+
+void ALylatDragoonLevelCourse::ApplyWorldOffset(const FVector& InOffset, bool bWorldShift)
+{
+	Super::ApplyWorldOffset(InOffset, bWorldShift);
+
+	CourseTable.ApplyWorldOffset(InOffset);
+	PreviousLocation += InOffset;
+}
+
+bool ALylatDragoonLevelCourse::GetRebasedOrigin(const FVector& CourseLocation, float RebaseDistance, const FIntVector& OriginLocation, FIntVector& OutNewOrigin)
+{
+	if (RebaseDistance <= 0.0f || CourseLocation.SizeSquared() < FMath::Square(RebaseDistance))
+	{
+		return false;
+	}
+
+	OutNewOrigin = OriginLocation + FIntVector(CourseLocation);
+	return true;
+}
+
+void ALylatDragoonLevelCourse::RebaseOrigin()
+{
+	// The server keeps the original origin: the players it hosts can be anywhere on the course, and their flights
+	// are replicated relative to the course so clients can move theirs (see OriginRebaseDistance)
+	const ENetMode NetMode = GetNetMode();
+	if (NetMode == NM_DedicatedServer || NetMode == NM_ListenServer)
+	{
+		return;
+	}
+
+	// Without a baked course the sequence would put the course back in the original world space
+	UWorld* World = GetWorld();
+	FIntVector NewOrigin;
+	if (!CourseTable.IsValid() || !GetRebasedOrigin(GetActorLocation(), OriginRebaseDistance, World->OriginLocation, NewOrigin))
+	{
+		return;
+	}
+
+	// Applied at the start of the next frame, every actor and component moves its world locations then
+	World->RequestNewWorldOrigin(NewOrigin);
+	UE_LOG(LogFlying, Log, TEXT("%s moves the world origin to %s"), *GetName(), *NewOrigin.ToString());
+}
+
+void ALylatDragoonLevelCourse::BuildCourseTable()
+{
+	CourseTable.Reset();
+
+	UMovieSceneSequence* Sequence = SequenceController && SequenceController->SequencePlayer ? SequenceController->SequencePlayer->GetSequence() : nullptr;
+	UMovieScene* MovieScene = Sequence ? Sequence->GetMovieScene() : nullptr;
+	if (!MovieScene)
+	{
+		return;
+	}
+
+	const FGuid Binding = Sequence->FindPossessableObjectId(*this, GetWorld());
+	UMovieScene3DTransformTrack* TransformTrack = MovieScene->FindTrack<UMovieScene3DTransformTrack>(Binding);
+	if (!TransformTrack)
+	{
+		UE_LOG(LogFlying, Warning, TEXT("%s has no transform track in %s, the course direction will follow the movement of every frame"), *GetName(), *Sequence->GetName());
+		return;
+	}
+
+	const FFrameRate TickResolution = MovieScene->GetTickResolution();
+	const FFrameNumber StartFrame = MovieScene::DiscreteInclusiveLower(MovieScene->GetPlaybackRange());
+	const FFrameNumber EndFrame = MovieScene::DiscreteExclusiveUpper(MovieScene->GetPlaybackRange());
+	const float Duration = TickResolution.AsSeconds(EndFrame - StartFrame);
+
+	const float SampleInterval = 1.0f / FMath::Max(CourseSamplesPerSecond, 1.0f);
+	const int32 SampleCount = FMath::Max(FMath::CeilToInt(Duration / SampleInterval) + 1, 2);
+
+	// The track animates the relative location of the course
+	const USceneComponent* AttachParent = GetRootComponent()->GetAttachParent();
+	const FTransform ParentTransform = AttachParent ? AttachParent->GetComponentTransform() : FTransform::Identity;
+
+	TArray<FVector> SampledLocations;
+	SampledLocations.Reserve(SampleCount);
+
+	for (int32 Sample = 0; Sample < SampleCount; ++Sample)
+	{
+		const FFrameTime FrameTime = FFrameTime(StartFrame) + TickResolution.AsFrameTime(Sample * SampleInterval);
+
+		// Use the section under the sample, or the first one when the sample is outside every section
+		UMovieScene3DTransformSection* TransformSection = nullptr;
+		for (UMovieSceneSection* Section : TransformTrack->GetAllSections())
+		{
+			UMovieScene3DTransformSection* Candidate = Cast<UMovieScene3DTransformSection>(Section);
+			if (Candidate && (!TransformSection || Candidate->GetRange().Contains(FrameTime.FrameNumber)))
+			{
+				TransformSection = Candidate;
+			}
+		}
+
+		if (!TransformSection)
+		{
+			return;
+		}
+
+		// The first three float channels of the section are the translation
+		TArrayView<FMovieSceneFloatChannel*> Channels = TransformSection->GetChannelProxy().GetChannels<FMovieSceneFloatChannel>();
+		FVector Location = GetRootComponent()->RelativeLocation;
+		for (int32 Axis = 0; Axis < 3 && Axis < Channels.Num(); ++Axis)
+		{
+			Channels[Axis]->Evaluate(FrameTime, Location[Axis]);
+		}
+
+		SampledLocations.Add(ParentTransform.TransformPosition(Location));
+	}
+
+	CourseTable.Build(SampledLocations, SampleInterval);
+
+	UE_LOG(LogFlying, Log, TEXT("%s baked %d samples, %.1f seconds, %.1f units long"), *GetName(), SampledLocations.Num(), CourseTable.GetDuration(), CourseTable.GetLength());
+}
+
+/** Course and flight of the placement check, moved by the world origin like the level course and the pawn */
+struct FLylatDragoonPlacementFlight
+{
+	FLylatDragoonCourseTable CourseTable;
+	FLylatDragoonFlightStepper FlightStepper;
+	FLylatDragoonCourseFrame PreviousCourseFrame;
+	FIntVector OriginLocation;
+	FIntVector RequestedOrigin;
+	float CourseTime;
+
+	/** Bake a weaving course going along Y from the given distance, samples 700 units apart are exact floats */
+	FLylatDragoonPlacementFlight(float StartDistance, float SampleInterval, int32 SampleCount)
+		: OriginLocation(FIntVector::ZeroValue)
+		, RequestedOrigin(FIntVector::ZeroValue)
+		, CourseTime(0.0f)
+	{
+		TArray<FVector> SampledLocations;
+		for (int32 Sample = 0; Sample < SampleCount; ++Sample)
+		{
+			SampledLocations.Add(FVector(2000.0f * FMath::Sin(Sample * 0.02f), StartDistance + Sample * 700.0f, 0.0f));
+		}
+		CourseTable.Build(SampledLocations, SampleInterval);
+	}
+
+	FLylatDragoonCourseFrame GetCourseFrame() const
+	{
+		return FLylatDragoonCourseFrame(CourseTable.GetLocationAtTime(CourseTime), FRotator(CourseTable.GetRotationAtTime(CourseTime)));
+	}
+
+	/** Apply the origin requested in the last frame, the world does it at the start of the frame */
+	void ApplyRequestedOrigin()
+	{
+		if (RequestedOrigin != OriginLocation)
+		{
+			const FVector Offset = FVector(OriginLocation - RequestedOrigin);
+			CourseTable.ApplyWorldOffset(Offset);
+			FlightStepper.ApplyWorldOffset(Offset);
+			PreviousCourseFrame.Location += Offset;
+			OriginLocation = RequestedOrigin;
+		}
+	}
+
+	/** Returns the location of the pawn relative to the course after a frame */
+	FVector Tick(float DeltaTime, const FLylatDragoonFlightInput& Input, const FLylatDragoonFlightParams& Params, float RebaseDistance)
+	{
+		ApplyRequestedOrigin();
+
+		CourseTime += DeltaTime * FlightStepper.GetState().PlayRate;
+		const FLylatDragoonCourseFrame Course = GetCourseFrame();
+		FlightStepper.Advance(DeltaTime, Input, Params, PreviousCourseFrame, Course);
+		PreviousCourseFrame = Course;
+
+		ALylatDragoonLevelCourse::GetRebasedOrigin(Course.Location, RebaseDistance, OriginLocation, RequestedOrigin);
+		return FlightStepper.GetState().Location - Course.Location;
+	}
+};
+
+/**
+ * Fly a weaving input for the given number of frames on a course baked the given distance from the origin, rebasing
+ * the origin like the level course does when RebaseDistance is positive. Returns the largest difference (in units)
+ * between the placement of the pawn relative to the course and the one of the same flight on a course at the origin.
+ */
+static float MeasurePlacementError(float StartDistance, float RebaseDistance, int32 FrameCount)
+{
+	const float DeltaTime = 1.0f / 60.0f;
+	const float SampleInterval = 1.0f / 30.0f;
+
+	// The play rate is at most the max speed, the course has to last that long
+	FLylatDragoonFlightParams Params;
+	const int32 SampleCount = FMath::CeilToInt(FrameCount * DeltaTime * Params.MaxSpeed / SampleInterval) + 2;
+
+	FLylatDragoonPlacementFlight Reference(0.0f, SampleInterval, SampleCount);
+	FLylatDragoonPlacementFlight Flight(StartDistance, SampleInterval, SampleCount);
+
+	FLylatDragoonFlightState State;
+	State.Energy = Params.MaxEnergy;
+	for (FLylatDragoonPlacementFlight* Placement : { &Reference, &Flight })
+	{
+		Placement->PreviousCourseFrame = Placement->GetCourseFrame();
+		State.Location = Placement->PreviousCourseFrame.Location;
+		State.Rotation = Placement->PreviousCourseFrame.Rotation;
+		Placement->FlightStepper.FixedDeltaTime = 1.0f / 120.0f;
+		Placement->FlightStepper.Reset(State);
+
+		// The level course moves the origin to its start in the frame before the flight starts
+		ALylatDragoonLevelCourse::GetRebasedOrigin(Placement->PreviousCourseFrame.Location, RebaseDistance, Placement->OriginLocation, Placement->RequestedOrigin);
+		Placement->ApplyRequestedOrigin();
+	}
+
+	FLylatDragoonFlightInput Input;
+	float MaxError = 0.0f;
+	for (int32 Frame = 0; Frame < FrameCount; ++Frame)
+	{
+		Input.Right = FMath::Sin(Frame * 0.02f);
+		Input.Up = FMath::Cos(Frame * 0.026f);
+
+		// Both flights are rebased at the same distance, so only the distance of the course from its start differs
+		const FVector ReferencePlacement = Reference.Tick(DeltaTime, Input, Params, RebaseDistance);
+		const FVector Placement = Flight.Tick(DeltaTime, Input, Params, RebaseDistance);
+		MaxError = FMath::Max(MaxError, (Placement - ReferencePlacement).Size());
+	}
+
+	return MaxError;
+}
+
+static void CheckFarPlacement(const TArray<FString>& Args)
+{
+	const float DistanceKm = Args.Num() > 0 ? FCString::Atof(*Args[0]) : 100.0f;
+	const int32 FrameCount = 60 * 60;
+
+	// One unit is a centimetre
+	const float StartDistance = DistanceKm * 100000.0f;
+	const float RebasedErrorMm = MeasurePlacementError(StartDistance, 500000.0f, FrameCount) * 10.0f;
+	const float WorldErrorMm = MeasurePlacementError(StartDistance, 0.0f, FrameCount) * 10.0f;
+
+	if (RebasedErrorMm < 1.0f)
+	{
+		UE_LOG(LogFlying, Display, TEXT("Pawn placement %.0f km out: %.4f mm off with origin rebasing, %.4f mm without. Passed"), DistanceKm, RebasedErrorMm, WorldErrorMm);
+	}
+	else
+	{
+		UE_LOG(LogFlying, Error, TEXT("Pawn placement %.0f km out: %.4f mm off with origin rebasing, %.4f mm without. Failed, over 1 mm"), DistanceKm, RebasedErrorMm, WorldErrorMm);
+	}
 }
 
+static FAutoConsoleCommand CheckFarPlacementCommand(
+	TEXT("LylatDragoon.CheckFarPlacement"),
+	TEXT("Fly a minute on a course baked the given number of kilometres from the origin (100 by default), rebasing the origin like the level course, and check the pawn is placed within a millimetre of a flight at the origin."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&CheckFarPlacement));
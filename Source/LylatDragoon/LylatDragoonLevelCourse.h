@@ -3,12 +3,21 @@
 #pragma once
 
 #include "GameFramework/Actor.h"
+#include "LylatDragoonCourseTable.h"
 #include "LylatDragoonLevelCourse.generated.h"
 
 UCLASS()
 class LYLATDRAGOON_API ALylatDragoonLevelCourse : public AActor
 {
 	GENERATED_BODY()
+
+	/** Streams the sublevels along the course */
+	UPROPERTY(Category = Streaming, VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	class ULylatDragoonCourseStreaming* CourseStreaming;
+
+	/** Distance from the walls of the level around the course */
+	UPROPERTY(Category = Collision, VisibleAnywhere, BlueprintReadOnly, meta = (AllowPrivateAccess = "true"))
+	class ULylatDragoonCourseDistanceField* CourseDistanceField;
 	
 public:	
 	// Sets default values for this actor's properties
@@ -18,18 +27,69 @@ public:
 	UPROPERTY(Category=Movement, EditAnywhere)
 	class ALevelSequenceActor* SequenceController;
 
+	// Number of samples per second of sequence used to bake the course table
+	UPROPERTY(Category=Movement, EditAnywhere)
+	float CourseSamplesPerSecond;
+
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 	
 	// Called every frame
 	virtual void Tick( float DeltaSeconds ) override;
 
+	// Called when the world origin is rebased
+	virtual void ApplyWorldOffset(const FVector& InOffset, bool bWorldShift) override;
+
+	// Distance from the world origin where the origin is moved to the course, 0 to never move it.
+	// Far from the origin the precision of the world locations is lost.
+	// Servers never move it: they host players at different points of the course, and one origin can't be close to
+	// all of them. Flights are replicated relative to the course, so only the collisions of the server lose precision
+	UPROPERTY(Category=Movement, EditAnywhere)
+	float OriginRebaseDistance;
+
+	// Returns true if a course at the given location is far enough from the origin to move the origin to it, and the
+	// new origin of the world
+	static bool GetRebasedOrigin(const FVector& CourseLocation, float RebaseDistance, const FIntVector& OriginLocation, FIntVector& OutNewOrigin);
+
+	// Bake the transform track of the sequence into the course table
+	void BuildCourseTable();
+
 	FORCEINLINE FVector GetMovementDirection() const { return MovementDirection; }
 
+	// Returns the course baked from the sequence. Times are playback positions of the sequence
+	FORCEINLINE const FLylatDragoonCourseTable& GetCourseTable() const { return CourseTable; }
+
+	// Returns the playback position of the sequence in the last update of the course
+	FORCEINLINE float GetCourseTime() const { return CourseTime; }
+
+	// Returns the distance from the start of the course in the last update of the course
+	FORCEINLINE float GetCourseDistance() const { return CourseDistance; }
+
+	/** Returns CourseStreaming subobject **/
+	FORCEINLINE class ULylatDragoonCourseStreaming* GetCourseStreaming() const { return CourseStreaming; }
+
+	/** Returns CourseDistanceField subobject **/
+	FORCEINLINE class ULylatDragoonCourseDistanceField* GetCourseDistanceField() const { return CourseDistanceField; }
+
+	// Returns the value of GFrameCounter in the last update of the course
+	FORCEINLINE uint64 GetLastUpdateFrame() const { return LastUpdateFrame; }
+
 private:
 
+	// Move the world origin to the course if it is too far from it
+	void RebaseOrigin();
+
 	FVector MovementDirection;
 
 	FVector PreviousLocation;
+
+	// Path of the course sampled from the sequence
+	FLylatDragoonCourseTable CourseTable;
+
+	float CourseTime;
+
+	float CourseDistance;
+
+	uint64 LastUpdateFrame;
 	
 };
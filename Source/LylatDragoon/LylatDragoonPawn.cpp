@@ -3,38 +3,70 @@
 #include "LylatDragoon.h"
 #include "LylatDragoonPawn.h"
 
+#include "LylatDragoonAssetStreamer.h"
+#include "LylatDragoonCourseDistanceField.h"
+#include "LylatDragoonDamageQueue.h"
+#include "LylatDragoonEnemy.h"
+#include "LylatDragoonGameMode.h"
 #include "LylatDragoonLevelCourse.h"
 #include "LylatDragoonPlayerController.h"
 #include "LylatDragoonProjectile.h"
+#include "LylatDragoonProjectilePool.h"
+#include "LylatDragoonSoakRecorder.h"
+#include "LylatDragoonTargeting.h"
+#include "LylatDragoonTelemetry.h"
 
 #include "LevelSequenceActor.h"
 
 #include "EngineUtils.h"
 #include "DrawDebugHelpers.h"
+#include "UnrealNetwork.h"
+#include "Misc/App.h"
 #include "EngineGlobals.h"
 #include "Engine/Engine.h"
 
-ALylatDragoonPawn::ALylatDragoonPawn(const FObjectInitializer& ObjectInitializer) 
-	: Super(ObjectInitializer)
+#if LYLATDRAGOON_VALIDATE_TICK_ORDER
+static TAutoConsoleVariable<int32> CVarValidateTickOrder(
+	TEXT("LylatDragoon.ValidateTickOrder"),
+	0,
+	TEXT("Warn when the pawn or the camera read the level course or the pawn before they were updated in the frame."));
+#endif
+
+static TAutoConsoleVariable<int32> CVarShowReplication(
+	TEXT("LylatDragoon.ShowReplication"),
+	0,
+	TEXT("Show on screen the size and rate of the flight updates of every player against its budget."));
+
+static TAutoConsoleVariable<int32> CVarShowWallContact(
+	TEXT("LylatDragoon.ShowWallContact"),
+	0,
+	TEXT("Show on screen the distance from the pawn to the walls of the level, read from the course distance field."));
+
+void FLylatDragoonCameraTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
 {
-	// Structure to hold one-time initialization
-	struct FConstructorStatics
+	if (Target && !Target->IsPendingKill() && TickType != LEVELTICK_ViewportsOnly)
 	{
-		ConstructorHelpers::FObjectFinderOptional<UStaticMesh> PlaneMesh;
-		FConstructorStatics()
-			: PlaneMesh(TEXT("/Game/Flying/Meshes/UFO.UFO"))
-		{
-		}
-	};
-	static FConstructorStatics ConstructorStatics;
+		Target->UpdateCamera(DeltaTime * Target->CustomTimeDilation);
+	}
+}
 
-	// Create static mesh component
+FString FLylatDragoonCameraTickFunction::DiagnosticMessage()
+{
+	return Target->GetFullName() + TEXT("[UpdateCamera]");
+}
+
+ALylatDragoonPawn::ALylatDragoonPawn(const FObjectInitializer& ObjectInitializer) 
+	: Super(ObjectInitializer)
+{
+	// Create static mesh component. The mesh is a soft reference, loaded on BeginPlay
 	PlaneMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("PlaneMesh0"));
-	PlaneMesh->SetStaticMesh(ConstructorStatics.PlaneMesh.Get());
 	RootComponent = PlaneMesh;
+	PlaneMeshAsset = FSoftObjectPath(TEXT("/Game/Flying/Meshes/UFO.UFO"));
 
-	// Create a spring arm component
+	// Create a spring arm component. It ticks after the camera update, which runs after the flight update. Both are
+	// done before the player camera manager reads the view, which happens between TG_PostPhysics and TG_PostUpdateWork
 	SpringArm = CreateDefaultSubobject<USpringArmComponent>(TEXT("SpringArm0"));
+	SpringArm->PrimaryComponentTick.TickGroup = TG_PostPhysics;
 	//SpringArm->AttachTo(RootComponent);
 	SpringArm->TargetArmLength = 160.0f; // The camera follows at this distance behind the character	
 	SpringArm->SocketOffset = FVector(0.f,0.f,60.f);
@@ -49,11 +81,12 @@ ALylatDragoonPawn::ALylatDragoonPawn(const FObjectInitializer& ObjectInitializer
 	LeftTiltPressed = false;
 	RightTiltPressed = false;
 
-	DoingBarrelRoll = false;
-	DoingLeftBarrelRoll = false;
-	DoingRightBarrelRoll = false;
+	LeftBarrelRollRequested = false;
+	RightBarrelRollRequested = false;
 
-	EnergyInCooldown = false;
+	FlightNeedsReset = true;
+	PawnAssetsLoaded = false;
+	StartupReported = false;
 	EnergyConsuptionRate = 10.0f;
 	EnergyCooldownTime = 3.0f;
 	EnergyRecoveryRate = 10.0f;
@@ -73,6 +106,11 @@ ALylatDragoonPawn::ALylatDragoonPawn(const FObjectInitializer& ObjectInitializer
 	LeftMovementLimit = -1000.0f;
 	UpMovementLimit = 500.0f;
 	DownMovementLimit = -500.0f;
+	WallContactRadius = 150.0f;
+	WallScrapeDamageRate = 20.0f;
+
+	FlightStepRate = 120.0f;
+	MaxFlightSubsteps = 8;
 
 	VerticalCameraDisplacement = 0.75f;
 	HorizontalCameraDisplacement = 0.75f;
@@ -82,106 +120,449 @@ ALylatDragoonPawn::ALylatDragoonPawn(const FObjectInitializer& ObjectInitializer
 	CamRotationRate = 10.0f;
 
 	AimPointDistance = 5000.0f;
+	FireInterval = 0.1f;
+	LockOnAngle = 10.0f;
+	LockOnDistance = 20000.0f;
+	MaxLockOnTargets = 8;
+	LockOnPressed = false;
+	NextFireTime = 0.0f;
+
+	CoursePositionOffset = FVector::ZeroVector;
+	LastFlightUpdateFrame = 0;
+
+	ReplayExpectedHash = 0;
+	ReplayDivergenceCount = 0;
+
+	TelemetryStarted = false;
+	TelemetryEnergyCooldown = false;
+	TelemetryBarrelRollDirection = 0;
+	TelemetryPlayRate = 1.0f;
+
+	// The flight is replicated relative to the course instead of the movement of the actor
+	bReplicates = true;
+	bReplicateMovement = false;
+	NetBytesPerSecondBudget = 1024.0f;
+	NetSmoothingRate = 15.0f;
+	NetWallContactTolerance = 10.0f;
+
+	ReplicatedFlightReceived = false;
+	ReplicatedCourseTime = 0.0f;
+	SmoothedNetOffset = FVector2D::ZeroVector;
+	SmoothedNetRotation = FRotator::ZeroRotator;
+	NetSendTimer = 0.0f;
+	NetFlightBytes = 0;
+	LastFlightUpdateTime = -1.0f;
+	NetBytesThisSecond = 0;
+	NetSecondTimer = 0.0f;
+	NetBytesPerSecond = 0;
+	TotalNetBytes = 0;
+
+	CameraTick.bCanEverTick = true;
+	CameraTick.bStartWithTickEnabled = true;
+	CameraTick.TickGroup = TG_PostPhysics;
 }
 
 void ALylatDragoonPawn::Tick(float DeltaSeconds)
 {
+	LYLATDRAGOON_SCOPE_CYCLE_COUNTER(FlightUpdate);
+
 	// Call any parent class Tick implementation
 	Super::Tick(DeltaSeconds);
 
-	ALylatDragoonPlayerController* LylatController = Cast<ALylatDragoonPlayerController>(Controller);
-	if (LevelCourse && LylatController)
+	if (InputPlayer.IsPlaying())
 	{
-		if (!EnergyInCooldown)
-		{
-			if (CurrentThrustInput != 0.0f)
-			{
-				CurrentEnergy -= DeltaSeconds * EnergyConsuptionRate;
-			}
+		ReplayInputFrame();
+	}
 
-			if (CurrentEnergy < 0.0f)
-			{
-				CurrentEnergy = 0.0f;
-				EnergyInCooldown = true;
-				FTimerHandle TimerHandle;
-				GetWorldTimerManager().SetTimer(TimerHandle, this, &ALylatDragoonPawn::FinishEnergyCooldown, EnergyCooldownTime, false);
-				CurrentThrustInput = 0.0f;
-			}
-			else
-			{
-				CurrentEnergy = FMath::Clamp(CurrentEnergy + DeltaSeconds * EnergyRecoveryRate, 0.0f, MaxEnergy);
-			}
-		}
-		else
+	ALylatDragoonPlayerController* LylatController = Cast<ALylatDragoonPlayerController>(Controller);
+	if (LevelCourse && LylatController && IsLocallyControlled())
+	{
+#if LYLATDRAGOON_VALIDATE_TICK_ORDER
+		if (CVarValidateTickOrder.GetValueOnGameThread() != 0 && LevelCourse->GetLastUpdateFrame() != GFrameCounter)
 		{
-			CurrentThrustInput = 0.0f;
+			UE_LOG(LogFlying, Warning, TEXT("%s read the level course before it was updated this frame"), *GetName());
 		}
+#endif
 
-		float DesirePlayRate = LevelCourse->SequenceController->SequencePlayer->GetPlayRate() + CurrentThrustInput;
-		float FinalPlayRate = FMath::Clamp(FMath::FInterpTo(LevelCourse->SequenceController->SequencePlayer->GetPlayRate(), DesirePlayRate, DeltaSeconds, SpeedChangeRate), MinSpeed, MaxSpeed);
-		FinalPlayRate = FMath::FInterpTo(FinalPlayRate, 1.0f, DeltaSeconds, SpeedRecoveryRate);
-		LevelCourse->SequenceController->SequencePlayer->SetPlayRate(FinalPlayRate);
+		UMovieSceneSequencePlayer* SequencePlayer = LevelCourse->SequenceController->SequencePlayer;
+		const FLylatDragoonCourseFrame Course(LevelCourse->GetActorLocation(), LevelCourse->GetActorRotation());
 
-		// Calculate the rotation according to the input
-		FRotator DesireRotation = GetActorRotation();
-		DesireRotation.Yaw += RightInput * MovementRotationDegrees;
-		if (DoingBarrelRoll)
+		if (FlightNeedsReset)
 		{
-			DesireRotation.Roll = DoingLeftBarrelRoll ? DesireRotation.Roll - 45.0f : DoingRightBarrelRoll ? DesireRotation.Roll + 45.0f : DesireRotation.Roll;
+			ResetFlight(Course, FlightStepper.GetState().PositionOffset);
 		}
-		else
+
+		FLylatDragoonFlightInput FlightInput;
+		FlightInput.Thrust = CurrentThrustInput;
+		FlightInput.Right = RightInput;
+		FlightInput.Up = UpInput;
+		FlightInput.bLeftTiltPressed = LeftTiltPressed;
+		FlightInput.bRightTiltPressed = RightTiltPressed;
+		FlightInput.bLeftBarrelRoll = LeftBarrelRollRequested;
+		FlightInput.bRightBarrelRoll = RightBarrelRollRequested;
+
+		FlightStepper.FixedDeltaTime = 1.0f / FMath::Max(FlightStepRate, 1.0f);
+		FlightStepper.MaxSubsteps = FMath::Max(MaxFlightSubsteps, 1);
+		if (FlightStepper.Advance(DeltaSeconds, FlightInput, GetFlightParams(), PreviousCourseFrame, Course) > 0)
 		{
-			DesireRotation.Roll = RightTiltPressed ? 90.0f : DesireRotation.Roll + RightInput * MovementRotationDegrees;
-			DesireRotation.Roll = LeftTiltPressed ? -90.0f : DesireRotation.Roll + RightInput * MovementRotationDegrees;
+			LeftBarrelRollRequested = false;
+			RightBarrelRollRequested = false;
 		}
-		DesireRotation.Pitch += UpInput * MovementRotationDegrees;
-		float RotationSpeed = DoingBarrelRoll ? RotChangeBarrellRollRate : RotChangeRate;
-		FRotator FinalRotation = FMath::RInterpTo(GetActorRotation(), DesireRotation, DeltaSeconds, RotationSpeed);
-		FinalRotation = FMath::RInterpTo(FinalRotation, LevelCourse->GetActorRotation(), DeltaSeconds, RotationRecoveryRate);
+		PreviousCourseFrame = Course;
 
-		//Calculate the position according to the rotation
-		FVector FinalForwardDirection = FinalRotation.Vector();
-		FVector FinalLocation = FMath::LinePlaneIntersection(GetActorLocation(), GetActorLocation() + FinalForwardDirection * MovRefPointDistance, LevelCourse->GetActorLocation(), LevelCourse->GetActorRotation().Vector());
+		ResolveWallContact(Course, DeltaSeconds);
 
-		FVector PositionOffset = LevelCourse->GetActorLocation() - FinalLocation;
-		if (PositionOffset.X > RightMovementLimit)
-		{
-			PositionOffset.X = RightMovementLimit;
-		}
+		CurrentEnergy = FlightStepper.GetState().Energy;
+		SequencePlayer->SetPlayRate(FlightStepper.GetState().PlayRate);
+
+		RecordFlightTelemetry();
+
+		// Present the state blended between the last two steps
+		const FLylatDragoonFlightState PresentationState = FlightStepper.GetPresentationState(Course);
+		SetActorLocationAndRotation(PresentationState.Location, PresentationState.Rotation);
 
-		if (PositionOffset.X < LeftMovementLimit)
+		CoursePositionOffset = PresentationState.PositionOffset;
+
+		AimPointLocation = GetActorLocation() + (GetActorRotation().Vector() * AimPointDistance);
+
+		if (LockOnPressed)
 		{
-			PositionOffset.X = LeftMovementLimit;
+			UpdateLockOn();
 		}
 
-		if (PositionOffset.Z > UpMovementLimit)
+		PreviousLocation = GetActorLocation();
+
+		LastFlightUpdateFrame = GFrameCounter;
+
+		// The player flies and can shoot from now on
+		if (PawnAssetsLoaded && !StartupReported)
 		{
-			PositionOffset.Z = UpMovementLimit;
+			ALylatDragoonGameMode* GameMode = GetWorld()->GetAuthGameMode<ALylatDragoonGameMode>();
+			if (GameMode)
+			{
+				GameMode->GetAssetStreamer()->NotifyFirstControllableFrame();
+			}
+			StartupReported = true;
 		}
 
-		if (PositionOffset.Z < DownMovementLimit)
+		SendReplicatedFlight(DeltaSeconds);
+	}
+	else if (!IsLocallyControlled())
+	{
+		ApplyReplicatedFlight(DeltaSeconds);
+
+		// The server locks on for the players of the clients, from where it places their pawns
+		if (LockOnPressed && Role == ROLE_Authority)
 		{
-			PositionOffset.Z = DownMovementLimit;
+			UpdateLockOn();
 		}
+	}
+
+	// Measure the bytes of the flight updates of every whole second
+	NetSecondTimer += DeltaSeconds;
+	if (NetSecondTimer >= 1.0f)
+	{
+		NetBytesPerSecond = FMath::RoundToInt(NetBytesThisSecond / NetSecondTimer);
+		NetBytesThisSecond = 0;
+		NetSecondTimer = 0.0f;
+	}
+
+	if (CVarShowReplication.GetValueOnGameThread() != 0 && GetNetMode() != NM_Standalone && GEngine)
+	{
+		GEngine->AddOnScreenDebugMessage((uint64)GetUniqueID(), 0.0f, FColor::Yellow, FString::Printf(TEXT("%s%s: %d bytes per update, %d of %.0f bytes per second"),
+			*GetName(), IsLocallyControlled() ? TEXT(" (local)") : TEXT(""), NetFlightBytes, NetBytesPerSecond, NetBytesPerSecondBudget));
+	}
+
+	EndInputFrame(DeltaSeconds);
+}
+
+void ALylatDragoonPawn::ApplyWorldOffset(const FVector& InOffset, bool bWorldShift)
+{
+	Super::ApplyWorldOffset(InOffset, bWorldShift);
+
+	// The offset from the course doesn't change, only the world locations kept from the last frame
+	FlightStepper.ApplyWorldOffset(InOffset);
+	PreviousCourseFrame.Location += InOffset;
+	AimPointLocation += InOffset;
+	PreviousLocation += InOffset;
+}
+
+void ALylatDragoonPawn::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	// The player flying the pawn already has a better state than the one it sent
+	DOREPLIFETIME_CONDITION(ALylatDragoonPawn, ReplicatedFlight, COND_SkipOwner);
+
+	DOREPLIFETIME(ALylatDragoonPawn, CurrentHealth);
+	DOREPLIFETIME_CONDITION(ALylatDragoonPawn, LockedTargets, COND_OwnerOnly);
+}
+
+void ALylatDragoonPawn::SendReplicatedFlight(float DeltaSeconds)
+{
+	if (GetNetMode() == NM_Standalone)
+	{
+		return;
+	}
+
+	// Send as often as the budget allows with the size of the last update
+	const float SendInterval = FMath::Max(NetFlightBytes, 1) / FMath::Max(NetBytesPerSecondBudget, 1.0f);
+	NetSendTimer += DeltaSeconds;
+	if (NetSendTimer < SendInterval)
+	{
+		return;
+	}
+	NetSendTimer = FMath::Min(NetSendTimer - SendInterval, SendInterval);
+
+	const FLylatDragoonReplicatedFlight Flight = FLylatDragoonReplicatedFlight::FromWorld(LevelCourse->GetCourseTime(), LevelCourse->GetActorLocation(), LevelCourse->GetActorRotation(),
+		GetActorLocation(), GetActorRotation(), FlightStepper.GetState().PlayRate);
+	NetFlightBytes = Flight.GetSerializedBytes();
+	CountNetBytes(NetFlightBytes);
+
+	if (Role == ROLE_Authority)
+	{
+		// Player of a listen server, the flight goes straight to the other players
+		ReplicatedFlight = Flight;
+		NetUpdateFrequency = FMath::Clamp(NetBytesPerSecondBudget / NetFlightBytes, 1.0f, 60.0f);
+	}
+	else
+	{
+		ServerUpdateFlight(Flight);
+	}
+}
+
+bool ALylatDragoonPawn::ServerUpdateFlight_Validate(const FLylatDragoonReplicatedFlight& Flight)
+{
+	// The flight model keeps the pawn within its movement limits, a wall can only push it a contact radius further
+	const float Right = -Flight.Offset.X;
+	const float Up = -Flight.Offset.Y;
+	const bool bInLimits = Right >= LeftMovementLimit - WallContactRadius && Right <= RightMovementLimit + WallContactRadius
+		&& Up >= DownMovementLimit - WallContactRadius && Up <= UpMovementLimit + WallContactRadius;
+
+	return Flight.CourseTime >= 0.0f && !Flight.Rotation.ContainsNaN() && bInLimits;
+}
+
+void ALylatDragoonPawn::ServerUpdateFlight_Implementation(const FLylatDragoonReplicatedFlight& Flight)
+{
+	// The time between two updates is measured by the server, never taken from the client
+	const float WorldTime = GetWorld()->GetTimeSeconds();
+	const float ElapsedTime = LastFlightUpdateTime >= 0.0f ? FMath::Min(WorldTime - LastFlightUpdateTime, 1.0f) : 0.0f;
+	LastFlightUpdateTime = WorldTime;
+
+	ApplyNetWallContact(Flight, ElapsedTime);
+
+	// The other players only need the flight
+	ReplicatedFlight = Flight;
+
+	// Relay the updates to the other players at the rate they arrive within the budget
+	NetFlightBytes = Flight.GetSerializedBytes();
+	NetUpdateFrequency = FMath::Clamp(NetBytesPerSecondBudget / NetFlightBytes, 1.0f, 60.0f);
+	CountNetBytes(NetFlightBytes);
+
+	OnRep_ReplicatedFlight();
+}
+
+void ALylatDragoonPawn::ApplyNetWallContact(const FLylatDragoonReplicatedFlight& Flight, float ElapsedTime)
+{
+	ALylatDragoonGameMode* GameMode = GetWorld()->GetAuthGameMode<ALylatDragoonGameMode>();
+	if (!GameMode || !LevelCourse || ElapsedTime <= 0.0f || WallScrapeDamageRate <= 0.0f)
+	{
+		return;
+	}
+
+	const ULylatDragoonCourseDistanceField* DistanceField = LevelCourse->GetCourseDistanceField();
+	const FLylatDragoonCourseTable& CourseTable = LevelCourse->GetCourseTable();
+	if (!DistanceField->IsBaked() || !CourseTable.IsValid())
+	{
+		return;
+	}
+
+	// The offset of the flight goes from the pawn to the course, the field is sampled at the pawn relative to the rail
+	const float CourseDistance = CourseTable.GetDistanceAtTime(Flight.CourseTime);
+	const float WallDistance = DistanceField->GetDistance(CourseDistance, -Flight.Offset.X, -Flight.Offset.Y);
+
+	// The client pushed its pawn out of the wall before sending the flight, scraping it leaves it about the contact radius away
+	const float ContactRadius = FMath::Min(WallContactRadius, DistanceField->GetBandDistance());
+	if (WallDistance < ContactRadius + NetWallContactTolerance)
+	{
+		GameMode->GetDamageQueue()->QueueDamage(this, LevelCourse, nullptr, WallScrapeDamageRate * ElapsedTime, ELylatDragoonDamageKind::Collision);
+	}
+}
+
+void ALylatDragoonPawn::OnRep_ReplicatedFlight()
+{
+	// The course time jumps to the update, the offset and the rotation blend toward it
+	ReplicatedCourseTime = ReplicatedFlight.CourseTime;
+	if (!ReplicatedFlightReceived)
+	{
+		SmoothedNetOffset = ReplicatedFlight.Offset;
+		SmoothedNetRotation = ReplicatedFlight.Rotation;
+		ReplicatedFlightReceived = true;
+	}
+
+	if (Role != ROLE_Authority)
+	{
+		NetFlightBytes = ReplicatedFlight.GetSerializedBytes();
+		CountNetBytes(NetFlightBytes);
+	}
+}
+
+void ALylatDragoonPawn::ApplyReplicatedFlight(float DeltaSeconds)
+{
+	if (!ReplicatedFlightReceived || !LevelCourse || !LevelCourse->GetCourseTable().IsValid())
+	{
+		return;
+	}
 
-		FinalLocation = LevelCourse->GetActorLocation() - PositionOffset;
+	const FLylatDragoonCourseTable& CourseTable = LevelCourse->GetCourseTable();
 
-		SetActorLocation(FinalLocation);
-		SetActorRotation(FinalRotation);
+	// Keep flying at the last play rate until the next update
+	ReplicatedCourseTime = FMath::Min(ReplicatedCourseTime + DeltaSeconds * ReplicatedFlight.PlayRate, CourseTable.GetDuration());
+	SmoothedNetOffset = FMath::Vector2DInterpTo(SmoothedNetOffset, ReplicatedFlight.Offset, DeltaSeconds, NetSmoothingRate);
+	SmoothedNetRotation = FMath::RInterpTo(SmoothedNetRotation, ReplicatedFlight.Rotation, DeltaSeconds, NetSmoothingRate);
+
+	const FVector CourseLocation = CourseTable.GetLocationAtTime(ReplicatedCourseTime);
+	const FRotator CourseRotation = CourseTable.GetRotationAtTime(ReplicatedCourseTime).Rotator();
+	SetActorLocationAndRotation(FLylatDragoonReplicatedFlight::GetWorldLocation(CourseLocation, CourseRotation, SmoothedNetOffset), SmoothedNetRotation);
+}
+
+void ALylatDragoonPawn::CountNetBytes(int32 Bytes)
+{
+	NetBytesThisSecond += Bytes;
+	TotalNetBytes += Bytes;
+}
+
+FLylatDragoonFlightParams ALylatDragoonPawn::GetFlightParams() const
+{
+	FLylatDragoonFlightParams Params;
+	Params.MaxEnergy = MaxEnergy;
+	Params.EnergyConsuptionRate = EnergyConsuptionRate;
+	Params.EnergyCooldownTime = EnergyCooldownTime;
+	Params.EnergyRecoveryRate = EnergyRecoveryRate;
+	Params.SpeedChangeRate = SpeedChangeRate;
+	Params.MinSpeed = MinSpeed;
+	Params.MaxSpeed = MaxSpeed;
+	Params.SpeedRecoveryRate = SpeedRecoveryRate;
+	Params.MovementRotationDegrees = MovementRotationDegrees;
+	Params.RotChangeBarrellRollRate = RotChangeBarrellRollRate;
+	Params.RotChangeRate = RotChangeRate;
+	Params.RotationRecoveryRate = RotationRecoveryRate;
+	Params.MovRefPointDistance = MovRefPointDistance;
+	Params.RightMovementLimit = RightMovementLimit;
+	Params.LeftMovementLimit = LeftMovementLimit;
+	Params.UpMovementLimit = UpMovementLimit;
+	Params.DownMovementLimit = DownMovementLimit;
+	return Params;
+}
+
+void ALylatDragoonPawn::ResolveWallContact(const FLylatDragoonCourseFrame& Course, float DeltaSeconds)
+{
+	LYLATDRAGOON_SCOPE_CYCLE_COUNTER(WallContact);
+
+	const ULylatDragoonCourseDistanceField* DistanceField = LevelCourse->GetCourseDistanceField();
+	if (!DistanceField->IsBaked())
+	{
+		return;
+	}
+
+	// The field is sampled at the location of the pawn relative to the rail, the opposite of the offset to the course
+	const FVector PositionOffset = FlightStepper.GetState().PositionOffset;
+	const float CourseDistance = LevelCourse->GetCourseDistance();
+	const float WallDistance = DistanceField->GetDistance(CourseDistance, -PositionOffset.Y, -PositionOffset.Z);
+
+	if (CVarShowWallContact.GetValueOnGameThread() != 0 && GEngine)
+	{
+		GEngine->AddOnScreenDebugMessage((uint64)GetUniqueID() + 1, 0.0f, FColor::Yellow, FString::Printf(TEXT("Wall distance: %.0f, distance field: %d KB"), WallDistance, DistanceField->GetAllocatedBytes() / 1024));
+	}
+
+	// The field is clamped to its band, a bigger radius would find a wall everywhere
+	const float ContactRadius = FMath::Min(WallContactRadius, DistanceField->GetBandDistance());
+	if (WallDistance >= ContactRadius)
+	{
+		return;
+	}
+
+	const FVector2D Normal = DistanceField->GetNormal(CourseDistance, -PositionOffset.Y, -PositionOffset.Z);
+	if (Normal.IsNearlyZero())
+	{
+		return;
+	}
+
+	// Push the pawn away from the wall until it is ContactRadius away, the movement limits apply again in the next step
+	const float PushDistance = ContactRadius - WallDistance;
+	FlightStepper.MovePositionOffset(FVector(0.0f, -Normal.X * PushDistance, -Normal.Y * PushDistance), Course);
+
+	// The server checks the flight updates of the clients against the field on its own
+	ALylatDragoonGameMode* GameMode = GetWorld()->GetAuthGameMode<ALylatDragoonGameMode>();
+	if (GameMode && WallScrapeDamageRate > 0.0f)
+	{
+		GameMode->GetDamageQueue()->QueueDamage(this, LevelCourse, nullptr, WallScrapeDamageRate * DeltaSeconds, ELylatDragoonDamageKind::Collision);
+	}
+}
+
+void ALylatDragoonPawn::ResetFlight(const FLylatDragoonCourseFrame& Course, const FVector& PositionOffset)
+{
+	// Keep energy and cooldowns, but place the pawn on the course of now
+	FLylatDragoonFlightState State = FlightStepper.GetState();
+	State.Rotation = GetActorRotation();
+	State.Energy = CurrentEnergy;
+	State.PositionOffset = PositionOffset;
+	State.Location = Course.GetLocationAtOffset(State.PositionOffset);
+	State.PlayRate = LevelCourse->SequenceController->SequencePlayer->GetPlayRate();
+
+	FlightStepper.Reset(State);
+	PreviousCourseFrame = Course;
+	FlightNeedsReset = false;
+}
+
+void ALylatDragoonPawn::UpdateCamera(float DeltaSeconds)
+{
+	ALylatDragoonPlayerController* LylatController = Cast<ALylatDragoonPlayerController>(Controller);
+	if (LevelCourse && LylatController && IsLocallyControlled())
+	{
+#if LYLATDRAGOON_VALIDATE_TICK_ORDER
+		if (CVarValidateTickOrder.GetValueOnGameThread() != 0 && LastFlightUpdateFrame != GFrameCounter)
+		{
+			UE_LOG(LogFlying, Warning, TEXT("%s updated the camera before the flight update of this frame"), *GetName());
+		}
+#endif
 
 		FVector FinalSocketOffset = FVector::ZeroVector;
-		FinalSocketOffset.Z = -PositionOffset.Z * VerticalCameraDisplacement;
-		FinalSocketOffset.Y = PositionOffset.X * HorizontalCameraDisplacement;
+		// The spring arm is attached to the course, so the offset is already in its frame
+		FinalSocketOffset.Z = -CoursePositionOffset.Z * VerticalCameraDisplacement;
+		FinalSocketOffset.Y = -CoursePositionOffset.Y * HorizontalCameraDisplacement;
 
 		SpringArm->SocketOffset = FMath::VInterpTo(SpringArm->SocketOffset, FinalSocketOffset, DeltaSeconds, CamMovementRate);
 		FRotator FinalCameraRotation = Camera->RelativeRotation;
 		FinalCameraRotation.Roll += RightInput * CamRotationDegrees;
 		FinalCameraRotation = FMath::RInterpTo(FinalCameraRotation, FRotator::ZeroRotator, DeltaSeconds, CamRotationRecoveryRate);
 		Camera->SetRelativeRotation(FMath::RInterpTo(Camera->RelativeRotation, FinalCameraRotation, DeltaSeconds, CamRotationRate));
+	}
+}
 
-		AimPointLocation = GetActorLocation() + (GetActorRotation().Vector() * AimPointDistance);
+void ALylatDragoonPawn::RegisterActorTickFunctions(bool bRegister)
+{
+	Super::RegisterActorTickFunctions(bRegister);
 
-		PreviousLocation = GetActorLocation();
+	if (bRegister)
+	{
+		if (CameraTick.bCanEverTick)
+		{
+			CameraTick.Target = this;
+			CameraTick.SetTickFunctionEnable(CameraTick.bStartWithTickEnabled);
+			CameraTick.RegisterTickFunction(GetLevel());
+
+			// Flight update, then camera update, then spring arm
+			CameraTick.AddPrerequisite(this, PrimaryActorTick);
+			SpringArm->PrimaryComponentTick.AddPrerequisite(this, CameraTick);
+		}
+	}
+	else
+	{
+		if (CameraTick.IsTickFunctionRegistered())
+		{
+			CameraTick.UnRegisterTickFunction();
+		}
 	}
 }
 
@@ -197,14 +578,171 @@ void ALylatDragoonPawn::PostInitializeComponents()
 
 	CurrentHealth = MaxHealth;
 	CurrentEnergy = MaxEnergy;
+
+	// The replay is loaded before the pawn is possessed, so the player input is never bound during a replay
+	if (GetWorld() && GetWorld()->IsGameWorld())
+	{
+		const FString MapName = GetWorld()->GetMapName();
+
+		FString ReplayFilename;
+		if (FParse::Value(FCommandLine::Get(), TEXT("LylatReplayInput="), ReplayFilename))
+		{
+			if (FPaths::IsRelative(ReplayFilename))
+			{
+				ReplayFilename = FPaths::ProjectSavedDir() / TEXT("InputRecordings") / ReplayFilename;
+			}
+
+			if (InputPlayer.LoadFromFile(ReplayFilename))
+			{
+				if (InputPlayer.GetMapName() != MapName)
+				{
+					UE_LOG(LogFlying, Warning, TEXT("Input recording %s was made in %s, replaying it in %s"), *ReplayFilename, *InputPlayer.GetMapName(), *MapName);
+				}
+				UE_LOG(LogFlying, Log, TEXT("Replaying %d frames of input from %s"), InputPlayer.GetFrameCount(), *ReplayFilename);
+
+				// Step the engine with the recorded delta times, the first frame is set here and the next ones as the replay goes
+				FApp::SetUseFixedTimeStep(true);
+				FApp::SetFixedDeltaTime(InputPlayer.PeekNextDeltaTime());
+			}
+			else
+			{
+				UE_LOG(LogFlying, Error, TEXT("Could not load the input recording %s"), *ReplayFilename);
+			}
+		}
+	}
 }
 
 void ALylatDragoonPawn::BeginPlay()
 {
 	Super::BeginPlay();
 
+	// The flight update reads the level course, so it has to be updated first
+	if (LevelCourse)
+	{
+		AddTickPrerequisiteActor(LevelCourse);
+
+		const ULylatDragoonCourseDistanceField* DistanceField = LevelCourse->GetCourseDistanceField();
+		if (DistanceField->IsBaked() && WallContactRadius > DistanceField->GetBandDistance())
+		{
+			UE_LOG(LogFlying, Warning, TEXT("%s has a wall contact radius of %.0f, the distance field of %s only reaches %.0f from the walls. Clamped to the field, bake it with more BandVoxels"),
+				*GetName(), WallContactRadius, *LevelCourse->GetName(), DistanceField->GetBandDistance());
+		}
+	}
+
 	FTimerHandle TimerHandle;
 	GetWorldTimerManager().SetTimer(TimerHandle, this, &ALylatDragoonPawn::InitializePawnPosition, 1.0f, false);
+
+	const FString MapName = GetWorld()->GetMapName();
+
+	if (FParse::Value(FCommandLine::Get(), TEXT("LylatRecordInput="), InputRecordingFilename))
+	{
+		if (FPaths::IsRelative(InputRecordingFilename))
+		{
+			InputRecordingFilename = FPaths::ProjectSavedDir() / TEXT("InputRecordings") / InputRecordingFilename;
+		}
+		InputRecorder.Start(MapName);
+	}
+
+	FString TelemetryFilename;
+	if (FParse::Value(FCommandLine::Get(), TEXT("LylatTelemetry="), TelemetryFilename))
+	{
+		if (FPaths::IsRelative(TelemetryFilename))
+		{
+			TelemetryFilename = FPaths::ProjectSavedDir() / TEXT("Telemetry") / TelemetryFilename;
+		}
+		// Every pawn of the process logs to the same file, the first one starts it
+		TelemetryStarted = FLylatDragoonTelemetry::Get().Start(TelemetryFilename);
+	}
+
+	LoadPawnAssets();
+}
+
+void ALylatDragoonPawn::LoadPawnAssets()
+{
+	TArray<FSoftObjectPath> Assets;
+	if (!PlaneMesh->GetStaticMesh() && !PlaneMeshAsset.IsNull())
+	{
+		Assets.Add(PlaneMeshAsset.ToSoftObjectPath());
+	}
+	if (!Projectile.IsNull())
+	{
+		Assets.Add(Projectile.ToSoftObjectPath());
+	}
+
+	ALylatDragoonGameMode* GameMode = GetWorld()->GetAuthGameMode<ALylatDragoonGameMode>();
+
+	// A replay has to be able to shoot on the same frame as the recording, so it can't wait for the load
+	if (!GameMode || InputPlayer.IsPlaying())
+	{
+		for (const FSoftObjectPath& Asset : Assets)
+		{
+			Asset.TryLoad();
+		}
+		OnPawnAssetsLoaded();
+		return;
+	}
+
+	// Everything the player needs to fly comes first
+	GameMode->GetAssetStreamer()->RequestAssets(GetFName(), Assets, FStreamableDelegate::CreateUObject(this, &ALylatDragoonPawn::OnPawnAssetsLoaded), FStreamableManager::AsyncLoadHighPriority);
+}
+
+void ALylatDragoonPawn::OnPawnAssetsLoaded()
+{
+	if (!PlaneMesh->GetStaticMesh() && PlaneMeshAsset.Get())
+	{
+		PlaneMesh->SetStaticMesh(PlaneMeshAsset.Get());
+	}
+
+	// Have the projectiles ready before the first shot so firing never spawns actors, the clients only draw them
+	ALylatDragoonGameMode* GameMode = GetWorld()->GetAuthGameMode<ALylatDragoonGameMode>();
+	ULylatDragoonProjectilePool* Pool = GameMode ? GameMode->GetProjectilePool() : GetDisplayProjectilePool();
+	if (Pool && Projectile.Get())
+	{
+		Pool->Prewarm(Projectile.Get());
+	}
+
+	PawnAssetsLoaded = true;
+}
+
+void ALylatDragoonPawn::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (InputRecorder.IsRecording())
+	{
+		InputRecorder.Stop();
+		if (InputRecorder.SaveToFile(InputRecordingFilename))
+		{
+			UE_LOG(LogFlying, Log, TEXT("Recorded %d frames of input (%d bytes) to %s"), InputRecorder.GetFrameCount(), InputRecorder.GetStreamSize(), *InputRecordingFilename);
+		}
+		else
+		{
+			UE_LOG(LogFlying, Error, TEXT("Could not save the input recording to %s"), *InputRecordingFilename);
+		}
+	}
+
+	if (InputPlayer.GetFrameCount() > 0)
+	{
+		UE_LOG(LogFlying, Log, TEXT("Replayed %d of %d frames of input, %d diverged from the recording"), InputPlayer.GetFrameIndex(), InputPlayer.GetFrameCount(), ReplayDivergenceCount);
+		FApp::SetUseFixedTimeStep(false);
+	}
+
+	if (TelemetryStarted)
+	{
+		FLylatDragoonTelemetry::Get().Stop();
+		TelemetryStarted = false;
+	}
+
+	if (TotalNetBytes > 0)
+	{
+		UE_LOG(LogFlying, Log, TEXT("%s exchanged %lld bytes of flight updates, budget %.0f bytes per second"), *GetName(), TotalNetBytes, NetBytesPerSecondBudget);
+	}
+
+	ALylatDragoonGameMode* GameMode = GetWorld()->GetAuthGameMode<ALylatDragoonGameMode>();
+	if (GameMode)
+	{
+		GameMode->GetAssetStreamer()->ReleaseAssets(GetFName());
+	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void ALylatDragoonPawn::NotifyHit(class UPrimitiveComponent* MyComp, class AActor* Other, class UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit)
@@ -216,9 +754,11 @@ void ALylatDragoonPawn::NotifyActorBeginOverlap(AActor* OtherActor)
 {
 	Super::NotifyActorBeginOverlap(OtherActor);
 
-	if (OtherActor->GetOwner() != this)
+	// Applied after physics, never inside the overlap callback
+	ALylatDragoonGameMode* GameMode = GetWorld()->GetAuthGameMode<ALylatDragoonGameMode>();
+	if (OtherActor->GetOwner() != this && GameMode)
 	{
-		TakeDamage(10.0f, FDamageEvent(), nullptr, OtherActor);
+		GameMode->GetDamageQueue()->QueueDamage(this, OtherActor, nullptr, 10.0f, ELylatDragoonDamageKind::Collision);
 	}
 }
 
@@ -229,9 +769,16 @@ void ALylatDragoonPawn::NotifyActorEndOverlap(AActor* OtherActor)
 
 float ALylatDragoonPawn::TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser)
 {
-	CurrentHealth -= Damage;
+	// The server applies the damage of every pawn, whoever flies it, and replicates the health
+	if (Role == ROLE_Authority)
+	{
+		CurrentHealth -= Damage;
+
+		// Only the damage applied is logged, clients would log the health before the server replicates it
+		FLylatDragoonTelemetry::Get().Record(ELylatDragoonTelemetryEvent::DamageTaken, FLylatDragoonTelemetry::GetPlayerId(this), Damage, CurrentHealth);
+	}
 
-	if (CurrentHealth <= 0.0f)
+	if (Role == ROLE_Authority && CurrentHealth <= 0.0f)
 	{
 		Die();
 	}
@@ -248,6 +795,12 @@ void ALylatDragoonPawn::SetupPlayerInputComponent(class UInputComponent* PlayerI
 {
 	check(PlayerInputComponent);
 
+	// The replay feeds the callbacks itself
+	if (InputPlayer.IsPlaying())
+	{
+		return;
+	}
+
 	// Bind our control axis to callback functions
 	PlayerInputComponent->BindAxis("Thrust", this, &ALylatDragoonPawn::ThrustInput);
 
@@ -263,15 +816,22 @@ void ALylatDragoonPawn::SetupPlayerInputComponent(class UInputComponent* PlayerI
 	PlayerInputComponent->BindAction("RightTilt", EInputEvent::IE_DoubleClick, this, &ALylatDragoonPawn::RightTiltDoubleInput);
 
 	PlayerInputComponent->BindAction("Fire", EInputEvent::IE_Pressed, this, &ALylatDragoonPawn::FireInput);
+
+	PlayerInputComponent->BindAction("LockOn", EInputEvent::IE_Pressed, this, &ALylatDragoonPawn::LockOnInputPressed);
+	PlayerInputComponent->BindAction("LockOn", EInputEvent::IE_Released, this, &ALylatDragoonPawn::LockOnInputReleased);
 }
 
 void ALylatDragoonPawn::ThrustInput(float Val)
 {
+	InputRecorder.RecordAxis(ELylatDragoonInputAxis::Thrust, Val);
+
 	CurrentThrustInput = Val;
 }
 
 void ALylatDragoonPawn::MoveUpInput(float Val)
 {
+	InputRecorder.RecordAxis(ELylatDragoonInputAxis::MoveUp, Val);
+
 	//GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, FString::Printf(TEXT("MoveUpInput, Val: %f"), Val));
 
 	if (Val < 0)
@@ -290,6 +850,8 @@ void ALylatDragoonPawn::MoveUpInput(float Val)
 
 void ALylatDragoonPawn::MoveRightInput(float Val)
 {
+	InputRecorder.RecordAxis(ELylatDragoonInputAxis::MoveRight, Val);
+
 	//GEngine->AddOnScreenDebugMessage(-1, 5.f, FColor::Red, FString::Printf(TEXT("MoveRightInput, Val: %f"), Val));
 
 	if (Val < 0)
@@ -308,86 +870,515 @@ void ALylatDragoonPawn::MoveRightInput(float Val)
 
 void ALylatDragoonPawn::LeftTiltInputPressed()
 {
+	InputRecorder.RecordAction(ELylatDragoonInputAction::LeftTiltPressed);
+
 	LeftTiltPressed = true;
 }
 
 void ALylatDragoonPawn::LeftTiltInputReleased()
 {
+	InputRecorder.RecordAction(ELylatDragoonInputAction::LeftTiltReleased);
+
 	LeftTiltPressed = false;
 }
 
 void ALylatDragoonPawn::LeftTiltDoubleInput()
 {
-	if (!DoingBarrelRoll)
-	{
-		DoingBarrelRoll = true;
-		DoingLeftBarrelRoll = true;
-		FTimerHandle TimerHandle;
-		GetWorldTimerManager().SetTimer(TimerHandle, this, &ALylatDragoonPawn::FinishBarrelRoll, 0.5f, false);
-	}
+	InputRecorder.RecordAction(ELylatDragoonInputAction::LeftTiltDouble);
+
+	LeftBarrelRollRequested = true;
 }
 
 void ALylatDragoonPawn::RightTiltInputPressed()
 {
+	InputRecorder.RecordAction(ELylatDragoonInputAction::RightTiltPressed);
+
 	RightTiltPressed = true;
 }
 
 void ALylatDragoonPawn::RightTiltInputReleased()
 {
+	InputRecorder.RecordAction(ELylatDragoonInputAction::RightTiltReleased);
+
 	RightTiltPressed = false;
 }
 
 void ALylatDragoonPawn::RightTiltDoubleInput()
 {
-	if (!DoingBarrelRoll)
+	InputRecorder.RecordAction(ELylatDragoonInputAction::RightTiltDouble);
+
+	RightBarrelRollRequested = true;
+}
+
+void ALylatDragoonPawn::FireInput()
+{
+	InputRecorder.RecordAction(ELylatDragoonInputAction::Fire);
+
+	if (Role == ROLE_Authority)
 	{
-		DoingBarrelRoll = true;
-		DoingRightBarrelRoll = true;
-		FTimerHandle TimerHandle;
-		GetWorldTimerManager().SetTimer(TimerHandle, this, &ALylatDragoonPawn::FinishBarrelRoll, 0.5f, false);
+		FireShot();
+	}
+	else
+	{
+		// Draw the shot right away, the server fires it again and hits the enemies
+		ULylatDragoonProjectilePool* Pool = GetDisplayProjectilePool();
+		if (Pool && Projectile.Get() && ConsumeFireInterval(0.0f))
+		{
+			FireVolley(Pool);
+		}
+		ServerFire();
 	}
 }
 
-void ALylatDragoonPawn::FireInput()
+bool ALylatDragoonPawn::ServerFire_Validate()
+{
+	return true;
+}
+
+void ALylatDragoonPawn::ServerFire_Implementation()
+{
+	FireShot();
+}
+
+void ALylatDragoonPawn::FireShot()
+{
+	ALylatDragoonGameMode* GameMode = GetWorld()->GetAuthGameMode<ALylatDragoonGameMode>();
+	if (!Projectile.Get() || !GameMode)
+	{
+		return;
+	}
+
+	// The shots of a client arrive with the jitter of the network, one interval of slack keeps the average rate
+	if (!ConsumeFireInterval(FireInterval))
+	{
+		return;
+	}
+
+	const int32 FiredCount = FireVolley(GameMode->GetProjectilePool());
+	if (FiredCount > 0)
+	{
+		FLylatDragoonTelemetry::Get().Record(ELylatDragoonTelemetryEvent::ShotFired, FLylatDragoonTelemetry::GetPlayerId(this), (float)FiredCount);
+		MulticastFireVolley();
+	}
+}
+
+bool ALylatDragoonPawn::ConsumeFireInterval(float Slack)
 {
-	if (Projectile)
+	const float WorldTime = GetWorld()->GetTimeSeconds();
+	if (WorldTime < NextFireTime - Slack)
 	{
-		FTransform SpawnTM(GetTransform());
-		ALylatDragoonProjectile* ProjectileSpawned = Cast<ALylatDragoonProjectile>(UGameplayStatics::BeginDeferredActorSpawnFromClass(this, Projectile, SpawnTM));
-		if (ProjectileSpawned)
+		return false;
+	}
+	NextFireTime = FMath::Max(NextFireTime, WorldTime) + FireInterval;
+	return true;
+}
+
+int32 ALylatDragoonPawn::FireVolley(ULylatDragoonProjectilePool* Pool)
+{
+	// The soak test fires a volley of shots, laid out on a grid facing forward so they don't overlap
+	const int32 ShotCount = FLylatDragoonSoakSettings::Get().ProjectileScale;
+	const int32 Columns = FMath::CeilToInt(FMath::Sqrt((float)ShotCount));
+	const int32 Rows = FMath::DivideAndRoundUp(ShotCount, Columns);
+	const float Spacing = 2.0f * Projectile.Get()->GetDefaultObject<ALylatDragoonProjectile>()->HitRadius;
+
+	const FTransform PawnTransform = GetTransform();
+	const FVector Right = PawnTransform.GetUnitAxis(EAxis::Y);
+	const FVector Up = PawnTransform.GetUnitAxis(EAxis::Z);
+
+	int32 FiredCount = 0;
+	for (int32 Shot = 0; Shot < ShotCount; ++Shot)
+	{
+		const float Column = (Shot % Columns) - (Columns - 1) * 0.5f;
+		const float Row = (Shot / Columns) - (Rows - 1) * 0.5f;
+
+		FTransform SpawnTM = PawnTransform;
+		SpawnTM.AddToTranslation((Right * Column + Up * Row) * Spacing);
+
+		if (Pool->AcquireProjectile(Projectile.Get(), SpawnTM, this, Instigator))
 		{
-			ProjectileSpawned->Instigator = Instigator;
-			ProjectileSpawned->SetOwner(this);
+			FiredCount++;
+		}
+	}
+	return FiredCount;
+}
 
-			UGameplayStatics::FinishSpawningActor(ProjectileSpawned, SpawnTM);
+ULylatDragoonProjectilePool* ALylatDragoonPawn::GetDisplayProjectilePool() const
+{
+	ALylatDragoonPlayerController* PlayerController = Cast<ALylatDragoonPlayerController>(GetWorld()->GetFirstPlayerController());
+	return PlayerController && !HasAuthority() ? PlayerController->GetDisplayProjectilePool() : nullptr;
+}
+
+void ALylatDragoonPawn::MulticastFireVolley_Implementation()
+{
+	// The server and the player who fired already show the shot
+	ULylatDragoonProjectilePool* Pool = GetDisplayProjectilePool();
+	if (Pool && Projectile.Get() && !IsLocallyControlled())
+	{
+		FireVolley(Pool);
+	}
+}
+
+void ALylatDragoonPawn::MulticastFireLockOn_Implementation(const TArray<ALylatDragoonEnemy*>& Targets)
+{
+	ULylatDragoonProjectilePool* Pool = GetDisplayProjectilePool();
+	if (!Pool || !Projectile.Get())
+	{
+		return;
+	}
+
+	for (ALylatDragoonEnemy* Target : Targets)
+	{
+		// The enemy may be gone on this client already
+		if (Target)
+		{
+			ALylatDragoonProjectile* Shot = Pool->AcquireProjectile(Projectile.Get(), GetTransform(), this, Instigator);
+			if (Shot)
+			{
+				Shot->HomingTarget = Target;
+			}
 		}
 	}
 }
 
+void ALylatDragoonPawn::LockOnInputPressed()
+{
+	InputRecorder.RecordAction(ELylatDragoonInputAction::LockOnPressed);
+
+	LockOnPressed = true;
+	LockedTargets.Reset();
+
+	if (Role != ROLE_Authority)
+	{
+		ServerSetLockOn(true);
+	}
+}
+
+void ALylatDragoonPawn::LockOnInputReleased()
+{
+	InputRecorder.RecordAction(ELylatDragoonInputAction::LockOnReleased);
+
+	if (Role != ROLE_Authority)
+	{
+		ServerSetLockOn(false);
+	}
+	else if (LockOnPressed)
+	{
+		FireLockOn();
+	}
+	LockOnPressed = false;
+}
+
+bool ALylatDragoonPawn::ServerSetLockOn_Validate(bool bPressed)
+{
+	return true;
+}
+
+void ALylatDragoonPawn::ServerSetLockOn_Implementation(bool bPressed)
+{
+	if (bPressed)
+	{
+		LockedTargets.Reset();
+	}
+	else if (LockOnPressed)
+	{
+		FireLockOn();
+	}
+	LockOnPressed = bPressed;
+}
+
+void ALylatDragoonPawn::UpdateLockOn()
+{
+	ALylatDragoonGameMode* GameMode = GetWorld()->GetAuthGameMode<ALylatDragoonGameMode>();
+	if (!GameMode || LockedTargets.Num() >= MaxLockOnTargets)
+	{
+		return;
+	}
+
+	// Sweeping the aim over the enemies keeps adding them until the maximum is reached
+	LockOnCandidates.Reset();
+	GameMode->GetTargeting()->FindTargetsInCone(GetActorLocation(), GetActorRotation().Vector(), LockOnAngle, LockOnDistance, MaxLockOnTargets, LockOnCandidates);
+	for (ALylatDragoonEnemy* Candidate : LockOnCandidates)
+	{
+		if (LockedTargets.Num() >= MaxLockOnTargets)
+		{
+			break;
+		}
+		LockedTargets.AddUnique(Candidate);
+	}
+}
+
+void ALylatDragoonPawn::FireLockOn()
+{
+	ALylatDragoonGameMode* GameMode = GetWorld()->GetAuthGameMode<ALylatDragoonGameMode>();
+	if (Projectile.Get() && GameMode)
+	{
+		TArray<ALylatDragoonEnemy*> ShotTargets;
+		for (const TWeakObjectPtr<ALylatDragoonEnemy>& Target : LockedTargets)
+		{
+			if (Target.IsValid())
+			{
+				ALylatDragoonProjectile* Shot = GameMode->GetProjectilePool()->AcquireProjectile(Projectile.Get(), GetTransform(), this, Instigator);
+				if (Shot)
+				{
+					Shot->HomingTarget = Target.Get();
+					ShotTargets.Add(Target.Get());
+				}
+			}
+		}
+
+		if (ShotTargets.Num() > 0)
+		{
+			FLylatDragoonTelemetry::Get().Record(ELylatDragoonTelemetryEvent::ShotFired, FLylatDragoonTelemetry::GetPlayerId(this), (float)ShotTargets.Num(), 0.0f, 1);
+			MulticastFireLockOn(ShotTargets);
+		}
+	}
+
+	LockedTargets.Reset();
+}
+
+void ALylatDragoonPawn::ReplayInputFrame()
+{
+	FLylatDragoonInputFrame Frame;
+	if (!InputPlayer.NextFrame(Frame))
+	{
+		return;
+	}
+
+	ReplayExpectedHash = Frame.StateHash;
+
+	// The engine delta time is set one frame ahead
+	const float NextDeltaTime = InputPlayer.PeekNextDeltaTime();
+	if (NextDeltaTime > 0.0f)
+	{
+		FApp::SetFixedDeltaTime(NextDeltaTime);
+	}
+	else
+	{
+		UE_LOG(LogFlying, Log, TEXT("Input replay finished, %d of %d frames diverged from the recording"), ReplayDivergenceCount, InputPlayer.GetFrameCount());
+		FApp::SetUseFixedTimeStep(false);
+	}
+
+	if (Frame.AxisSetMask & (1 << (int32)ELylatDragoonInputAxis::Thrust))
+	{
+		ThrustInput(Frame.Axes[(int32)ELylatDragoonInputAxis::Thrust]);
+	}
+	if (Frame.AxisSetMask & (1 << (int32)ELylatDragoonInputAxis::MoveUp))
+	{
+		MoveUpInput(Frame.Axes[(int32)ELylatDragoonInputAxis::MoveUp]);
+	}
+	if (Frame.AxisSetMask & (1 << (int32)ELylatDragoonInputAxis::MoveRight))
+	{
+		MoveRightInput(Frame.Axes[(int32)ELylatDragoonInputAxis::MoveRight]);
+	}
+
+	for (ELylatDragoonInputAction Action : Frame.Actions)
+	{
+		switch (Action)
+		{
+		case ELylatDragoonInputAction::LeftTiltPressed:		LeftTiltInputPressed(); break;
+		case ELylatDragoonInputAction::LeftTiltReleased:	LeftTiltInputReleased(); break;
+		case ELylatDragoonInputAction::LeftTiltDouble:		LeftTiltDoubleInput(); break;
+		case ELylatDragoonInputAction::RightTiltPressed:	RightTiltInputPressed(); break;
+		case ELylatDragoonInputAction::RightTiltReleased:	RightTiltInputReleased(); break;
+		case ELylatDragoonInputAction::RightTiltDouble:		RightTiltDoubleInput(); break;
+		case ELylatDragoonInputAction::Fire:				FireInput(); break;
+		case ELylatDragoonInputAction::LockOnPressed:		LockOnInputPressed(); break;
+		case ELylatDragoonInputAction::LockOnReleased:		LockOnInputReleased(); break;
+		default: break;
+		}
+	}
+}
+
+void ALylatDragoonPawn::EndInputFrame(float DeltaSeconds)
+{
+	if (!InputRecorder.IsRecording() && ReplayExpectedHash == 0)
+	{
+		return;
+	}
+
+	const uint32 StateHash = ComputeStateHash();
+
+	InputRecorder.EndFrame(DeltaSeconds, StateHash);
+
+	if (ReplayExpectedHash != 0)
+	{
+		if (StateHash != ReplayExpectedHash)
+		{
+			// Everything after the first divergence usually diverges too, only the first one is worth a warning
+			if (ReplayDivergenceCount == 0)
+			{
+				UE_LOG(LogFlying, Warning, TEXT("Input replay diverged from the recording at frame %d"), InputPlayer.GetFrameIndex() - 1);
+			}
+			ReplayDivergenceCount++;
+		}
+		ReplayExpectedHash = 0;
+	}
+}
+
+uint32 ALylatDragoonPawn::ComputeStateHash() const
+{
+	struct FHashedState
+	{
+		FVector Location;
+		FQuat Rotation;
+		float Energy;
+		float Health;
+		float PlaybackPosition;
+	};
+
+	FHashedState State;
+	FMemory::Memzero(State);
+	State.Location = GetActorLocation();
+	State.Rotation = GetActorQuat();
+	State.Energy = CurrentEnergy;
+	State.Health = CurrentHealth;
+	if (LevelCourse && LevelCourse->SequenceController && LevelCourse->SequenceController->SequencePlayer)
+	{
+		State.PlaybackPosition = LevelCourse->SequenceController->SequencePlayer->GetPlaybackPosition();
+	}
+
+	// Never 0, which means that no hash is expected
+	return FMath::Max(FCrc::MemCrc32(&State, sizeof(State)), 1u);
+}
+
 void ALylatDragoonPawn::Die()
 {
-	LevelCourse->SequenceController->SequencePlayer->SetPlaybackPosition(0.0f);
 	CurrentHealth = MaxHealth;
+
+	UMovieSceneSequencePlayer* SequencePlayer = LevelCourse->SequenceController->SequencePlayer;
+	FLylatDragoonTelemetry::Get().Record(ELylatDragoonTelemetryEvent::Death, FLylatDragoonTelemetry::GetPlayerId(this), 0.0f, SequencePlayer->GetPlaybackPosition());
+
+	// The autopilot does not dodge, the soak test has to play the whole sequence without rewinding it
+	if (FLylatDragoonSoakSettings::Get().bEnabled)
+	{
+		return;
+	}
+
+	// The course and its enemy waves are shared, every player starts again with the server. The spawner resets the
+	// waves when it sees the sequence of the server go back
+	SequencePlayer->SetPlaybackPosition(0.0f);
+
+	for (TActorIterator<ALylatDragoonPawn> PawnItr(GetWorld()); PawnItr; ++PawnItr)
+	{
+		ALylatDragoonPawn* Pawn = *PawnItr;
+		Pawn->CurrentHealth = Pawn->MaxHealth;
+
+		if (Pawn->IsLocallyControlled())
+		{
+			// Player of a listen server, its sequence is the one of the server
+			Pawn->FlightNeedsReset = true;
+		}
+		else
+		{
+			Pawn->ClientRestartCourse();
+		}
+	}
 }
 
-void ALylatDragoonPawn::FinishEnergyCooldown()
+void ALylatDragoonPawn::ClientRestartCourse_Implementation()
 {
-	EnergyInCooldown = false;
+	LevelCourse->SequenceController->SequencePlayer->SetPlaybackPosition(0.0f);
+
+	// The course jumps back to the start, don't blend the flight across the jump
+	FlightNeedsReset = true;
 }
 
-void ALylatDragoonPawn::FinishBarrelRoll()
+void ALylatDragoonPawn::RecordFlightTelemetry()
 {
-	DoingBarrelRoll = false;
-	DoingLeftBarrelRoll = false;
-	DoingRightBarrelRoll = false;
+	FLylatDragoonTelemetry& Telemetry = FLylatDragoonTelemetry::Get();
+	if (!Telemetry.IsRecording())
+	{
+		return;
+	}
+
+	const FLylatDragoonFlightState& State = FlightStepper.GetState();
+	const uint16 PlayerId = FLylatDragoonTelemetry::GetPlayerId(this);
+
+	if (State.IsEnergyInCooldown() && !TelemetryEnergyCooldown)
+	{
+		Telemetry.Record(ELylatDragoonTelemetryEvent::EnergyCooldown, PlayerId, State.Energy);
+	}
+	TelemetryEnergyCooldown = State.IsEnergyInCooldown();
+
+	if (State.BarrelRollDirection != 0 && State.BarrelRollDirection != TelemetryBarrelRollDirection)
+	{
+		Telemetry.Record(ELylatDragoonTelemetryEvent::BarrelRoll, PlayerId, 0.0f, 0.0f, State.BarrelRollDirection > 0 ? 1 : 0);
+	}
+	TelemetryBarrelRollDirection = State.BarrelRollDirection;
+
+	// The play rate changes a little every frame while boosting or braking, only log the steps
+	if (FMath::Abs(State.PlayRate - TelemetryPlayRate) >= 0.05f)
+	{
+		Telemetry.Record(ELylatDragoonTelemetryEvent::PlayRate, PlayerId, State.PlayRate);
+		TelemetryPlayRate = State.PlayRate;
+	}
+
+	LYLATDRAGOON_SET_COUNTER(TelemetryDropped, Telemetry.GetDroppedCount());
 }
 
 void ALylatDragoonPawn::InitializePawnPosition()
 {
-	if (LevelCourse)
+	// The pawns of the other players are placed by their flight updates
+	if (LevelCourse && IsLocallyControlled())
 	{
 		SetActorLocation(LevelCourse->GetActorLocation());
 		SetActorRotation(LevelCourse->GetActorRotation());
 		SpringArm->AttachToComponent(LevelCourse->GetRootComponent(), FAttachmentTransformRules::KeepRelativeTransform);
+
+		ResetFlight(FLylatDragoonCourseFrame(LevelCourse->GetActorLocation(), LevelCourse->GetActorRotation()), FVector::ZeroVector);
 	}
-}
\ No newline at end of file
+}
+
+static void CheckCoop(UWorld* World)
+{
+	if (!World || World->GetNetMode() == NM_Client || World->GetNetMode() == NM_Standalone)
+	{
+		UE_LOG(LogFlying, Error, TEXT("The co-op check runs on the server of a networked game"));
+		return;
+	}
+
+	int32 PawnCount = 0;
+	int32 FailedCount = 0;
+	for (TActorIterator<ALylatDragoonPawn> PawnItr(World); PawnItr; ++PawnItr)
+	{
+		ALylatDragoonPawn* Pawn = *PawnItr;
+		PawnCount++;
+
+		// The server applies the damage of every pawn, the ones of the clients included. Half the health never kills
+		const float Health = Pawn->CurrentHealth;
+		const float TestDamage = Health * 0.5f;
+		Pawn->TakeDamage(TestDamage, FDamageEvent(), nullptr, nullptr);
+		const bool bDamageApplied = FMath::IsNearlyEqual(Pawn->CurrentHealth, Health - TestDamage, 0.01f);
+		Pawn->CurrentHealth = Health;
+
+		// The flight updates of the clients keep arriving, within their budget
+		const int32 BytesPerSecond = Pawn->GetNetBytesPerSecond();
+		const bool bLocal = Pawn->IsLocallyControlled();
+		const bool bRateInBudget = bLocal || (BytesPerSecond > 0 && BytesPerSecond <= Pawn->NetBytesPerSecondBudget * 1.1f);
+
+		if (bDamageApplied && bRateInBudget)
+		{
+			UE_LOG(LogFlying, Display, TEXT("%s%s: damage applied, %d of %.0f bytes per second of flight updates"), *Pawn->GetName(), bLocal ? TEXT(" (local)") : TEXT(""), BytesPerSecond, Pawn->NetBytesPerSecondBudget);
+		}
+		else
+		{
+			UE_LOG(LogFlying, Error, TEXT("%s%s: damage %s, %d of %.0f bytes per second of flight updates"), *Pawn->GetName(), bLocal ? TEXT(" (local)") : TEXT(""),
+				bDamageApplied ? TEXT("applied") : TEXT("not applied"), BytesPerSecond, Pawn->NetBytesPerSecondBudget);
+			FailedCount++;
+		}
+	}
+
+	if (PawnCount > 0 && FailedCount == 0)
+	{
+		UE_LOG(LogFlying, Display, TEXT("Co-op check of %d pawns. Passed"), PawnCount);
+	}
+	else
+	{
+		UE_LOG(LogFlying, Error, TEXT("Co-op check of %d pawns, %d failed. Failed"), PawnCount, FailedCount);
+	}
+}
+
+static FAutoConsoleCommandWithWorld CheckCoopCommand(
+	TEXT("LylatDragoon.CheckCoop"),
+	TEXT("On the server, check the damage of every pawn is applied and the flight updates of the clients arrive within their budget."),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&CheckCoop));
@@ -1,8 +1,35 @@
 // Copyright 1998-2015 Epic Games, Inc. All Rights Reserved.
 #pragma once
 #include "GameFramework/Pawn.h"
+#include "LylatDragoonFlightModel.h"
+#include "LylatDragoonInputRecording.h"
+#include "LylatDragoonReplicatedFlight.h"
 #include "LylatDragoonPawn.generated.h"
 
+/** Late update of the camera of the pawn, after the flight of the pawn and before the spring arm */
+USTRUCT()
+struct FLylatDragoonCameraTickFunction : public FTickFunction
+{
+	GENERATED_BODY()
+
+	/** Pawn whose camera is updated */
+	class ALylatDragoonPawn* Target;
+
+	// Begin FTickFunction overrides
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+	// End FTickFunction overrides
+};
+
+template<>
+struct TStructOpsTypeTraits<FLylatDragoonCameraTickFunction> : public TStructOpsTypeTraitsBase2<FLylatDragoonCameraTickFunction>
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
 UCLASS(config=Game)
 class LYLATDRAGOON_API ALylatDragoonPawn : public APawn
 {
@@ -23,8 +50,8 @@ class LYLATDRAGOON_API ALylatDragoonPawn : public APawn
 public:
 	ALylatDragoonPawn(const FObjectInitializer& ObjectInitializer);
 
-	/** The current value of the health */
-	UPROPERTY(Category = Health, BlueprintReadOnly)
+	/** The current value of the health, applied by the server and replicated */
+	UPROPERTY(Category = Health, BlueprintReadOnly, Replicated)
 	float CurrentHealth;
 
 	/** The current value of the energy */
@@ -32,21 +59,38 @@ public:
 	float CurrentEnergy;
 
 	// Begin AActor overrides
+	virtual void RegisterActorTickFunctions(bool bRegister) override;
 	virtual void PostInitializeComponents() override;
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void Tick(float DeltaSeconds) override;
 	virtual void NotifyHit(class UPrimitiveComponent* MyComp, class AActor* Other, class UPrimitiveComponent* OtherComp, bool bSelfMoved, FVector HitLocation, FVector HitNormal, FVector NormalImpulse, const FHitResult& Hit) override;
 	virtual void NotifyActorBeginOverlap(AActor* OtherActor) override;
 	virtual void NotifyActorEndOverlap(AActor* OtherActor) override;
 	virtual float TakeDamage(float Damage, struct FDamageEvent const& DamageEvent, AController* EventInstigator, AActor* DamageCauser) override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void ApplyWorldOffset(const FVector& InOffset, bool bWorldShift) override;
 	// End AActor overrides
 
 	/** Return the aim point */
 	FVector GetAimPointLocation();
 
-	/** Blueprint of the projectile to shoot */
+	/** Returns the enemies locked on while the lock-on button is held */
+	FORCEINLINE const TArray<TWeakObjectPtr<class ALylatDragoonEnemy>>& GetLockedTargets() const { return LockedTargets; }
+
+	/** Returns the bytes of flight updates sent or received in the last whole second */
+	FORCEINLINE int32 GetNetBytesPerSecond() const { return NetBytesPerSecond; }
+
+	/** Move the camera according to the position of the pawn. Called after the flight update of the frame */
+	void UpdateCamera(float DeltaSeconds);
+
+	/** Blueprint of the projectile to shoot, loaded asynchronously on BeginPlay */
 	UPROPERTY(Category = Combat, EditAnywhere)
-	TSubclassOf<class ALylatDragoonProjectile> Projectile;
+	TSoftClassPtr<class ALylatDragoonProjectile> Projectile;
+
+	/** Mesh of the ship, loaded asynchronously on BeginPlay. Only used when the mesh component has no mesh set */
+	UPROPERTY(Category = Mesh, EditDefaultsOnly)
+	TSoftObjectPtr<UStaticMesh> PlaneMeshAsset;
 
 	/** Max level of energy */
 	UPROPERTY(Category = Energy, EditAnywhere)
@@ -120,6 +164,22 @@ public:
 	UPROPERTY(Category = Movement, EditAnywhere)
 	float DownMovementLimit;
 
+	/** Radius of the pawn against the walls of the level. Closer to a wall the pawn is pushed out of it. Clamped to the band of the course distance field */
+	UPROPERTY(Category = Movement, EditAnywhere)
+	float WallContactRadius;
+
+	/** Damage per second while the pawn scrapes a wall */
+	UPROPERTY(Category = Combat, EditAnywhere)
+	float WallScrapeDamageRate;
+
+	/** Number of steps per second of the flight model. The handling is the same at any frame rate */
+	UPROPERTY(Category = Movement, EditAnywhere)
+	float FlightStepRate;
+
+	/** Max number of steps of the flight model in a frame */
+	UPROPERTY(Category = Movement, EditAnywhere)
+	int32 MaxFlightSubsteps;
+
 	/** Vertical displacement of the camera when the player moves vertically from the level course */
 	UPROPERTY(Category = Camera, EditAnywhere)
 	float VerticalCameraDisplacement;
@@ -148,6 +208,34 @@ public:
 	UPROPERTY(Category = Combat, EditAnywhere)
 	float AimPointDistance;
 
+	/** Minimum time between two shots (in seconds). The server drops the shots fired faster */
+	UPROPERTY(Category = Combat, EditAnywhere)
+	float FireInterval;
+
+	/** Half angle of the cone around the aim ray where enemies can be locked on (in degrees) */
+	UPROPERTY(Category = Combat, EditAnywhere)
+	float LockOnAngle;
+
+	/** Maximum distance of the enemies that can be locked on */
+	UPROPERTY(Category = Combat, EditAnywhere)
+	float LockOnDistance;
+
+	/** Maximum number of enemies locked on at the same time, one homing shot is fired at each of them */
+	UPROPERTY(Category = Combat, EditAnywhere)
+	int32 MaxLockOnTargets;
+
+	/** Bytes per second the flight of a player may use, the updates are sent as often as it allows */
+	UPROPERTY(Category = Network, EditAnywhere)
+	float NetBytesPerSecondBudget;
+
+	/** Rate at which the pawns of the other players blend toward their last update */
+	UPROPERTY(Category = Network, EditAnywhere)
+	float NetSmoothingRate;
+
+	/** Distance beyond the wall contact radius at which the server still counts the flight of a client as scraping a wall */
+	UPROPERTY(Category = Network, EditAnywhere)
+	float NetWallContactTolerance;
+
 protected:
 
 	// Begin APawn overrides
@@ -180,20 +268,106 @@ protected:
 	/** Bound to the fire button */
 	void FireInput();
 
+	/** Bound to the lock-on button pressed */
+	void LockOnInputPressed();
+	/** Bound to the lock-on button released */
+	void LockOnInputReleased();
+
+	/** The autopilot of the soak test feeds the same input callbacks */
+	friend struct FLylatDragoonAutopilot;
+
 private:
 
-	/** Execute the die procedure */
+	/** Execute the die procedure. Only called on the server, which starts the course again for every player */
 	void Die();
 
-	/** Callback when the cooldown of automatic energy refill ends */
-	void FinishEnergyCooldown();
+	/** Tells the player of a client to start the course again with the server */
+	UFUNCTION(Client, Reliable)
+	void ClientRestartCourse();
+
+	/** Fire a shot from the projectile pool, or a volley of them in the soak test. Only called on the server */
+	void FireShot();
+
+	/** Start the fire interval if it is over. Returns false when the shot has to wait */
+	bool ConsumeFireInterval(float Slack);
+
+	/** Fire a shot or a volley from the pool, laid out in front of the pawn. Returns the number of shots fired */
+	int32 FireVolley(class ULylatDragoonProjectilePool* Pool);
+
+	/** Returns the pool drawing the shots on a client, null on the server */
+	class ULylatDragoonProjectilePool* GetDisplayProjectilePool() const;
+
+	/** Receives the shots of the player of a client */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerFire();
+
+	/** Draws a shot fired on the server on the clients, except the one which fired it already */
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastFireVolley();
+
+	/** Draws the homing shots fired on the server at the locked targets on the clients */
+	UFUNCTION(NetMulticast, Unreliable)
+	void MulticastFireLockOn(const TArray<class ALylatDragoonEnemy*>& Targets);
+
+	/** Receives the lock-on button of the player of a client, the server locks on and fires the homing shots */
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerSetLockOn(bool bPressed);
+
+	/** Returns the tuning of the flight model from the properties */
+	FLylatDragoonFlightParams GetFlightParams() const;
 
-	/** Callback when we finish a barrel roll */
-	void FinishBarrelRoll();
+	/** Add the enemies in the lock-on cone to the locked targets */
+	void UpdateLockOn();
+
+	/** Fire a homing shot at every locked target and clear them */
+	void FireLockOn();
+
+	/** Start the flight model again at the given offset from the course frame, keeping the energy of the pawn */
+	void ResetFlight(const FLylatDragoonCourseFrame& Course, const FVector& PositionOffset);
+
+	/** Push the pawn out of the walls of the level, damaging it while it scrapes them */
+	void ResolveWallContact(const FLylatDragoonCourseFrame& Course, float DeltaSeconds);
 
 	/** Teleport the player to the level course position */
 	void InitializePawnPosition();
 
+	/** Feed the input callbacks of the next recorded frame */
+	void ReplayInputFrame();
+
+	/** Record the frame or check it against the replayed one */
+	void EndInputFrame(float DeltaSeconds);
+
+	/** Log the energy cooldowns, barrel rolls and play rate changes of the last flight update */
+	void RecordFlightTelemetry();
+
+	/** Returns a hash of the state compared between a recording and its replay */
+	uint32 ComputeStateHash() const;
+
+	/** Send the flight of the local player to the server, as often as the budget allows */
+	void SendReplicatedFlight(float DeltaSeconds);
+
+	/** Place the pawn of another player from its last update and the local course */
+	void ApplyReplicatedFlight(float DeltaSeconds);
+
+	/** Add the bytes of a flight update sent or received to the measured rate */
+	void CountNetBytes(int32 Bytes);
+
+	/** Receives the flight of the local player of a client */
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void ServerUpdateFlight(const FLylatDragoonReplicatedFlight& Flight);
+
+	/** Damage the pawn of a client if its flight update is scraping a wall, for the time since the previous update */
+	void ApplyNetWallContact(const FLylatDragoonReplicatedFlight& Flight, float ElapsedTime);
+
+	UFUNCTION()
+	void OnRep_ReplicatedFlight();
+
+	/** Load the mesh and the projectile of the pawn, synchronously when replaying input */
+	void LoadPawnAssets();
+
+	/** Set the mesh and prewarm the projectiles once they are loaded */
+	void OnPawnAssetsLoaded();
+
 	/** Indicates what was the last value of the right input */
 	float RightInput;
 	/** Indicates what was the last value of the up intput */
@@ -207,15 +381,38 @@ private:
 	/** Indicates if the right tilt button was pressed */
 	bool RightTiltPressed;
 
-	/** Indicates if I am doing a barrel roll or not */
-	bool DoingBarrelRoll;
-	/** Indicates if I am doing a barrel roll to the left */
-	bool DoingLeftBarrelRoll;
-	/** Indicates if I am doing a barrel roll to the right */
-	bool DoingRightBarrelRoll;
+	/** Indicates if the lock-on button is held */
+	bool LockOnPressed;
+
+	/** World time from which the next shot can be fired, on the server and on the client firing */
+	float NextFireTime;
+
+	/** Enemies locked on since the lock-on button was pressed, found by the server and replicated to the player */
+	UPROPERTY(Replicated)
+	TArray<TWeakObjectPtr<class ALylatDragoonEnemy>> LockedTargets;
+
+	/** Scratch buffer with the enemies found in the lock-on cone */
+	TArray<class ALylatDragoonEnemy*> LockOnCandidates;
+
+	/** Indicates if a barrel roll to the left was requested and not started yet */
+	bool LeftBarrelRollRequested;
+	/** Indicates if a barrel roll to the right was requested and not started yet */
+	bool RightBarrelRollRequested;
+
+	/** Indicates if the flight model has to start again from the current state of the pawn */
+	bool FlightNeedsReset;
+
+	/** Indicates if the mesh and the projectile of the pawn are loaded */
+	bool PawnAssetsLoaded;
+
+	/** Indicates if the first controllable frame was reported to the asset streamer */
+	bool StartupReported;
 
-	/** Indicates if the automatic energy refill is in cooldown */
-	bool EnergyInCooldown;
+	/** Runs the flight model at a fixed rate */
+	FLylatDragoonFlightStepper FlightStepper;
+
+	/** Frame of the level course in the last flight update */
+	FLylatDragoonCourseFrame PreviousCourseFrame;
 
 	/** Point where the ship shoot at, in world space */
 	FVector AimPointLocation;
@@ -223,6 +420,71 @@ private:
 	/** Location of the player in the last frame */
 	FVector PreviousLocation;
 
+	/** Offset of the player from the level course in the frame of the course, used to displace the camera */
+	FVector CoursePositionOffset;
+
+	/** Value of GFrameCounter in the last flight update, used to validate the tick order */
+	uint64 LastFlightUpdateFrame;
+
+	/** Records the input callbacks when launched with -LylatRecordInput */
+	FLylatDragoonInputRecorder InputRecorder;
+
+	/** Replays the input callbacks when launched with -LylatReplayInput */
+	FLylatDragoonInputPlayer InputPlayer;
+
+	/** File the input recording is saved to on EndPlay */
+	FString InputRecordingFilename;
+
+	/** Hash of the state recorded for the frame being replayed */
+	uint32 ReplayExpectedHash;
+
+	/** Number of replayed frames whose state differs from the recording */
+	int32 ReplayDivergenceCount;
+
+	/** Indicates if this pawn started the telemetry log, and has to stop it */
+	bool TelemetryStarted;
+
+	/** Flight state of the last events logged, only the changes are logged */
+	bool TelemetryEnergyCooldown;
+	int32 TelemetryBarrelRollDirection;
+	float TelemetryPlayRate;
+
+	/** Flight of the pawn, sent by its player to the server and from the server to the other players */
+	UPROPERTY(ReplicatedUsing = OnRep_ReplicatedFlight)
+	FLylatDragoonReplicatedFlight ReplicatedFlight;
+
+	/** Indicates if a flight update was received for the pawn of another player */
+	bool ReplicatedFlightReceived;
+
+	/** Course time of the pawn of another player, extrapolated between updates */
+	float ReplicatedCourseTime;
+
+	/** Offset and rotation presented for the pawn of another player, blended toward the last update */
+	FVector2D SmoothedNetOffset;
+	FRotator SmoothedNetRotation;
+
+	/** Time since the last flight update was sent */
+	float NetSendTimer;
+
+	/** Size of the last flight update */
+	int32 NetFlightBytes;
+
+	/** World time the server received the last flight update of the pawn of a client, negative before the first one */
+	float LastFlightUpdateTime;
+
+	/** Bytes of flight updates sent or received in the current second, and the time of it */
+	int32 NetBytesThisSecond;
+	float NetSecondTimer;
+
+	/** Bytes of flight updates sent or received in the last whole second */
+	int32 NetBytesPerSecond;
+
+	/** Bytes of flight updates sent or received since the game started */
+	int64 TotalNetBytes;
+
+	/** Tick function of the camera, which runs after the flight update */
+	FLylatDragoonCameraTickFunction CameraTick;
+
 	/** Object to follow level course */
 	class ALylatDragoonLevelCourse* LevelCourse;
 
@@ -3,10 +3,48 @@
 #include "LylatDragoon.h"
 #include "LylatDragoonPlayerController.h"
 
+#include "LylatDragoonBulletField.h"
+#include "LylatDragoonPawn.h"
+#include "LylatDragoonProjectilePool.h"
+#include "LylatDragoonSoakRecorder.h"
+
 #include "Engine/LocalPlayer.h"
 
 ALylatDragoonPlayerController::ALylatDragoonPlayerController(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 {
+	DisplayProjectilePool = CreateDefaultSubobject<ULylatDragoonProjectilePool>(TEXT("DisplayProjectilePool0"));
+	DisplayBulletField = nullptr;
+
+	AutopilotEnabled = false;
+}
+
+void ALylatDragoonPlayerController::BeginPlay()
+{
+	Super::BeginPlay();
+
+	AutopilotEnabled = FLylatDragoonSoakSettings::Get().bEnabled;
+}
+
+void ALylatDragoonPlayerController::PlayerTick(float DeltaTime)
+{
+	// Processes the player input first, so the autopilot overrides the axes bound on the pawn
+	Super::PlayerTick(DeltaTime);
 
+	if (AutopilotEnabled)
+	{
+		Autopilot.Update(Cast<ALylatDragoonPawn>(GetPawn()), DeltaTime);
+	}
+}
+
+ALylatDragoonBulletField* ALylatDragoonPlayerController::GetDisplayBulletField()
+{
+	if (!DisplayBulletField)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.Owner = this;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		DisplayBulletField = GetWorld()->SpawnActor<ALylatDragoonBulletField>(SpawnParams);
+	}
+	return DisplayBulletField;
 }
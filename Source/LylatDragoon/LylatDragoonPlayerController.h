@@ -3,6 +3,7 @@
 #pragma once
 
 #include "GameFramework/PlayerController.h"
+#include "LylatDragoonAutopilot.h"
 #include "LylatDragoonPlayerController.generated.h"
 
 /**
@@ -16,4 +17,31 @@ class LYLATDRAGOON_API ALylatDragoonPlayerController : public APlayerController
 public:
 
 	ALylatDragoonPlayerController(const FObjectInitializer& ObjectInitializer);
+
+	// Begin APlayerController overrides
+	virtual void BeginPlay() override;
+	virtual void PlayerTick(float DeltaTime) override;
+	// End APlayerController overrides
+
+	/** Returns the bullet field drawing the bullets of the enemies on a client, spawned on first use */
+	class ALylatDragoonBulletField* GetDisplayBulletField();
+
+	/** Returns DisplayProjectilePool subobject **/
+	FORCEINLINE class ULylatDragoonProjectilePool* GetDisplayProjectilePool() const { return DisplayProjectilePool; }
+
+private:
+
+	/** Draws the shots of the players on a client, the server pool of the game mode hits the enemies */
+	UPROPERTY(Category = Combat, VisibleDefaultsOnly, meta = (AllowPrivateAccess = "true"))
+	class ULylatDragoonProjectilePool* DisplayProjectilePool;
+
+	/** Runs the bullet patterns of the enemies on a client for display, from the seeds of the server */
+	UPROPERTY(Transient)
+	class ALylatDragoonBulletField* DisplayBulletField;
+
+	/** Indicates if the pawn is flown by the autopilot instead of the player */
+	bool AutopilotEnabled;
+
+	/** Scripted pilot of the soak test */
+	FLylatDragoonAutopilot Autopilot;
 };
@@ -7,25 +7,39 @@
 // Sets default values
 ALylatDragoonProjectile::ALylatDragoonProjectile()
 {
- 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = true;
-
+ 	// The projectile pool moves the projectiles, they don't need to tick
+	PrimaryActorTick.bCanEverTick = false;
+
+	HitRadius = 10.0f;
+	Damage = 10.0f;
+	LifeTime = 3.0f;
+	HomingTurnRate = 360.0f;
+	SimulationIndex = INDEX_NONE;
 }
 
 // Called when the game starts or when spawned
 void ALylatDragoonProjectile::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	// Hits are checked by the projectile pool, the projectile never generates physics overlaps
+	SetActorEnableCollision(false);
 }
 
-// Called every frame
-void ALylatDragoonProjectile::Tick( float DeltaTime )
+void ALylatDragoonProjectile::ActivateFromPool(const FTransform& SpawnTM, AActor* NewOwner, APawn* NewInstigator)
 {
-	Super::Tick( DeltaTime );
-	
-	FVector FinalLocation = GetActorLocation() + (GetActorRotation().Vector().GetSafeNormal() * (DeltaTime * ProjectileSpeed));
+	SetActorLocationAndRotation(SpawnTM.GetLocation(), SpawnTM.GetRotation(), false, nullptr, ETeleportType::TeleportPhysics);
+
+	Instigator = NewInstigator;
+	SetOwner(NewOwner);
 
-	SetActorLocation(FinalLocation);
+	SetActorHiddenInGame(false);
 }
 
+void ALylatDragoonProjectile::DeactivateToPool()
+{
+	SetActorHiddenInGame(true);
+
+	HomingTarget.Reset();
+	SimulationIndex = INDEX_NONE;
+}
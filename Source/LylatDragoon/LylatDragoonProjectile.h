@@ -16,14 +16,41 @@ public:
 
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
-	
-	// Called every frame
-	virtual void Tick( float DeltaSeconds ) override;
 
 	/** Projectile speed when fired */
 	UPROPERTY(Category = ProjectileMovement, EditAnywhere)
 	float ProjectileSpeed;
 
-	
+	/** Radius of the sphere used to check hits against enemies */
+	UPROPERTY(Category = Combat, EditAnywhere)
+	float HitRadius;
+
+	/** Damage applied to the enemies hit by the projectile */
+	UPROPERTY(Category = Combat, EditAnywhere)
+	float Damage;
+
+	/** For how long the projectile flies before going back to the pool (in seconds) */
+	UPROPERTY(Category = ProjectileMovement, EditAnywhere)
+	float LifeTime;
+
+	/** Maximum rotation towards the homing target per second (in degrees) */
+	UPROPERTY(Category = ProjectileMovement, EditAnywhere)
+	float HomingTurnRate;
+
+	/** Actor the projectile turns to while in flight, if any */
+	TWeakObjectPtr<AActor> HomingTarget;
+
+	/** Place the projectile at the given transform and start flying */
+	void ActivateFromPool(const FTransform& SpawnTM, AActor* NewOwner, APawn* NewInstigator);
+
+	/** Hide the projectile and stop it until it is fired again */
+	void DeactivateToPool();
+
+private:
+
+	friend class ULylatDragoonProjectilePool;
+
+	/** Index of this projectile in the simulation of the pool while it is in flight */
+	int32 SimulationIndex;
 	
 };
@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonProjectileBuffer.h"
+
+void FLylatDragoonProjectileBuffer::Reserve(int32 Number)
+{
+	PositionX.Reserve(Number);
+	PositionY.Reserve(Number);
+	PositionZ.Reserve(Number);
+	DirectionX.Reserve(Number);
+	DirectionY.Reserve(Number);
+	DirectionZ.Reserve(Number);
+	Speed.Reserve(Number);
+	RemainingLifeTime.Reserve(Number);
+}
+
+int32 FLylatDragoonProjectileBuffer::Add(const FVector& Location, const FVector& Direction, float InSpeed, float LifeTime)
+{
+	PositionX.Add(Location.X);
+	PositionY.Add(Location.Y);
+	PositionZ.Add(Location.Z);
+	DirectionX.Add(Direction.X);
+	DirectionY.Add(Direction.Y);
+	DirectionZ.Add(Direction.Z);
+	RemainingLifeTime.Add(LifeTime);
+	return Speed.Add(InSpeed);
+}
+
+void FLylatDragoonProjectileBuffer::RemoveAtSwap(int32 Index)
+{
+	PositionX.RemoveAtSwap(Index, 1, false);
+	PositionY.RemoveAtSwap(Index, 1, false);
+	PositionZ.RemoveAtSwap(Index, 1, false);
+	DirectionX.RemoveAtSwap(Index, 1, false);
+	DirectionY.RemoveAtSwap(Index, 1, false);
+	DirectionZ.RemoveAtSwap(Index, 1, false);
+	Speed.RemoveAtSwap(Index, 1, false);
+	RemainingLifeTime.RemoveAtSwap(Index, 1, false);
+}
+
+void FLylatDragoonProjectileBuffer::Reset()
+{
+	PositionX.Reset();
+	PositionY.Reset();
+	PositionZ.Reset();
+	DirectionX.Reset();
+	DirectionY.Reset();
+	DirectionZ.Reset();
+	Speed.Reset();
+	RemainingLifeTime.Reset();
+}
+
+void FLylatDragoonProjectileBuffer::ApplyWorldOffset(const FVector& Offset)
+{
+	for (int32 Index = 0; Index < Num(); ++Index)
+	{
+		PositionX[Index] += Offset.X;
+		PositionY[Index] += Offset.Y;
+		PositionZ[Index] += Offset.Z;
+	}
+}
+
+void FLylatDragoonProjectileBuffer::Integrate(float DeltaTime)
+{
+	const int32 Count = Num();
+	const int32 VectorCount = Count & ~3;
+
+	float* RESTRICT PosX = PositionX.GetData();
+	float* RESTRICT PosY = PositionY.GetData();
+	float* RESTRICT PosZ = PositionZ.GetData();
+	const float* RESTRICT DirX = DirectionX.GetData();
+	const float* RESTRICT DirY = DirectionY.GetData();
+	const float* RESTRICT DirZ = DirectionZ.GetData();
+	const float* RESTRICT Spd = Speed.GetData();
+	float* RESTRICT Life = RemainingLifeTime.GetData();
+
+	const VectorRegister Delta = VectorSetFloat1(DeltaTime);
+
+	// Four projectiles per iteration
+	for (int32 Index = 0; Index < VectorCount; Index += 4)
+	{
+		const VectorRegister Step = VectorMultiply(VectorLoad(Spd + Index), Delta);
+
+		VectorStore(VectorMultiplyAdd(VectorLoad(DirX + Index), Step, VectorLoad(PosX + Index)), PosX + Index);
+		VectorStore(VectorMultiplyAdd(VectorLoad(DirY + Index), Step, VectorLoad(PosY + Index)), PosY + Index);
+		VectorStore(VectorMultiplyAdd(VectorLoad(DirZ + Index), Step, VectorLoad(PosZ + Index)), PosZ + Index);
+		VectorStore(VectorSubtract(VectorLoad(Life + Index), Delta), Life + Index);
+	}
+
+	// Remaining projectiles
+	for (int32 Index = VectorCount; Index < Count; ++Index)
+	{
+		const float Step = Spd[Index] * DeltaTime;
+
+		PosX[Index] += DirX[Index] * Step;
+		PosY[Index] += DirY[Index] * Step;
+		PosZ[Index] += DirZ[Index] * Step;
+		Life[Index] -= DeltaTime;
+	}
+}
@@ -0,0 +1,47 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ * Simulation state of every projectile in flight, stored as structure of arrays
+ * so the whole buffer can be integrated four projectiles at a time.
+ */
+struct LYLATDRAGOON_API FLylatDragoonProjectileBuffer
+{
+	TArray<float> PositionX;
+	TArray<float> PositionY;
+	TArray<float> PositionZ;
+
+	/** Unit direction, set when the projectile is fired and only changed by homing */
+	TArray<float> DirectionX;
+	TArray<float> DirectionY;
+	TArray<float> DirectionZ;
+
+	TArray<float> Speed;
+
+	TArray<float> RemainingLifeTime;
+
+	FORCEINLINE int32 Num() const { return Speed.Num(); }
+
+	FORCEINLINE FVector GetPosition(int32 Index) const { return FVector(PositionX[Index], PositionY[Index], PositionZ[Index]); }
+
+	FORCEINLINE FVector GetDirection(int32 Index) const { return FVector(DirectionX[Index], DirectionY[Index], DirectionZ[Index]); }
+
+	/** Make room for the given number of projectiles without further allocations */
+	void Reserve(int32 Number);
+
+	/** Add a projectile and return its index */
+	int32 Add(const FVector& Location, const FVector& Direction, float InSpeed, float LifeTime);
+
+	/** Remove a projectile moving the last one into its index */
+	void RemoveAtSwap(int32 Index);
+
+	/** Remove every projectile keeping the memory */
+	void Reset();
+
+	/** Move every projectile, when the world origin is rebased */
+	void ApplyWorldOffset(const FVector& Offset);
+
+	/** Move every projectile along its direction and consume its life time */
+	void Integrate(float DeltaTime);
+};
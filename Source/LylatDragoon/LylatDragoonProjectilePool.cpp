@@ -0,0 +1,357 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonProjectilePool.h"
+
+#include "LylatDragoonArena.h"
+#include "LylatDragoonDamageQueue.h"
+#include "LylatDragoonEnemy.h"
+#include "LylatDragoonGameMode.h"
+#include "LylatDragoonLevelCourse.h"
+#include "LylatDragoonProjectile.h"
+#include "LylatDragoonSoakRecorder.h"
+#include "LylatDragoonTelemetry.h"
+
+#include "EngineUtils.h"
+#include "Engine/Engine.h"
+
+static TAutoConsoleVariable<int32> CVarShowProjectileHits(
+	TEXT("LylatDragoon.ShowProjectileHits"),
+	0,
+	TEXT("Show on screen the number of projectile-enemy pairs tested every frame."));
+
+ULylatDragoonProjectilePool::ULylatDragoonProjectilePool(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+
+	PrewarmCount = 64;
+	MaxCourseDistance = 20000.0f;
+	BroadPhaseCellSize = 1000.0f;
+
+	CandidatePairCount = 0;
+	HashedEnemyCount = 0;
+}
+
+void ULylatDragoonProjectilePool::BeginPlay()
+{
+	Super::BeginPlay();
+
+	for (TActorIterator<ALylatDragoonLevelCourse> LCItr(GetWorld()); LCItr; ++LCItr)
+	{
+		LevelCourse = *LCItr;
+		break;
+	}
+}
+
+void ULylatDragoonProjectilePool::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	ReportHighWaterMarks();
+
+	Pools.Empty();
+	Simulation.Reset();
+	SimulatedProjectiles.Empty();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void ULylatDragoonProjectilePool::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	{
+		LYLATDRAGOON_SCOPE_CYCLE_COUNTER(ProjectileIntegration);
+
+		SteerHomingProjectiles(DeltaTime);
+
+		Simulation.Integrate(DeltaTime);
+	}
+
+	CheckHits(DeltaTime);
+
+	UpdateVisuals();
+
+	LYLATDRAGOON_SET_COUNTER(ProjectilesInFlight, Simulation.Num());
+	LYLATDRAGOON_SET_COUNTER(CandidatePairs, CandidatePairCount);
+
+	if (CVarShowProjectileHits.GetValueOnGameThread() != 0 && GEngine)
+	{
+		GEngine->AddOnScreenDebugMessage((uint64)GetUniqueID(), 0.0f, FColor::Yellow, FString::Printf(TEXT("Projectiles: %d, enemies: %d, candidate pairs: %d"), Simulation.Num(), HashedEnemyCount, CandidatePairCount));
+	}
+}
+
+void ULylatDragoonProjectilePool::ApplyWorldOffset(const FVector& InOffset, bool bWorldShift)
+{
+	Super::ApplyWorldOffset(InOffset, bWorldShift);
+
+	// The actors are moved by the engine, the simulated positions are not
+	Simulation.ApplyWorldOffset(InOffset);
+}
+
+void ULylatDragoonProjectilePool::SteerHomingProjectiles(float DeltaTime)
+{
+	for (int32 Index = 0; Index < Simulation.Num(); ++Index)
+	{
+		ALylatDragoonProjectile* SimulatedProjectile = SimulatedProjectiles[Index];
+		AActor* Target = SimulatedProjectile->HomingTarget.Get();
+		if (!Target)
+		{
+			continue;
+		}
+
+		const FVector Direction = Simulation.GetDirection(Index);
+		const FVector DesiredDirection = (Target->GetActorLocation() - Simulation.GetPosition(Index)).GetSafeNormal();
+		if (DesiredDirection.IsZero())
+		{
+			continue;
+		}
+
+		// Rotate towards the target on the plane of both directions, limited by the turn rate
+		const float Angle = FMath::Acos(FMath::Clamp(FVector::DotProduct(Direction, DesiredDirection), -1.0f, 1.0f));
+		const float MaxAngle = FMath::DegreesToRadians(SimulatedProjectile->HomingTurnRate) * DeltaTime;
+		FVector NewDirection = DesiredDirection;
+		if (Angle > MaxAngle)
+		{
+			// Flying straight away from the target there is no plane to turn on, keep going this frame
+			if (Angle > PI - KINDA_SMALL_NUMBER)
+			{
+				continue;
+			}
+
+			const float InvSinAngle = 1.0f / FMath::Sin(Angle);
+			NewDirection = (Direction * FMath::Sin(Angle - MaxAngle) + DesiredDirection * FMath::Sin(MaxAngle)) * InvSinAngle;
+			NewDirection.Normalize();
+		}
+
+		Simulation.DirectionX[Index] = NewDirection.X;
+		Simulation.DirectionY[Index] = NewDirection.Y;
+		Simulation.DirectionZ[Index] = NewDirection.Z;
+	}
+}
+
+void ULylatDragoonProjectilePool::CheckHits(float DeltaTime)
+{
+	LYLATDRAGOON_SCOPE_CYCLE_COUNTER(ProjectileHits);
+
+	CandidatePairCount = 0;
+	HashedEnemyCount = 0;
+
+	if (Simulation.Num() == 0)
+	{
+		return;
+	}
+
+	// The enemies hashed only live in this scope. The clients don't have the enemies of the game mode, they go through
+	// the replicated ones
+	FLylatDragoonArena& FrameArena = FLylatDragoonArena::GetFrameArena();
+	FLylatDragoonArenaScope ArenaScope(FrameArena);
+	TLylatDragoonArenaArray<ALylatDragoonEnemy*> HashedEnemies(FrameArena);
+	ALylatDragoonGameMode* GameMode = Cast<ALylatDragoonGameMode>(GetOwner());
+	if (GameMode)
+	{
+		HashedEnemies.Append(GameMode->GetEnemies().GetData(), GameMode->GetEnemies().Num());
+	}
+	else
+	{
+		for (TActorIterator<ALylatDragoonEnemy> It(GetWorld()); It; ++It)
+		{
+			HashedEnemies.Add(*It);
+		}
+	}
+	HashedEnemyCount = HashedEnemies.Num();
+
+	// The spheres are written straight into the hash
+	EnemyHash.ResetSpheres(HashedEnemies.Num());
+	for (ALylatDragoonEnemy* Enemy : HashedEnemies)
+	{
+		EnemyHash.AddSphere(Enemy->GetActorLocation(), Enemy->HitRadius);
+	}
+
+	float MaxHitRadius = 0.0f;
+	for (ALylatDragoonProjectile* SimulatedProjectile : SimulatedProjectiles)
+	{
+		MaxHitRadius = FMath::Max(MaxHitRadius, SimulatedProjectile->HitRadius);
+	}
+
+	EnemyHash.Build(BroadPhaseCellSize, MaxHitRadius);
+
+	// Iterate backwards so releasing doesn't skip any projectile
+	for (int32 Index = Simulation.Num() - 1; Index >= 0; --Index)
+	{
+		ALylatDragoonProjectile* SimulatedProjectile = SimulatedProjectiles[Index];
+
+		// The whole movement of this frame is tested so fast projectiles can't go through the enemies
+		const FVector End = Simulation.GetPosition(Index);
+		const FVector Start = End - Simulation.GetDirection(Index) * (Simulation.Speed[Index] * DeltaTime);
+
+		const int32 HitIndex = EnemyHash.SweepSphere(Start, End, SimulatedProjectile->HitRadius, CandidatePairCount);
+		if (HitIndex != INDEX_NONE)
+		{
+			ALylatDragoonEnemy* Enemy = HashedEnemies[HitIndex];
+
+			// The enemy could have been destroyed earlier this frame
+			if (!Enemy->IsPendingKill())
+			{
+				// The projectile goes back to the pool right away and can fly again before the queue resolves, the pawn which
+				// fired it is the causer
+				if (GameMode)
+				{
+					AController* InstigatorController = SimulatedProjectile->Instigator ? SimulatedProjectile->Instigator->GetController() : nullptr;
+					GameMode->GetDamageQueue()->QueueDamage(Enemy, SimulatedProjectile->Instigator, InstigatorController, SimulatedProjectile->Damage, ELylatDragoonDamageKind::Projectile);
+					FLylatDragoonTelemetry::Get().Record(ELylatDragoonTelemetryEvent::Hit, FLylatDragoonTelemetry::GetPlayerId(SimulatedProjectile->Instigator), SimulatedProjectile->Damage);
+				}
+
+				ReleaseProjectile(SimulatedProjectile);
+			}
+		}
+	}
+}
+
+void ULylatDragoonProjectilePool::UpdateVisuals()
+{
+	LYLATDRAGOON_SCOPE_CYCLE_COUNTER(ProjectileVisuals);
+
+	const float MaxCourseDistanceSquared = FMath::Square(MaxCourseDistance);
+	const FVector CourseLocation = LevelCourse ? LevelCourse->GetActorLocation() : FVector::ZeroVector;
+
+	// Iterate backwards so releasing doesn't skip any projectile
+	for (int32 Index = Simulation.Num() - 1; Index >= 0; --Index)
+	{
+		const FVector Location = Simulation.GetPosition(Index);
+
+		bool bExpired = Simulation.RemainingLifeTime[Index] <= 0.0f;
+		bool bOutOfBounds = LevelCourse && FVector::DistSquared(Location, CourseLocation) > MaxCourseDistanceSquared;
+		if (bExpired || bOutOfBounds)
+		{
+			ReleaseProjectile(SimulatedProjectiles[Index]);
+		}
+		else if (SimulatedProjectiles[Index]->HomingTarget.IsValid())
+		{
+			// Homing projectiles change direction, face where they fly
+			SimulatedProjectiles[Index]->SetActorLocationAndRotation(Location, Simulation.GetDirection(Index).Rotation(), false, nullptr, ETeleportType::TeleportPhysics);
+		}
+		else
+		{
+			SimulatedProjectiles[Index]->SetActorLocation(Location, false, nullptr, ETeleportType::TeleportPhysics);
+		}
+	}
+}
+
+void ULylatDragoonProjectilePool::Prewarm(TSubclassOf<ALylatDragoonProjectile> ProjectileClass)
+{
+	if (!ProjectileClass)
+	{
+		return;
+	}
+
+	// The soak test fires several shots at once
+	const int32 ScaledPrewarmCount = PrewarmCount * FLylatDragoonSoakSettings::Get().ProjectileScale;
+
+	FLylatDragoonProjectilePoolEntry& Pool = Pools.FindOrAdd(ProjectileClass);
+	Pool.Free.Reserve(ScaledPrewarmCount);
+	Pool.Active.Reserve(ScaledPrewarmCount);
+
+	const int32 SimulationCapacity = Simulation.Num() + ScaledPrewarmCount;
+	Simulation.Reserve(SimulationCapacity);
+	SimulatedProjectiles.Reserve(SimulationCapacity);
+
+	for (int32 Count = Pool.Free.Num() + Pool.Active.Num(); Count < ScaledPrewarmCount; ++Count)
+	{
+		ALylatDragoonProjectile* PooledProjectile = SpawnPooledProjectile(ProjectileClass);
+		if (PooledProjectile)
+		{
+			Pool.Free.Add(PooledProjectile);
+		}
+	}
+}
+
+ALylatDragoonProjectile* ULylatDragoonProjectilePool::AcquireProjectile(TSubclassOf<ALylatDragoonProjectile> ProjectileClass, const FTransform& SpawnTM, AActor* ProjectileOwner, APawn* ProjectileInstigator)
+{
+	if (!ProjectileClass)
+	{
+		return nullptr;
+	}
+
+	FLylatDragoonProjectilePoolEntry* Pool = Pools.Find(ProjectileClass);
+	if (!Pool)
+	{
+		UE_LOG(LogFlying, Warning, TEXT("Projectile pool for %s was not prewarmed, spawning on demand"), *ProjectileClass->GetName());
+		Prewarm(ProjectileClass);
+		Pool = Pools.Find(ProjectileClass);
+	}
+
+	ALylatDragoonProjectile* PooledProjectile = nullptr;
+	if (Pool->Free.Num() > 0)
+	{
+		PooledProjectile = Pool->Free.Pop(false);
+	}
+	else if (Pool->Active.Num() > 0)
+	{
+		// The pool is exhausted, recycle the oldest shot instead of spawning a new actor
+		PooledProjectile = Pool->Active[0];
+		ReleaseProjectile(PooledProjectile);
+		Pool->Free.Pop(false);
+		Pool->StolenCount++;
+	}
+	else
+	{
+		return nullptr;
+	}
+
+	Pool->Active.Add(PooledProjectile);
+	Pool->HighWaterMark = FMath::Max(Pool->HighWaterMark, Pool->Active.Num());
+
+	PooledProjectile->ActivateFromPool(SpawnTM, ProjectileOwner, ProjectileInstigator);
+	PooledProjectile->SimulationIndex = Simulation.Add(SpawnTM.GetLocation(), SpawnTM.GetRotation().GetForwardVector(), PooledProjectile->ProjectileSpeed, PooledProjectile->LifeTime);
+	SimulatedProjectiles.Add(PooledProjectile);
+
+	return PooledProjectile;
+}
+
+void ULylatDragoonProjectilePool::ReleaseProjectile(ALylatDragoonProjectile* PooledProjectile)
+{
+	FLylatDragoonProjectilePoolEntry* Pool = PooledProjectile ? Pools.Find(PooledProjectile->GetClass()) : nullptr;
+	if (Pool && Pool->Active.RemoveSingle(PooledProjectile) > 0)
+	{
+		// Keep the simulation packed moving the last projectile into the released slot
+		const int32 Index = PooledProjectile->SimulationIndex;
+		Simulation.RemoveAtSwap(Index);
+		SimulatedProjectiles.RemoveAtSwap(Index, 1, false);
+		if (SimulatedProjectiles.IsValidIndex(Index))
+		{
+			SimulatedProjectiles[Index]->SimulationIndex = Index;
+		}
+
+		PooledProjectile->DeactivateToPool();
+		Pool->Free.Add(PooledProjectile);
+	}
+}
+
+int32 ULylatDragoonProjectilePool::GetHighWaterMark(TSubclassOf<ALylatDragoonProjectile> ProjectileClass) const
+{
+	const FLylatDragoonProjectilePoolEntry* Pool = Pools.Find(ProjectileClass);
+	return Pool ? Pool->HighWaterMark : 0;
+}
+
+ALylatDragoonProjectile* ULylatDragoonProjectilePool::SpawnPooledProjectile(UClass* ProjectileClass)
+{
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	ALylatDragoonProjectile* PooledProjectile = GetWorld()->SpawnActor<ALylatDragoonProjectile>(ProjectileClass, FTransform::Identity, SpawnParams);
+	if (PooledProjectile)
+	{
+		PooledProjectile->DeactivateToPool();
+	}
+
+	return PooledProjectile;
+}
+
+void ULylatDragoonProjectilePool::ReportHighWaterMarks() const
+{
+	for (const TPair<UClass*, FLylatDragoonProjectilePoolEntry>& Pool : Pools)
+	{
+		UE_LOG(LogFlying, Log, TEXT("Projectile pool %s: %d instances, high-water mark %d, %d shots recycled in flight"),
+			*GetNameSafe(Pool.Key), Pool.Value.Free.Num() + Pool.Value.Active.Num(), Pool.Value.HighWaterMark, Pool.Value.StolenCount);
+	}
+}
@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Components/ActorComponent.h"
+#include "LylatDragoonProjectileBuffer.h"
+#include "LylatDragoonSpatialHash.h"
+#include "LylatDragoonProjectilePool.generated.h"
+
+/** Pooled instances of a single projectile class */
+USTRUCT()
+struct FLylatDragoonProjectilePoolEntry
+{
+	GENERATED_BODY()
+
+	/** Projectiles ready to be fired */
+	UPROPERTY()
+	TArray<class ALylatDragoonProjectile*> Free;
+
+	/** Projectiles in flight, ordered from the oldest to the newest shot */
+	UPROPERTY()
+	TArray<class ALylatDragoonProjectile*> Active;
+
+	/** Maximum number of projectiles of this class that were in flight at the same time */
+	int32 HighWaterMark;
+
+	/** Number of times we had to recycle a projectile in flight because the pool was exhausted */
+	int32 StolenCount;
+
+	FLylatDragoonProjectilePoolEntry()
+		: HighWaterMark(0)
+		, StolenCount(0)
+	{
+	}
+};
+
+/**
+ * Keeps pre-spawned projectiles around so firing never spawns or destroys actors.
+ * The pool also simulates every projectile in flight: their state lives in a single buffer which is
+ * integrated in one pass, and the projectile actors are only visuals that get their location pushed afterwards.
+ * Hits against enemies are found sweeping every projectile through a spatial hash of the enemies, rebuilt every frame
+ * from a list of the enemies in the frame arena.
+ * Projectiles are recycled when they hit, when their life time expires or when they leave the course bounds.
+ * Only the pool of the game mode damages the enemies hit. The pool of a player controller draws the shots on a client,
+ * stopping them on the replicated enemies.
+ */
+UCLASS(ClassGroup = Combat, meta = (BlueprintSpawnableComponent))
+class LYLATDRAGOON_API ULylatDragoonProjectilePool : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	ULylatDragoonProjectilePool(const FObjectInitializer& ObjectInitializer);
+
+	// Begin UActorComponent overrides
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual void ApplyWorldOffset(const FVector& InOffset, bool bWorldShift) override;
+	// End UActorComponent overrides
+
+	/** Number of projectiles spawned up front for every projectile class */
+	UPROPERTY(Category = Pool, EditAnywhere)
+	int32 PrewarmCount;
+
+	/** Projectiles further than this distance from the level course are recycled */
+	UPROPERTY(Category = Pool, EditAnywhere)
+	float MaxCourseDistance;
+
+	/** Size of the cells of the spatial hash used to find the enemies hit. Should be bigger than most enemies */
+	UPROPERTY(Category = Combat, EditAnywhere)
+	float BroadPhaseCellSize;
+
+	/** Spawn the projectiles of the given class so they are ready before the first shot */
+	void Prewarm(TSubclassOf<class ALylatDragoonProjectile> ProjectileClass);
+
+	/** Take a projectile out of the pool and fire it with the given transform. Never spawns if the class was prewarmed */
+	class ALylatDragoonProjectile* AcquireProjectile(TSubclassOf<class ALylatDragoonProjectile> ProjectileClass, const FTransform& SpawnTM, AActor* ProjectileOwner, APawn* ProjectileInstigator);
+
+	/** Return a projectile in flight to the pool */
+	void ReleaseProjectile(class ALylatDragoonProjectile* PooledProjectile);
+
+	/** Return the maximum number of projectiles of the given class in flight at the same time */
+	int32 GetHighWaterMark(TSubclassOf<class ALylatDragoonProjectile> ProjectileClass) const;
+
+	/** Returns the number of projectiles in flight */
+	FORCEINLINE int32 GetActiveProjectileCount() const { return Simulation.Num(); }
+
+	/** Returns the number of projectile-enemy pairs tested in the last frame */
+	FORCEINLINE int32 GetCandidatePairCount() const { return CandidatePairCount; }
+
+private:
+
+	/** Turn the projectiles with a homing target towards it */
+	void SteerHomingProjectiles(float DeltaTime);
+
+	/** Sweep the last movement of every projectile against the enemies and damage the ones hit */
+	void CheckHits(float DeltaTime);
+
+	/** Move the visuals to the simulated locations and recycle the projectiles which are done */
+	void UpdateVisuals();
+
+	/** Spawn a new projectile for the pool, hidden and inactive */
+	class ALylatDragoonProjectile* SpawnPooledProjectile(UClass* ProjectileClass);
+
+	/** Log the usage of every pool */
+	void ReportHighWaterMarks() const;
+
+	/** Pooled projectiles by class */
+	UPROPERTY(Transient)
+	TMap<UClass*, FLylatDragoonProjectilePoolEntry> Pools;
+
+	/** Simulation state of the projectiles in flight */
+	FLylatDragoonProjectileBuffer Simulation;
+
+	/** Projectile actor of every simulated projectile, with the same index */
+	UPROPERTY(Transient)
+	TArray<class ALylatDragoonProjectile*> SimulatedProjectiles;
+
+	/** Broad phase with the enemies alive this frame */
+	FLylatDragoonSpatialHash EnemyHash;
+
+	/** Number of enemies stored in the spatial hash in the last frame */
+	int32 HashedEnemyCount;
+
+	/** Number of projectile-enemy pairs tested in the last frame */
+	int32 CandidatePairCount;
+
+	/** Used to check if the projectiles are out of bounds */
+	class ALylatDragoonLevelCourse* LevelCourse;
+};
@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonReplicatedFlight.h"
+
+#include "Engine/NetSerialization.h"
+
+namespace LylatDragoonReplicatedFlight
+{
+	/** Steps per unit of the quantized offset */
+	const float OffsetScale = 8.0f;
+
+	/** Steps per second of the quantized course time */
+	const float CourseTimeScale = 1000.0f;
+
+	/** Steps per unit of the quantized play rate, which goes from 0 to 4 */
+	const float PlayRateScale = 64.0f;
+}
+
+FLylatDragoonReplicatedFlight::FLylatDragoonReplicatedFlight()
+	: CourseTime(0.0f)
+	, Offset(FVector2D::ZeroVector)
+	, Rotation(FRotator::ZeroRotator)
+	, PlayRate(1.0f)
+{
+}
+
+FLylatDragoonReplicatedFlight FLylatDragoonReplicatedFlight::FromWorld(float InCourseTime, const FVector& CourseLocation, const FRotator& CourseRotation, const FVector& Location, const FRotator& InRotation, float InPlayRate)
+{
+	// The flight model keeps the pawn at CourseLocation - PositionOffset, in the plane across the course
+	const FRotationMatrix CourseAxes(CourseRotation);
+	const FVector PositionOffset = CourseLocation - Location;
+
+	FLylatDragoonReplicatedFlight Flight;
+	Flight.CourseTime = InCourseTime;
+	Flight.Offset = FVector2D(PositionOffset | CourseAxes.GetScaledAxis(EAxis::Y), PositionOffset | CourseAxes.GetScaledAxis(EAxis::Z));
+	Flight.Rotation = InRotation;
+	Flight.PlayRate = InPlayRate;
+	return Flight;
+}
+
+FVector FLylatDragoonReplicatedFlight::GetWorldLocation(const FVector& CourseLocation, const FRotator& CourseRotation, const FVector2D& InOffset)
+{
+	const FRotationMatrix CourseAxes(CourseRotation);
+	return CourseLocation - CourseAxes.GetScaledAxis(EAxis::Y) * InOffset.X - CourseAxes.GetScaledAxis(EAxis::Z) * InOffset.Y;
+}
+
+bool FLylatDragoonReplicatedFlight::NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess)
+{
+	using namespace LylatDragoonReplicatedFlight;
+
+	uint32 QuantizedTime = Ar.IsSaving() ? (uint32)FMath::Max(FMath::RoundToInt(CourseTime * CourseTimeScale), 0) : 0;
+	Ar.SerializeIntPacked(QuantizedTime);
+
+	int16 QuantizedOffsetX = Ar.IsSaving() ? (int16)FMath::Clamp(FMath::RoundToInt(Offset.X * OffsetScale), (int32)MIN_int16, (int32)MAX_int16) : 0;
+	int16 QuantizedOffsetY = Ar.IsSaving() ? (int16)FMath::Clamp(FMath::RoundToInt(Offset.Y * OffsetScale), (int32)MIN_int16, (int32)MAX_int16) : 0;
+	Ar << QuantizedOffsetX;
+	Ar << QuantizedOffsetY;
+
+	uint8 QuantizedPlayRate = Ar.IsSaving() ? (uint8)FMath::Clamp(FMath::RoundToInt(PlayRate * PlayRateScale), 0, (int32)MAX_uint8) : 0;
+	Ar << QuantizedPlayRate;
+
+	Rotation.SerializeCompressedShort(Ar);
+
+	if (Ar.IsLoading())
+	{
+		CourseTime = QuantizedTime / CourseTimeScale;
+		Offset = FVector2D(QuantizedOffsetX / OffsetScale, QuantizedOffsetY / OffsetScale);
+		PlayRate = QuantizedPlayRate / PlayRateScale;
+	}
+
+	bOutSuccess = true;
+	return true;
+}
+
+int32 FLylatDragoonReplicatedFlight::GetSerializedBytes() const
+{
+	FNetBitWriter Writer(nullptr, 256);
+	bool bSuccess = false;
+	FLylatDragoonReplicatedFlight Copy = *this;
+	Copy.NetSerialize(Writer, nullptr, bSuccess);
+	return (int32)Writer.GetNumBytes();
+}
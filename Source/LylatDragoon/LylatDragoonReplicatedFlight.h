@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "LylatDragoonReplicatedFlight.generated.h"
+
+/**
+ * Flight of a pawn as sent over the network. The pawn is constrained to a plane across the level course, so instead
+ * of its world transform we send the time on the course, its offset in that plane and its rotation, and the receiver
+ * rebuilds the world pose from its own evaluation of the course. Everything is quantized when serialized:
+ * the course time to milliseconds, the offset to 1/8 unit (clamped to +-4096) and the rotation to 16 bits per axis.
+ */
+USTRUCT()
+struct LYLATDRAGOON_API FLylatDragoonReplicatedFlight
+{
+	GENERATED_BODY()
+
+	/** Playback position of the level sequence (in seconds) */
+	UPROPERTY()
+	float CourseTime;
+
+	/** Offset from the course along its right (X) and up (Y) axes */
+	UPROPERTY()
+	FVector2D Offset;
+
+	UPROPERTY()
+	FRotator Rotation;
+
+	/** Play rate of the level sequence, used to extrapolate the course time between updates */
+	UPROPERTY()
+	float PlayRate;
+
+	FLylatDragoonReplicatedFlight();
+
+	/** Build from the world pose of a pawn on the course frame at the given time */
+	static FLylatDragoonReplicatedFlight FromWorld(float InCourseTime, const FVector& CourseLocation, const FRotator& CourseRotation, const FVector& Location, const FRotator& InRotation, float InPlayRate);
+
+	/** Returns the world location of the given offset on the course frame */
+	static FVector GetWorldLocation(const FVector& CourseLocation, const FRotator& CourseRotation, const FVector2D& InOffset);
+
+	/** Quantized serialization */
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	/** Returns the size of the serialized flight */
+	int32 GetSerializedBytes() const;
+};
+
+template<>
+struct TStructOpsTypeTraits<FLylatDragoonReplicatedFlight> : public TStructOpsTypeTraitsBase2<FLylatDragoonReplicatedFlight>
+{
+	enum
+	{
+		WithNetSerializer = true,
+	};
+};
@@ -0,0 +1,191 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonSoakRecorder.h"
+
+#include "LylatDragoonGameMode.h"
+#include "LylatDragoonLevelCourse.h"
+#include "LylatDragoonProjectilePool.h"
+
+#include "LevelSequenceActor.h"
+#include "RenderCore.h"
+
+#include "EngineUtils.h"
+#include "Misc/FileHelper.h"
+
+FLylatDragoonSoakSettings::FLylatDragoonSoakSettings()
+	: bEnabled(false)
+	, EnemyScale(1.0f)
+	, ProjectileScale(1)
+	, MaxSeconds(900.0f)
+{
+	const TCHAR* CommandLine = FCommandLine::Get();
+
+	bEnabled = FParse::Param(CommandLine, TEXT("LylatSoak"));
+	FParse::Value(CommandLine, TEXT("LylatEnemyScale="), EnemyScale);
+	FParse::Value(CommandLine, TEXT("LylatProjectileScale="), ProjectileScale);
+	FParse::Value(CommandLine, TEXT("LylatSoakSeconds="), MaxSeconds);
+	FParse::Value(CommandLine, TEXT("LylatSoakCsv="), CsvPath);
+
+	EnemyScale = FMath::Max(EnemyScale, 0.0f);
+	ProjectileScale = FMath::Max(ProjectileScale, 1);
+}
+
+const FLylatDragoonSoakSettings& FLylatDragoonSoakSettings::Get()
+{
+	static const FLylatDragoonSoakSettings Settings;
+	return Settings;
+}
+
+ULylatDragoonSoakRecorder::ULylatDragoonSoakRecorder(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	// Record the frame once everything else was updated
+	PrimaryComponentTick.TickGroup = TG_PostUpdateWork;
+
+	LevelCourse = nullptr;
+	ElapsedTime = 0.0f;
+	FurthestPlaybackPosition = 0.0f;
+	Finished = false;
+}
+
+void ULylatDragoonSoakRecorder::BeginPlay()
+{
+	Super::BeginPlay();
+
+	for (TActorIterator<ALylatDragoonLevelCourse> LCItr(GetWorld()); LCItr; ++LCItr)
+	{
+		LevelCourse = *LCItr;
+		break;
+	}
+
+	// Enough room for the whole level at 60 fps
+	Frames.Reserve(FMath::CeilToInt(FMath::Min(FLylatDragoonSoakSettings::Get().MaxSeconds, 600.0f) * 60.0f));
+
+	UE_LOG(LogFlying, Log, TEXT("Soak test started (enemy scale %.2f, projectile scale %d)"), FLylatDragoonSoakSettings::Get().EnemyScale, FLylatDragoonSoakSettings::Get().ProjectileScale);
+}
+
+void ULylatDragoonSoakRecorder::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (Finished)
+	{
+		return;
+	}
+
+	ALylatDragoonGameMode* GameMode = Cast<ALylatDragoonGameMode>(GetOwner());
+
+	FFrameSample& Frame = Frames[Frames.AddUninitialized()];
+	Frame.DeltaMs = DeltaTime * 1000.0f;
+	// Game thread time of the previous frame, the current one is still running
+	Frame.GameThreadMs = FPlatformTime::ToMilliseconds(GGameThreadTime);
+	Frame.PlaybackPosition = 0.0f;
+	Frame.EnemyCount = GameMode ? GameMode->GetEnemies().Num() : 0;
+	Frame.ProjectileCount = GameMode ? GameMode->GetProjectilePool()->GetActiveProjectileCount() : 0;
+
+	if (LevelCourse && LevelCourse->SequenceController && LevelCourse->SequenceController->SequencePlayer)
+	{
+		Frame.PlaybackPosition = LevelCourse->SequenceController->SequencePlayer->GetPlaybackPosition();
+		FurthestPlaybackPosition = FMath::Max(FurthestPlaybackPosition, Frame.PlaybackPosition);
+	}
+
+	ElapsedTime += DeltaTime;
+
+	if (HasSequenceEnded() || ElapsedTime >= FLylatDragoonSoakSettings::Get().MaxSeconds)
+	{
+		FinishSoak();
+	}
+}
+
+void ULylatDragoonSoakRecorder::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Keep what was recorded if the run was closed before the end of the sequence
+	if (!Finished && Frames.Num() > 0)
+	{
+		UE_LOG(LogFlying, Warning, TEXT("Soak test interrupted after %.1f seconds"), ElapsedTime);
+		FinishSoak();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+bool ULylatDragoonSoakRecorder::HasSequenceEnded() const
+{
+	if (!LevelCourse || !LevelCourse->SequenceController || !LevelCourse->SequenceController->SequencePlayer)
+	{
+		return false;
+	}
+
+	ULevelSequencePlayer* SequencePlayer = LevelCourse->SequenceController->SequencePlayer;
+	const float Length = SequencePlayer->GetLength();
+
+	// Half a frame of tolerance, the playback stops at the last frame
+	return Length > 0.0f && FurthestPlaybackPosition >= Length - FMath::Max(GetWorld()->GetDeltaSeconds(), KINDA_SMALL_NUMBER);
+}
+
+void ULylatDragoonSoakRecorder::FinishSoak()
+{
+	Finished = true;
+
+	FString BasePath = FLylatDragoonSoakSettings::Get().CsvPath;
+	if (BasePath.IsEmpty())
+	{
+		BasePath = FPaths::ProjectSavedDir() / TEXT("Profiling") / FString::Printf(TEXT("LylatSoak-%s"), *FDateTime::Now().ToString());
+	}
+
+	// Per frame
+	FString FramesCsv = TEXT("Frame,DeltaMs,GameThreadMs,PlaybackPosition,Enemies,Projectiles\n");
+	for (int32 FrameIndex = 0; FrameIndex < Frames.Num(); ++FrameIndex)
+	{
+		const FFrameSample& Frame = Frames[FrameIndex];
+		FramesCsv += FString::Printf(TEXT("%d,%.3f,%.3f,%.3f,%d,%d\n"), FrameIndex, Frame.DeltaMs, Frame.GameThreadMs, Frame.PlaybackPosition, Frame.EnemyCount, Frame.ProjectileCount);
+	}
+
+	// Percentiles, the first frames are skipped because they include the level load
+	const int32 WarmupFrames = FMath::Min(Frames.Num() / 10, 30);
+	TArray<float> DeltaMs;
+	TArray<float> GameThreadMs;
+	DeltaMs.Reserve(Frames.Num());
+	GameThreadMs.Reserve(Frames.Num());
+	for (int32 FrameIndex = WarmupFrames; FrameIndex < Frames.Num(); ++FrameIndex)
+	{
+		DeltaMs.Add(Frames[FrameIndex].DeltaMs);
+		GameThreadMs.Add(Frames[FrameIndex].GameThreadMs);
+	}
+
+	auto Summarize = [](const TCHAR* Name, TArray<float>& Values) -> FString
+	{
+		if (Values.Num() == 0)
+		{
+			return FString::Printf(TEXT("%s,0,0,0,0,0,0,0\n"), Name);
+		}
+
+		Values.Sort();
+
+		float Sum = 0.0f;
+		for (float Value : Values)
+		{
+			Sum += Value;
+		}
+
+		auto Percentile = [&Values](float Fraction) { return Values[FMath::Clamp(FMath::CeilToInt(Fraction * Values.Num()) - 1, 0, Values.Num() - 1)]; };
+
+		return FString::Printf(TEXT("%s,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n"), Name, Values.Num(), Sum / Values.Num(), Percentile(0.5f), Percentile(0.9f), Percentile(0.95f), Percentile(0.99f), Values.Last());
+	};
+
+	FString SummaryCsv = TEXT("Stat,Frames,Mean,P50,P90,P95,P99,Max\n");
+	SummaryCsv += Summarize(TEXT("DeltaMs"), DeltaMs);
+	SummaryCsv += Summarize(TEXT("GameThreadMs"), GameThreadMs);
+
+	const FString FramesPath = BasePath + TEXT("-Frames.csv");
+	const FString SummaryPath = BasePath + TEXT("-Summary.csv");
+	FFileHelper::SaveStringToFile(FramesCsv, *FramesPath);
+	FFileHelper::SaveStringToFile(SummaryCsv, *SummaryPath);
+
+	UE_LOG(LogFlying, Log, TEXT("Soak test finished after %d frames, results written to %s"), Frames.Num(), *SummaryPath);
+	UE_LOG(LogFlying, Log, TEXT("%s"), *SummaryCsv);
+
+	FPlatformMisc::RequestExit(false);
+}
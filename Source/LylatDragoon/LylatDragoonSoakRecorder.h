@@ -0,0 +1,93 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Components/ActorComponent.h"
+#include "LylatDragoonSoakRecorder.generated.h"
+
+/**
+ * Settings of the soak test, read once from the command line:
+ *   -LylatSoak                   Enable the soak test (autopilot, frame recording, exit at the end of the sequence)
+ *   -LylatEnemyScale=<float>     Multiplier of the number of enemies of every wave
+ *   -LylatProjectileScale=<int>  Number of shots of every volley fired by the pawn, side by side
+ *   -LylatSoakSeconds=<float>    Stop the soak test after this time even if the sequence did not end
+ *   -LylatSoakCsv=<path>         Base file name of the CSV files, without extension
+ */
+struct FLylatDragoonSoakSettings
+{
+	/** Whether the game was launched for a soak test */
+	bool bEnabled;
+
+	/** Multiplier of the number of enemies of every wave */
+	float EnemyScale;
+
+	/** Number of shots of every volley fired by the pawn, side by side */
+	int32 ProjectileScale;
+
+	/** Maximum duration of the soak test (in seconds) */
+	float MaxSeconds;
+
+	/** Base file name of the CSV files, empty to use the Saved/Profiling folder */
+	FString CsvPath;
+
+	/** Returns the settings of this run */
+	static const FLylatDragoonSoakSettings& Get();
+
+private:
+
+	FLylatDragoonSoakSettings();
+};
+
+/**
+ * Records the time of every frame during a soak test, and writes it with its percentiles to CSV files when the
+ * level sequence ends. Added by the game mode when the game is launched with -LylatSoak.
+ */
+UCLASS()
+class LYLATDRAGOON_API ULylatDragoonSoakRecorder : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	ULylatDragoonSoakRecorder(const FObjectInitializer& ObjectInitializer);
+
+	// Begin UActorComponent overrides
+	virtual void BeginPlay() override;
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction *ThisTickFunction) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	// End UActorComponent overrides
+
+private:
+
+	/** One recorded frame */
+	struct FFrameSample
+	{
+		float DeltaMs;
+		float GameThreadMs;
+		float PlaybackPosition;
+		int32 EnemyCount;
+		int32 ProjectileCount;
+	};
+
+	/** Returns true when the level sequence played to its end */
+	bool HasSequenceEnded() const;
+
+	/** Write the frames and the summary to CSV and ask the engine to exit */
+	void FinishSoak();
+
+	/** Level course whose sequence drives the soak test */
+	UPROPERTY(Transient)
+	class ALylatDragoonLevelCourse* LevelCourse;
+
+	/** Frames recorded so far */
+	TArray<FFrameSample> Frames;
+
+	/** Time since the recording started (in seconds) */
+	float ElapsedTime;
+
+	/** Furthest playback position reached, the sequence goes back when the player dies */
+	float FurthestPlaybackPosition;
+
+	/** Indicates if the results were already written */
+	bool Finished;
+};
@@ -0,0 +1,188 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonSpatialHash.h"
+
+FLylatDragoonSpatialHash::FLylatDragoonSpatialHash()
+	: CellSize(1.0f)
+	, InvCellSize(1.0f)
+	, BucketMask(0)
+	, QueryStamp(0)
+{
+}
+
+void FLylatDragoonSpatialHash::Build(TArrayView<const FVector> Centers, TArrayView<const float> Radii, float InCellSize, float MaxQueryRadius)
+{
+	check(Centers.Num() == Radii.Num());
+
+	ResetSpheres(Centers.Num());
+	SphereCenters.Append(Centers.GetData(), Centers.Num());
+	SphereRadii.Append(Radii.GetData(), Radii.Num());
+
+	Build(InCellSize, MaxQueryRadius);
+}
+
+void FLylatDragoonSpatialHash::ResetSpheres(int32 Count)
+{
+	// Reset keeps the memory, assigning arrays of another size would reallocate them
+	SphereCenters.Reset(Count);
+	SphereRadii.Reset(Count);
+}
+
+void FLylatDragoonSpatialHash::Build(float InCellSize, float MaxQueryRadius)
+{
+	check(SphereCenters.Num() == SphereRadii.Num());
+	check(InCellSize > 0.0f);
+
+	CellSize = InCellSize;
+	InvCellSize = 1.0f / InCellSize;
+
+	SphereQueryStamp.Reset();
+	SphereQueryStamp.AddZeroed(SphereCenters.Num());
+	QueryStamp = 0;
+
+	// Twice as many buckets as spheres keeps the collisions between cells low
+	const uint32 BucketCount = FMath::RoundUpToPowerOfTwo(FMath::Max(SphereCenters.Num() * 2, 64));
+	BucketMask = BucketCount - 1;
+
+	BucketStart.Reset();
+	BucketStart.AddZeroed(BucketCount + 1);
+
+	// First pass counts the entries of every bucket, second pass places them (counting sort).
+	// Bucket counts and write cursors are kept one slot ahead, so after the second pass every
+	// slot holds the start of its bucket and the extra slot holds the total
+	for (int32 Pass = 0; Pass < 2; ++Pass)
+	{
+		if (Pass == 1)
+		{
+			int32 Total = 0;
+			for (uint32 Bucket = 0; Bucket < BucketCount; ++Bucket)
+			{
+				const int32 Count = BucketStart[Bucket + 1];
+				BucketStart[Bucket + 1] = Total;
+				Total += Count;
+			}
+
+			BucketEntries.SetNumUninitialized(Total, false);
+		}
+
+		for (int32 Index = 0; Index < SphereCenters.Num(); ++Index)
+		{
+			const FVector Extent(SphereRadii[Index] + MaxQueryRadius);
+			const FIntVector MinCell = GetCell(SphereCenters[Index] - Extent);
+			const FIntVector MaxCell = GetCell(SphereCenters[Index] + Extent);
+
+			for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+			{
+				for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+				{
+					for (int32 Z = MinCell.Z; Z <= MaxCell.Z; ++Z)
+					{
+						const uint32 Bucket = GetBucket(FIntVector(X, Y, Z));
+						if (Pass == 0)
+						{
+							BucketStart[Bucket + 1]++;
+						}
+						else
+						{
+							BucketEntries[BucketStart[Bucket + 1]++] = Index;
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+int32 FLylatDragoonSpatialHash::SweepSphere(const FVector& Start, const FVector& End, float Radius, int32& OutCandidates)
+{
+	int32 BestSphere = INDEX_NONE;
+	float BestDistanceSquared = MAX_FLT;
+
+	if (SphereCenters.Num() == 0)
+	{
+		return BestSphere;
+	}
+
+	++QueryStamp;
+	if (QueryStamp == 0)
+	{
+		// The stamp wrapped around, clear the old ones
+		FMemory::Memzero(SphereQueryStamp.GetData(), SphereQueryStamp.Num() * sizeof(uint32));
+		QueryStamp = 1;
+	}
+
+	// Walk the cells crossed by the segment (Amanatides & Woo)
+	FIntVector Cell = GetCell(Start);
+	const FIntVector EndCell = GetCell(End);
+	const FVector Delta = End - Start;
+
+	int32 Step[3];
+	float TMax[3];
+	float TDelta[3];
+	for (int32 Axis = 0; Axis < 3; ++Axis)
+	{
+		const float Direction = Delta[Axis];
+		if (Direction > KINDA_SMALL_NUMBER)
+		{
+			Step[Axis] = 1;
+			TDelta[Axis] = CellSize / Direction;
+			TMax[Axis] = ((Cell(Axis) + 1) * CellSize - Start[Axis]) / Direction;
+		}
+		else if (Direction < -KINDA_SMALL_NUMBER)
+		{
+			Step[Axis] = -1;
+			TDelta[Axis] = CellSize / -Direction;
+			TMax[Axis] = (Cell(Axis) * CellSize - Start[Axis]) / Direction;
+		}
+		else
+		{
+			Step[Axis] = 0;
+			TDelta[Axis] = MAX_FLT;
+			TMax[Axis] = MAX_FLT;
+		}
+	}
+
+	const int32 MaxSteps = FMath::Abs(EndCell.X - Cell.X) + FMath::Abs(EndCell.Y - Cell.Y) + FMath::Abs(EndCell.Z - Cell.Z);
+	for (int32 StepCount = 0; StepCount <= MaxSteps; ++StepCount)
+	{
+		TestBucket(GetBucket(Cell), Start, End, Radius, OutCandidates, BestSphere, BestDistanceSquared);
+
+		if (Cell == EndCell)
+		{
+			break;
+		}
+
+		const int32 Axis = TMax[0] < TMax[1] ? (TMax[0] < TMax[2] ? 0 : 2) : (TMax[1] < TMax[2] ? 1 : 2);
+		Cell(Axis) += Step[Axis];
+		TMax[Axis] += TDelta[Axis];
+	}
+
+	return BestSphere;
+}
+
+void FLylatDragoonSpatialHash::TestBucket(uint32 Bucket, const FVector& Start, const FVector& End, float Radius, int32& OutCandidates, int32& BestSphere, float& BestDistanceSquared)
+{
+	for (int32 Entry = BucketStart[Bucket]; Entry < BucketStart[Bucket + 1]; ++Entry)
+	{
+		const int32 Index = BucketEntries[Entry];
+		if (SphereQueryStamp[Index] == QueryStamp)
+		{
+			continue;
+		}
+		SphereQueryStamp[Index] = QueryStamp;
+		++OutCandidates;
+
+		// Narrow phase: closest point of the segment against the sphere inflated by the query radius
+		const FVector ClosestPoint = FMath::ClosestPointOnSegment(SphereCenters[Index], Start, End);
+		if (FVector::DistSquared(ClosestPoint, SphereCenters[Index]) <= FMath::Square(SphereRadii[Index] + Radius))
+		{
+			const float DistanceSquared = FVector::DistSquared(Start, ClosestPoint);
+			if (DistanceSquared < BestDistanceSquared)
+			{
+				BestDistanceSquared = DistanceSquared;
+				BestSphere = Index;
+			}
+		}
+	}
+}
@@ -0,0 +1,74 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Containers/ArrayView.h"
+
+/**
+ * Uniform grid hashed into a fixed number of buckets, rebuilt from scratch every frame.
+ * Every sphere is stored in all the cells its bounds touch, inflated by the radius of the queries,
+ * so a swept segment only needs to visit the cells it crosses to find every sphere it can hit.
+ */
+class LYLATDRAGOON_API FLylatDragoonSpatialHash
+{
+public:
+
+	FLylatDragoonSpatialHash();
+
+	/** Rebuild the hash with the given spheres. Centers and radii must have the same number of elements */
+	void Build(TArrayView<const FVector> Centers, TArrayView<const float> Radii, float InCellSize, float MaxQueryRadius);
+
+	/** Remove the spheres, keeping their memory, before adding the ones of the next build */
+	void ResetSpheres(int32 Count);
+
+	/** Add a sphere for the next build, so the spheres are written in place without a copy */
+	FORCEINLINE void AddSphere(const FVector& Center, float Radius)
+	{
+		SphereCenters.Add(Center);
+		SphereRadii.Add(Radius);
+	}
+
+	/** Rebuild the hash with the spheres added since the last reset */
+	void Build(float InCellSize, float MaxQueryRadius);
+
+	/**
+	 * Find the first sphere hit by a sphere of the given radius moving from Start to End.
+	 * Returns the index of the sphere or INDEX_NONE. OutCandidates is increased with the number of spheres tested.
+	 */
+	int32 SweepSphere(const FVector& Start, const FVector& End, float Radius, int32& OutCandidates);
+
+	FORCEINLINE int32 Num() const { return SphereCenters.Num(); }
+
+private:
+
+	FORCEINLINE FIntVector GetCell(const FVector& Location) const
+	{
+		return FIntVector(FMath::FloorToInt(Location.X * InvCellSize), FMath::FloorToInt(Location.Y * InvCellSize), FMath::FloorToInt(Location.Z * InvCellSize));
+	}
+
+	FORCEINLINE uint32 GetBucket(const FIntVector& Cell) const
+	{
+		// Large primes to spread neighbour cells across the buckets
+		return ((uint32)Cell.X * 73856093u ^ (uint32)Cell.Y * 19349663u ^ (uint32)Cell.Z * 83492791u) & BucketMask;
+	}
+
+	/** Test the spheres stored in a bucket against the segment, keeping the closest hit */
+	void TestBucket(uint32 Bucket, const FVector& Start, const FVector& End, float Radius, int32& OutCandidates, int32& BestSphere, float& BestDistanceSquared);
+
+	float CellSize;
+	float InvCellSize;
+	uint32 BucketMask;
+
+	/** First entry of every bucket in BucketEntries, with one extra element to mark the end of the last bucket */
+	TArray<int32> BucketStart;
+
+	/** Sphere indices sorted by bucket */
+	TArray<int32> BucketEntries;
+
+	TArray<FVector> SphereCenters;
+	TArray<float> SphereRadii;
+
+	/** Last query which tested every sphere, so a sphere stored in several cells is only tested once per query */
+	TArray<uint32> SphereQueryStamp;
+	uint32 QueryStamp;
+};
@@ -0,0 +1,173 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonSwarm.h"
+
+#include "LylatDragoonEnemy.h"
+
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Engine/Engine.h"
+#include "EngineUtils.h"
+
+static TAutoConsoleVariable<int32> CVarShowSwarm(
+	TEXT("LylatDragoon.ShowSwarm"),
+	0,
+	TEXT("Show on screen the number of enemies drawn as instances and the time spent updating them."));
+
+static void CountPrimitives(UWorld* World)
+{
+	if (!World)
+	{
+		return;
+	}
+
+	int32 ActorCount = 0;
+	int32 PrimitiveCount = 0;
+	int32 RenderedPrimitiveCount = 0;
+	int32 InstanceCount = 0;
+	for (TActorIterator<AActor> ActorItr(World); ActorItr; ++ActorItr)
+	{
+		ActorCount++;
+
+		TInlineComponentArray<UPrimitiveComponent*> Primitives(*ActorItr);
+		for (UPrimitiveComponent* Primitive : Primitives)
+		{
+			if (!Primitive->IsRegistered())
+			{
+				continue;
+			}
+
+			PrimitiveCount++;
+			// Only the primitives added to the scene have a proxy on the render thread
+			if (Primitive->IsRenderStateCreated() && Primitive->ShouldRender())
+			{
+				RenderedPrimitiveCount++;
+			}
+
+			if (UInstancedStaticMeshComponent* InstancedMesh = Cast<UInstancedStaticMeshComponent>(Primitive))
+			{
+				InstanceCount += InstancedMesh->GetInstanceCount();
+			}
+		}
+	}
+
+	UE_LOG(LogFlying, Log, TEXT("Actors: %d, primitive components: %d, rendered: %d, instances: %d"), ActorCount, PrimitiveCount, RenderedPrimitiveCount, InstanceCount);
+}
+
+static FAutoConsoleCommandWithWorld CountPrimitivesCommand(
+	TEXT("LylatDragoon.CountPrimitives"),
+	TEXT("Log the number of actors, primitive components, rendered primitives and mesh instances in the world."),
+	FConsoleCommandWithWorldDelegate::CreateStatic(&CountPrimitives));
+
+// Sets default values
+ALylatDragoonSwarm::ALylatDragoonSwarm()
+{
+ 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
+	PrimaryActorTick.bCanEverTick = true;
+	// Copy the transforms once the enemies were moved by their courses
+	PrimaryActorTick.TickGroup = TG_PostUpdateWork;
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("SceneComponent0"));
+
+	UpdateTimeMs = 0.0f;
+}
+
+// Called every frame
+void ALylatDragoonSwarm::Tick( float DeltaTime )
+{
+	LYLATDRAGOON_SCOPE_CYCLE_COUNTER(SwarmUpdate);
+
+	Super::Tick( DeltaTime );
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	for (TPair<UStaticMesh*, FLylatDragoonSwarmBatch>& Pair : Batches)
+	{
+		FLylatDragoonSwarmBatch& Batch = Pair.Value;
+		if (Batch.Enemies.Num() == 0)
+		{
+			continue;
+		}
+
+		// Update every instance without touching the render state, then send it once for the whole batch
+		for (int32 Index = 0; Index < Batch.Enemies.Num(); ++Index)
+		{
+			Batch.Instances->UpdateInstanceTransform(Index, Batch.Enemies[Index]->GetActorTransform(), true, false, true);
+		}
+		Batch.Instances->MarkRenderStateDirty();
+	}
+
+	UpdateTimeMs = (float)((FPlatformTime::Seconds() - StartTime) * 1000.0);
+
+	if (CVarShowSwarm.GetValueOnGameThread() != 0 && GEngine)
+	{
+		GEngine->AddOnScreenDebugMessage((uint64)GetUniqueID(), 0.0f, FColor::Yellow, FString::Printf(TEXT("Swarm batches: %d, instances: %d, update: %.3f ms"), Batches.Num(), GetInstanceCount(), UpdateTimeMs));
+	}
+}
+
+void ALylatDragoonSwarm::AddEnemy(ALylatDragoonEnemy* Enemy)
+{
+	UStaticMeshComponent* EnemyMesh = Enemy->GetPlaneMesh();
+	UStaticMesh* StaticMesh = EnemyMesh->GetStaticMesh();
+	if (!StaticMesh || Enemy->SwarmInstanceIndex != INDEX_NONE)
+	{
+		return;
+	}
+
+	FLylatDragoonSwarmBatch& Batch = Batches.FindOrAdd(StaticMesh);
+	if (!Batch.Instances)
+	{
+		Batch.Instances = NewObject<UInstancedStaticMeshComponent>(this);
+		Batch.Instances->SetStaticMesh(StaticMesh);
+		// The enemies keep their own collision
+		Batch.Instances->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		Batch.Instances->SetMobility(EComponentMobility::Movable);
+		for (int32 MaterialIndex = 0; MaterialIndex < EnemyMesh->GetNumMaterials(); ++MaterialIndex)
+		{
+			Batch.Instances->SetMaterial(MaterialIndex, EnemyMesh->GetMaterial(MaterialIndex));
+		}
+		Batch.Instances->SetupAttachment(RootComponent);
+		Batch.Instances->RegisterComponent();
+	}
+
+	Enemy->SwarmInstanceIndex = Batch.Instances->AddInstanceWorldSpace(Enemy->GetActorTransform());
+	Batch.Enemies.Add(Enemy);
+	check(Batch.Enemies.Num() == Batch.Instances->GetInstanceCount());
+}
+
+void ALylatDragoonSwarm::RemoveEnemy(ALylatDragoonEnemy* Enemy)
+{
+	if (Enemy->SwarmInstanceIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	FLylatDragoonSwarmBatch* Batch = Batches.Find(Enemy->GetPlaneMesh()->GetStaticMesh());
+	if (Batch && Batch->Enemies.IsValidIndex(Enemy->SwarmInstanceIndex) && Batch->Enemies[Enemy->SwarmInstanceIndex] == Enemy)
+	{
+		// Move the last enemy into the slot, removing the last instance doesn't shift the others
+		const int32 Index = Enemy->SwarmInstanceIndex;
+		const int32 LastIndex = Batch->Enemies.Num() - 1;
+		if (Index != LastIndex)
+		{
+			ALylatDragoonEnemy* MovedEnemy = Batch->Enemies[LastIndex];
+			Batch->Enemies[Index] = MovedEnemy;
+			MovedEnemy->SwarmInstanceIndex = Index;
+			Batch->Instances->UpdateInstanceTransform(Index, MovedEnemy->GetActorTransform(), true, false, true);
+		}
+		Batch->Enemies.RemoveAt(LastIndex, 1, false);
+		Batch->Instances->RemoveInstance(LastIndex);
+	}
+
+	Enemy->SwarmInstanceIndex = INDEX_NONE;
+}
+
+int32 ALylatDragoonSwarm::GetInstanceCount() const
+{
+	int32 InstanceCount = 0;
+	for (const TPair<UStaticMesh*, FLylatDragoonSwarmBatch>& Pair : Batches)
+	{
+		InstanceCount += Pair.Value.Enemies.Num();
+	}
+	return InstanceCount;
+}
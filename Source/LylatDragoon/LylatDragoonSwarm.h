@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "GameFramework/Actor.h"
+#include "LylatDragoonSwarm.generated.h"
+
+/** Enemies drawn with the same mesh */
+USTRUCT()
+struct FLylatDragoonSwarmBatch
+{
+	GENERATED_BODY()
+
+	/** Draws one instance per enemy */
+	UPROPERTY()
+	class UInstancedStaticMeshComponent* Instances;
+
+	/** Enemy of every instance, with the same index */
+	UPROPERTY()
+	TArray<class ALylatDragoonEnemy*> Enemies;
+
+	FLylatDragoonSwarmBatch()
+		: Instances(nullptr)
+	{
+	}
+};
+
+/**
+ * Draws the enemies that are not heroes. Enemies sharing a mesh become instances of one component instead of
+ * having a primitive each, and every frame their transforms are copied in bulk with a single render state update.
+ * Instances are plain instanced static meshes rather than hierarchical ones, since they move every frame and
+ * the cluster tree of a hierarchical component would have to be rebuilt all the time.
+ */
+UCLASS(notplaceable)
+class LYLATDRAGOON_API ALylatDragoonSwarm : public AActor
+{
+	GENERATED_BODY()
+	
+public:	
+	// Sets default values for this actor's properties
+	ALylatDragoonSwarm();
+
+	// Called every frame
+	virtual void Tick( float DeltaSeconds ) override;
+
+	/** Start drawing the enemy with an instance of its mesh */
+	void AddEnemy(class ALylatDragoonEnemy* Enemy);
+
+	/** Stop drawing the enemy */
+	void RemoveEnemy(class ALylatDragoonEnemy* Enemy);
+
+	/** Returns the number of enemies drawn as instances */
+	int32 GetInstanceCount() const;
+
+	/** Returns the time spent copying the transforms of the instances in the last frame (in milliseconds) */
+	FORCEINLINE float GetUpdateTimeMs() const { return UpdateTimeMs; }
+
+private:
+
+	/** Batches of the enemies by mesh */
+	UPROPERTY(Transient)
+	TMap<class UStaticMesh*, FLylatDragoonSwarmBatch> Batches;
+
+	/** Time spent copying the transforms of the instances in the last frame (in milliseconds) */
+	float UpdateTimeMs;
+};
@@ -0,0 +1,111 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonTargeting.h"
+
+#include "LylatDragoonEnemy.h"
+#include "LylatDragoonGameMode.h"
+
+#include "Engine/Engine.h"
+
+static TAutoConsoleVariable<int32> CVarShowTargeting(
+	TEXT("LylatDragoon.ShowTargeting"),
+	0,
+	TEXT("Show on screen the time spent finding the lock-on targets."));
+
+ULylatDragoonTargeting::ULylatDragoonTargeting(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	// Updated on demand by the queries
+	PrimaryComponentTick.bCanEverTick = false;
+
+	DistanceWeight = 0.25f;
+
+	LastUpdateFrame = 0;
+	LastQueryMicroseconds = 0.0f;
+}
+
+void ULylatDragoonTargeting::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	HierarchyEnemies.Empty();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+int32 ULylatDragoonTargeting::FindTargetsInCone(const FVector& Origin, const FVector& Direction, float HalfAngleDegrees, float MaxDistance, int32 MaxTargets, TArray<ALylatDragoonEnemy*>& OutTargets)
+{
+	LYLATDRAGOON_SCOPE_CYCLE_COUNTER(Targeting);
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	UpdateHierarchy();
+
+	const float HalfAngleRadians = FMath::DegreesToRadians(FMath::Clamp(HalfAngleDegrees, 0.0f, 90.0f));
+	const float CosHalfAngle = FMath::Cos(HalfAngleRadians);
+
+	ConeHits.Reset();
+	EnemyHierarchy.QueryCone(Origin, Direction.GetSafeNormal(), HalfAngleRadians, MaxDistance, ConeHits);
+
+	// 1 on the aim ray and 0 at the border of the cone, minus the weighted distance
+	const float InvAngleRange = 1.0f / FMath::Max(1.0f - CosHalfAngle, KINDA_SMALL_NUMBER);
+	const float InvMaxDistance = 1.0f / FMath::Max(MaxDistance, KINDA_SMALL_NUMBER);
+	const float Weight = DistanceWeight;
+	ConeHits.Sort([InvAngleRange, InvMaxDistance, Weight](const FLylatDragoonConeHit& A, const FLylatDragoonConeHit& B)
+	{
+		const float ScoreA = A.CosAngle * InvAngleRange - A.Distance * InvMaxDistance * Weight;
+		const float ScoreB = B.CosAngle * InvAngleRange - B.Distance * InvMaxDistance * Weight;
+		return ScoreA > ScoreB;
+	});
+
+	const int32 TargetCount = FMath::Min(ConeHits.Num(), MaxTargets);
+	for (int32 HitIndex = 0; HitIndex < TargetCount; ++HitIndex)
+	{
+		OutTargets.Add(HierarchyEnemies[ConeHits[HitIndex].Index]);
+	}
+
+	LastQueryMicroseconds = (float)((FPlatformTime::Seconds() - StartTime) * 1000000.0);
+
+	if (CVarShowTargeting.GetValueOnGameThread() != 0 && GEngine)
+	{
+		GEngine->AddOnScreenDebugMessage((uint64)GetUniqueID(), 0.0f, FColor::Yellow, FString::Printf(TEXT("Targeting: %d enemies, %d in cone, %.2f us"), HierarchyEnemies.Num(), ConeHits.Num(), LastQueryMicroseconds));
+	}
+
+	return TargetCount;
+}
+
+void ULylatDragoonTargeting::UpdateHierarchy()
+{
+	if (LastUpdateFrame == GFrameCounter)
+	{
+		return;
+	}
+	LastUpdateFrame = GFrameCounter;
+
+	ALylatDragoonGameMode* GameMode = Cast<ALylatDragoonGameMode>(GetOwner());
+	if (!GameMode)
+	{
+		return;
+	}
+
+	const TArray<ALylatDragoonEnemy*>& Enemies = GameMode->GetEnemies();
+
+	// The spheres are written straight into the hierarchy
+	EnemyHierarchy.ResetSpheres(Enemies.Num());
+	for (ALylatDragoonEnemy* Enemy : Enemies)
+	{
+		EnemyHierarchy.AddSphere(Enemy->GetActorLocation(), Enemy->HitRadius);
+	}
+
+	// The tree only has to change when enemies were added or removed
+	if (HierarchyEnemies != Enemies)
+	{
+		// Reset and append keep the memory when the number of enemies changes, assigning the array would reallocate it
+		HierarchyEnemies.Reset();
+		HierarchyEnemies.Append(Enemies);
+		EnemyHierarchy.Build();
+	}
+	else
+	{
+		EnemyHierarchy.Refit();
+	}
+}
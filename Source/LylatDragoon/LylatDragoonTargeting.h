@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Components/ActorComponent.h"
+#include "LylatDragoonBoundingVolumeHierarchy.h"
+#include "LylatDragoonTargeting.generated.h"
+
+/**
+ * Finds the enemies to lock on. The enemies alive are kept in a bounding volume hierarchy which is refit
+ * with their new locations the first time it is queried every frame, and rebuilt only when enemies are
+ * added or removed.
+ */
+UCLASS(ClassGroup = Combat, meta = (BlueprintSpawnableComponent))
+class LYLATDRAGOON_API ULylatDragoonTargeting : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	ULylatDragoonTargeting(const FObjectInitializer& ObjectInitializer);
+
+	// Begin UActorComponent overrides
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	// End UActorComponent overrides
+
+	/** How much the distance counts against the angle when sorting the targets, 0 sorts only by angle */
+	UPROPERTY(Category = Targeting, EditAnywhere)
+	float DistanceWeight;
+
+	/**
+	 * Find the enemies inside the cone around the aim ray, sorted from the best to the worst target.
+	 * At most MaxTargets enemies are added to OutTargets. Returns the number of enemies found.
+	 */
+	int32 FindTargetsInCone(const FVector& Origin, const FVector& Direction, float HalfAngleDegrees, float MaxDistance, int32 MaxTargets, TArray<class ALylatDragoonEnemy*>& OutTargets);
+
+	/** Returns the time spent in the last query, including the refit (in microseconds) */
+	FORCEINLINE float GetLastQueryMicroseconds() const { return LastQueryMicroseconds; }
+
+private:
+
+	/** Refit or rebuild the hierarchy with the enemies alive if it was not done this frame */
+	void UpdateHierarchy();
+
+	/** Enemies in the hierarchy */
+	FLylatDragoonBoundingVolumeHierarchy EnemyHierarchy;
+
+	/** Enemies stored in the hierarchy, with the same index */
+	UPROPERTY(Transient)
+	TArray<class ALylatDragoonEnemy*> HierarchyEnemies;
+
+	/** Scratch buffer used to sort the hits */
+	TArray<FLylatDragoonConeHit> ConeHits;
+
+	/** Value of GFrameCounter when the hierarchy was last updated */
+	uint64 LastUpdateFrame;
+
+	/** Time spent in the last query (in microseconds) */
+	float LastQueryMicroseconds;
+};
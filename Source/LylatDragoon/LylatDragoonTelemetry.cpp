@@ -0,0 +1,299 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonTelemetry.h"
+
+#include "GameFramework/Pawn.h"
+#include "GameFramework/PlayerState.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/Runnable.h"
+#include "HAL/RunnableThread.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+
+/** Number of events the ring buffer holds, about a minute of heavy fighting */
+static const int32 TelemetryRingCapacity = 64 * 1024;
+
+/** Time between two writes of the events to the log (in milliseconds) */
+static const uint32 TelemetryWriteIntervalMs = 50;
+
+FLylatDragoonTelemetryRing::FLylatDragoonTelemetryRing(int32 InCapacity)
+	: Head(0)
+	, Tail(0)
+	, DroppedCount(0)
+{
+	const uint32 Capacity = FMath::RoundUpToPowerOfTwo((uint32)FMath::Max(InCapacity, 2));
+	Records.SetNumZeroed(Capacity);
+	Mask = Capacity - 1;
+}
+
+int32 FLylatDragoonTelemetryRing::Pop(TArray<FLylatDragoonTelemetryRecord>& OutRecords)
+{
+	const uint32 CurrentTail = Tail.Load();
+	const uint32 Count = Head.Load() - CurrentTail;
+	if (Count == 0)
+	{
+		return 0;
+	}
+
+	// The records can wrap around the end of the buffer
+	const uint32 First = CurrentTail & Mask;
+	const uint32 FirstCount = FMath::Min(Count, Mask + 1 - First);
+	OutRecords.Append(Records.GetData() + First, FirstCount);
+	OutRecords.Append(Records.GetData(), Count - FirstCount);
+
+	// The producer can reuse the records once they are copied
+	Tail.Store(CurrentTail + Count);
+	return Count;
+}
+
+/** Background thread draining the ring buffer to the log. Owns the ring, so it can finish the log on its own */
+class FLylatDragoonTelemetryWriter : public FRunnable
+{
+public:
+
+	FLylatDragoonTelemetryWriter(TUniquePtr<FLylatDragoonTelemetryRing>&& InRing, const FString& InFilename)
+		: Ring(MoveTemp(InRing))
+		, Filename(InFilename)
+		, Stopping(false)
+		, Finished(false)
+		, RecordCount(0)
+	{
+		WakeEvent = FPlatformProcess::GetSynchEventFromPool();
+		Thread = FRunnableThread::Create(this, TEXT("LylatDragoonTelemetry"), 0, TPri_BelowNormal);
+	}
+
+	virtual ~FLylatDragoonTelemetryWriter()
+	{
+		Stop();
+		if (Thread)
+		{
+			Thread->WaitForCompletion();
+			delete Thread;
+		}
+		FPlatformProcess::ReturnSynchEventToPool(WakeEvent);
+	}
+
+	// Begin FRunnable overrides
+	virtual uint32 Run() override
+	{
+		// The file is only touched on this thread
+		IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+		PlatformFile.CreateDirectoryTree(*FPaths::GetPath(Filename));
+		TUniquePtr<IFileHandle> File(PlatformFile.OpenWrite(*Filename));
+		if (!File.IsValid())
+		{
+			UE_LOG(LogFlying, Error, TEXT("Could not open the telemetry log %s"), *Filename);
+		}
+
+		FLylatDragoonTelemetryFileHeader Header;
+		FMemory::Memzero(Header);
+		Header.Magic = FLylatDragoonTelemetryFileHeader::LogMagic;
+		Header.Version = FLylatDragoonTelemetryFileHeader::LogVersion;
+		Header.HeaderSize = sizeof(FLylatDragoonTelemetryFileHeader);
+		Header.RecordSize = sizeof(FLylatDragoonTelemetryRecord);
+		Header.StartTicks = FDateTime::UtcNow().GetTicks();
+		if (File.IsValid())
+		{
+			File->Write((const uint8*)&Header, sizeof(Header));
+		}
+
+		while (!Stopping)
+		{
+			WriteRecords(File.Get());
+			WakeEvent->Wait(TelemetryWriteIntervalMs);
+		}
+
+		// The game thread doesn't push anymore once stopping
+		WriteRecords(File.Get());
+
+		if (File.IsValid())
+		{
+			Header.RecordCount = RecordCount;
+			Header.DroppedCount = Ring->GetDroppedCount();
+			File->Seek(0);
+			File->Write((const uint8*)&Header, sizeof(Header));
+			File->Flush();
+		}
+
+		UE_LOG(LogFlying, Log, TEXT("Wrote %llu telemetry events to %s, %u dropped"), RecordCount, *Filename, Ring->GetDroppedCount());
+		Finished = true;
+		return 0;
+	}
+
+	virtual void Stop() override
+	{
+		Stopping = true;
+		WakeEvent->Trigger();
+	}
+	// End FRunnable overrides
+
+	/** Returns the ring the game thread pushes the events to */
+	FORCEINLINE FLylatDragoonTelemetryRing* GetRing() const { return Ring.Get(); }
+
+	/** Indicates if the log is closed, deleting the writer then only waits for the end of its thread */
+	FORCEINLINE bool IsFinished() const { return Finished; }
+
+private:
+
+	/** Append the records pushed since the last write to the file */
+	void WriteRecords(IFileHandle* File)
+	{
+		PendingRecords.Reset();
+		const int32 Count = Ring->Pop(PendingRecords);
+		if (Count > 0 && File)
+		{
+			File->Write((const uint8*)PendingRecords.GetData(), Count * sizeof(FLylatDragoonTelemetryRecord));
+			RecordCount += Count;
+		}
+	}
+
+	TUniquePtr<FLylatDragoonTelemetryRing> Ring;
+	FString Filename;
+	FRunnableThread* Thread;
+	FEvent* WakeEvent;
+	TAtomic<bool> Stopping;
+	TAtomic<bool> Finished;
+
+	/** Records being written, kept to avoid allocating on every write */
+	TArray<FLylatDragoonTelemetryRecord> PendingRecords;
+
+	/** Number of records written so far */
+	uint64 RecordCount;
+};
+
+FLylatDragoonTelemetry& FLylatDragoonTelemetry::Get()
+{
+	static FLylatDragoonTelemetry Telemetry;
+	return Telemetry;
+}
+
+FLylatDragoonTelemetry::FLylatDragoonTelemetry()
+	: Ring(nullptr)
+	, StartTime(0.0)
+{
+	// The threads are joined before the exit rather than when the static is destroyed, the engine is gone by then.
+	// The log lives until the end of the process, so the delegate is never removed
+	FCoreDelegates::OnPreExit.AddRaw(this, &FLylatDragoonTelemetry::OnPreExit);
+}
+
+bool FLylatDragoonTelemetry::Start(const FString& Filename)
+{
+	check(IsInGameThread());
+
+	if (IsRecording())
+	{
+		return false;
+	}
+
+	DeleteFinishedWriters();
+
+	StartTime = FApp::GetCurrentTime();
+	Writer = MakeUnique<FLylatDragoonTelemetryWriter>(MakeUnique<FLylatDragoonTelemetryRing>(TelemetryRingCapacity), Filename);
+	Ring = Writer->GetRing();
+
+	UE_LOG(LogFlying, Log, TEXT("Recording telemetry to %s"), *Filename);
+	return true;
+}
+
+void FLylatDragoonTelemetry::Stop()
+{
+	if (!IsRecording())
+	{
+		return;
+	}
+
+	// Stop recording first, the writer drains the events left and closes the file on its thread without the game
+	// thread waiting for it
+	Ring = nullptr;
+	Writer->Stop();
+	StoppedWriters.Add(MoveTemp(Writer));
+
+	DeleteFinishedWriters();
+}
+
+void FLylatDragoonTelemetry::DeleteFinishedWriters()
+{
+	StoppedWriters.RemoveAll([](const TUniquePtr<FLylatDragoonTelemetryWriter>& StoppedWriter) { return StoppedWriter->IsFinished(); });
+}
+
+void FLylatDragoonTelemetry::OnPreExit()
+{
+	// The process is exiting, the logs still being written are finished before it does
+	Stop();
+	StoppedWriters.Empty();
+}
+
+uint16 FLylatDragoonTelemetry::GetPlayerId(const APawn* Pawn)
+{
+	return (Pawn && Pawn->PlayerState) ? (uint16)Pawn->PlayerState->PlayerId : 0;
+}
+
+const TCHAR* FLylatDragoonTelemetry::GetEventName(uint8 Type)
+{
+	static const TCHAR* EventNames[] =
+	{
+		TEXT("ShotFired"),
+		TEXT("Hit"),
+		TEXT("DamageTaken"),
+		TEXT("Death"),
+		TEXT("EnergyCooldown"),
+		TEXT("BarrelRoll"),
+		TEXT("PlayRate"),
+	};
+	static_assert(ARRAY_COUNT(EventNames) == (int32)ELylatDragoonTelemetryEvent::Count, "Every event needs a name");
+
+	return Type < ARRAY_COUNT(EventNames) ? EventNames[Type] : TEXT("Unknown");
+}
+
+bool FLylatDragoonTelemetry::ConvertToCsv(const FString& LogFilename, const FString& CsvFilename)
+{
+	TArray<uint8> FileData;
+	if (!FFileHelper::LoadFileToArray(FileData, *LogFilename))
+	{
+		UE_LOG(LogFlying, Error, TEXT("Could not load the telemetry log %s"), *LogFilename);
+		return false;
+	}
+
+	FLylatDragoonTelemetryFileHeader Header;
+	if (FileData.Num() < (int32)sizeof(Header))
+	{
+		UE_LOG(LogFlying, Error, TEXT("%s is not a telemetry log"), *LogFilename);
+		return false;
+	}
+	FMemory::Memcpy(&Header, FileData.GetData(), sizeof(Header));
+	if (Header.Magic != FLylatDragoonTelemetryFileHeader::LogMagic || Header.Version != FLylatDragoonTelemetryFileHeader::LogVersion
+		|| Header.HeaderSize != sizeof(FLylatDragoonTelemetryFileHeader) || Header.RecordSize != sizeof(FLylatDragoonTelemetryRecord))
+	{
+		UE_LOG(LogFlying, Error, TEXT("%s is not a telemetry log of version %u"), *LogFilename, FLylatDragoonTelemetryFileHeader::LogVersion);
+		return false;
+	}
+
+	// A log that was not closed still has every record written before the game stopped
+	const int32 RecordCount = (FileData.Num() - Header.HeaderSize) / Header.RecordSize;
+	if (Header.RecordCount != 0 && Header.RecordCount != (uint64)RecordCount)
+	{
+		UE_LOG(LogFlying, Warning, TEXT("%s should have %llu events but has %d"), *LogFilename, Header.RecordCount, RecordCount);
+	}
+
+	FString Csv;
+	Csv.Reserve(RecordCount * 48);
+	Csv += TEXT("Time,Event,Player,Value,Value2,Extra\n");
+
+	const FLylatDragoonTelemetryRecord* Records = (const FLylatDragoonTelemetryRecord*)(FileData.GetData() + Header.HeaderSize);
+	for (int32 Index = 0; Index < RecordCount; ++Index)
+	{
+		const FLylatDragoonTelemetryRecord& Record = Records[Index];
+		Csv += FString::Printf(TEXT("%.4f,%s,%u,%.3f,%.3f,%u\n"), Record.Time, GetEventName(Record.Type), Record.Player, Record.Value, Record.Value2, Record.Extra);
+	}
+
+	if (!FFileHelper::SaveStringToFile(Csv, *CsvFilename))
+	{
+		UE_LOG(LogFlying, Error, TEXT("Could not write %s"), *CsvFilename);
+		return false;
+	}
+
+	UE_LOG(LogFlying, Display, TEXT("Converted %d telemetry events (%llu dropped) from %s to %s"), RecordCount, Header.DroppedCount, *LogFilename, *CsvFilename);
+	return true;
+}
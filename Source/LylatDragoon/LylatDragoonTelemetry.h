@@ -0,0 +1,204 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Misc/App.h"
+#include "Templates/Atomic.h"
+#include "Templates/UniquePtr.h"
+
+/** Kinds of events of the telemetry log */
+enum class ELylatDragoonTelemetryEvent : uint8
+{
+	/** Value: number of shots. Extra: 1 for homing shots */
+	ShotFired,
+	/** Value: damage dealt to an enemy */
+	Hit,
+	/** Value: damage. Value2: health left */
+	DamageTaken,
+	/** Value2: playback position of the level sequence */
+	Death,
+	/** Value: energy left when the cooldown started */
+	EnergyCooldown,
+	/** Extra: 0 for a barrel roll to the left, 1 to the right */
+	BarrelRoll,
+	/** Value: new play rate of the level sequence */
+	PlayRate,
+
+	Count
+};
+
+/** One event of the log, written to the file as is */
+struct FLylatDragoonTelemetryRecord
+{
+	/** Time since the log started (in seconds) */
+	float Time;
+
+	float Value;
+	float Value2;
+
+	/** Id of the player state of the pawn the event is about, 0 when it has none */
+	uint16 Player;
+
+	/** ELylatDragoonTelemetryEvent */
+	uint8 Type;
+
+	uint8 Extra;
+};
+
+static_assert(sizeof(FLylatDragoonTelemetryRecord) == 16, "Telemetry records are written to the log as is");
+
+/**
+ * Header at the start of a telemetry log, followed by the records one after the other.
+ * The log can be mapped in memory and read as this header and an array of FLylatDragoonTelemetryRecord.
+ */
+struct FLylatDragoonTelemetryFileHeader
+{
+	uint32 Magic;
+	uint32 Version;
+	uint32 HeaderSize;
+	uint32 RecordSize;
+
+	/** UTC time when the log started, in FDateTime ticks */
+	int64 StartTicks;
+
+	/** Number of records, 0 when the log was not closed (the size of the file tells how many were written) */
+	uint64 RecordCount;
+
+	/** Number of events lost because the ring buffer was full */
+	uint64 DroppedCount;
+
+	static const uint32 LogMagic = 0x4C44544C;
+	static const uint32 LogVersion = 1;
+};
+
+/**
+ * Fixed-size ring buffer of telemetry records, for one producer thread and one consumer thread without any lock.
+ * Each side only writes its own index. Events pushed while the buffer is full are dropped and counted.
+ */
+class LYLATDRAGOON_API FLylatDragoonTelemetryRing
+{
+public:
+
+	/** The capacity is rounded up to a power of two */
+	explicit FLylatDragoonTelemetryRing(int32 InCapacity);
+
+	/** Append a record, returns false when it was dropped. Only called by the producer */
+	FORCEINLINE bool Push(const FLylatDragoonTelemetryRecord& Record)
+	{
+		const uint32 CurrentHead = Head.Load();
+		if (CurrentHead - Tail.Load() > Mask)
+		{
+			++DroppedCount;
+			return false;
+		}
+
+		Records[CurrentHead & Mask] = Record;
+
+		// Publish the record once it is written
+		Head.Store(CurrentHead + 1);
+		return true;
+	}
+
+	/** Move the records pushed so far to the end of the array, returns how many. Only called by the consumer */
+	int32 Pop(TArray<FLylatDragoonTelemetryRecord>& OutRecords);
+
+	/** Returns the number of records the buffer holds */
+	FORCEINLINE int32 GetCapacity() const { return Records.Num(); }
+
+	/** Returns the number of events dropped so far */
+	FORCEINLINE uint32 GetDroppedCount() const { return DroppedCount.Load(); }
+
+private:
+
+	TArray<FLylatDragoonTelemetryRecord> Records;
+	uint32 Mask;
+
+	/** Index of the next record pushed, only written by the producer */
+	TAtomic<uint32> Head;
+
+	/** Keep the indices on their own cache lines, the two threads write them all the time */
+	uint8 HeadPadding[PLATFORM_CACHE_LINE_SIZE];
+
+	/** Index of the next record popped, only written by the consumer */
+	TAtomic<uint32> Tail;
+
+	uint8 TailPadding[PLATFORM_CACHE_LINE_SIZE];
+
+	/** Only written by the producer */
+	TAtomic<uint32> DroppedCount;
+};
+
+/**
+ * Log of gameplay events (shots, hits, damage, deaths, energy cooldowns, barrel rolls, play rate changes) for the
+ * analysis of the runs offline. Started by the pawn when the game is launched with -LylatTelemetry=<file>.
+ * The game thread appends the events to a ring buffer, and a background thread writes them to the log, so the game
+ * thread never waits for the file. Stopping the log leaves the thread to write the events left and close the file on
+ * its own, only the exit of the process waits for it (on FCoreDelegates::OnPreExit, while the engine is still up).
+ * ULylatDragoonTelemetryCommandlet converts the logs to CSV.
+ */
+class LYLATDRAGOON_API FLylatDragoonTelemetry
+{
+public:
+
+	/** Returns the log of this process */
+	static FLylatDragoonTelemetry& Get();
+
+	/** Start writing the events to the file, returns false if the log was already started */
+	bool Start(const FString& Filename);
+
+	/** Stop recording, the events left are written and the file closed in the background */
+	void Stop();
+
+	/** Indicates if the events are recorded */
+	FORCEINLINE bool IsRecording() const { return Ring != nullptr; }
+
+	/** Append an event. Only called on the game thread, does nothing when the log is not started */
+	FORCEINLINE void Record(ELylatDragoonTelemetryEvent Type, uint16 Player, float Value = 0.0f, float Value2 = 0.0f, uint8 Extra = 0)
+	{
+		if (Ring)
+		{
+			FLylatDragoonTelemetryRecord Event;
+			Event.Time = (float)(FApp::GetCurrentTime() - StartTime);
+			Event.Value = Value;
+			Event.Value2 = Value2;
+			Event.Player = Player;
+			Event.Type = (uint8)Type;
+			Event.Extra = Extra;
+			Ring->Push(Event);
+		}
+	}
+
+	/** Returns the number of events dropped since the log started */
+	FORCEINLINE uint32 GetDroppedCount() const { return Ring ? Ring->GetDroppedCount() : 0; }
+
+	/** Returns the player id recorded for the events of a pawn */
+	static uint16 GetPlayerId(const class APawn* Pawn);
+
+	/** Returns the name of an event in the CSV files */
+	static const TCHAR* GetEventName(uint8 Type);
+
+	/** Write the events of a log to a CSV file */
+	static bool ConvertToCsv(const FString& LogFilename, const FString& CsvFilename);
+
+private:
+
+	FLylatDragoonTelemetry();
+
+	/** Delete the writers of the logs stopped once their file is closed */
+	void DeleteFinishedWriters();
+
+	/** Stop recording and wait for the logs still being written, before the process exits */
+	void OnPreExit();
+
+	/** Events waiting to be written, owned by the writer. Null when the log is not started */
+	FLylatDragoonTelemetryRing* Ring;
+
+	/** Thread writing the events */
+	TUniquePtr<class FLylatDragoonTelemetryWriter> Writer;
+
+	/** Threads still writing the logs stopped */
+	TArray<TUniquePtr<class FLylatDragoonTelemetryWriter>> StoppedWriters;
+
+	/** Application time when the log started */
+	double StartTime;
+};
@@ -0,0 +1,41 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "LylatDragoon.h"
+#include "LylatDragoonTelemetryCommandlet.h"
+
+#include "LylatDragoonTelemetry.h"
+
+ULylatDragoonTelemetryCommandlet::ULylatDragoonTelemetryCommandlet(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 ULylatDragoonTelemetryCommandlet::Main(const FString& Params)
+{
+	FString LogFilename;
+	if (!FParse::Value(*Params, TEXT("Log="), LogFilename))
+	{
+		UE_LOG(LogFlying, Error, TEXT("Usage: -run=LylatDragoonTelemetry -Log=<file> [-Csv=<file>]"));
+		return 1;
+	}
+	if (FPaths::IsRelative(LogFilename))
+	{
+		LogFilename = FPaths::ProjectSavedDir() / TEXT("Telemetry") / LogFilename;
+	}
+
+	FString CsvFilename;
+	if (!FParse::Value(*Params, TEXT("Csv="), CsvFilename))
+	{
+		CsvFilename = FPaths::ChangeExtension(LogFilename, TEXT("csv"));
+	}
+	else if (FPaths::IsRelative(CsvFilename))
+	{
+		CsvFilename = FPaths::ProjectSavedDir() / TEXT("Telemetry") / CsvFilename;
+	}
+
+	return FLylatDragoonTelemetry::ConvertToCsv(LogFilename, CsvFilename) ? 0 : 1;
+}
@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "LylatDragoonTelemetryCommandlet.generated.h"
+
+/**
+ * Converts a telemetry log to CSV:
+ *   UE4Editor-Cmd LylatDragoon.uproject -run=LylatDragoonTelemetry -Log=<file> [-Csv=<file>]
+ * Relative paths are in the Saved/Telemetry folder, the CSV file is next to the log by default.
+ */
+UCLASS()
+class ULylatDragoonTelemetryCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+
+	ULylatDragoonTelemetryCommandlet(const FObjectInitializer& ObjectInitializer);
+
+	// Begin UCommandlet overrides
+	virtual int32 Main(const FString& Params) override;
+	// End UCommandlet overrides
+};